@@ -0,0 +1,78 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <cstdint>
+#include <lib/set.hpp>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+/* Requests checking a few hundred keys against one large set: one find after another
+ * against the batched descents which overlap their cache misses */
+
+namespace {
+
+constexpr int64_t kRequestSize = 256;
+
+template <typename Key>
+std::vector<Key> MakeRequests(int64_t set_size, int64_t count) {
+  // half of the probes miss, the set holds even ids only
+  auto ids = MakeKeys<int64_t>(set_size * 2, KeyOrder::kRandom, 5);
+  std::vector<Key> probes;
+  for (int64_t i = 0; i < count; ++i) {
+    probes.push_back(MakeKey<Key>(ids[i % ids.size()]));
+  }
+
+  return probes;
+}
+
+template <typename Key>
+Set<Key> MakeSet(int64_t size) {
+  std::vector<Key> keys;
+  for (int64_t i = 0; i < size; ++i) {
+    keys.push_back(MakeKey<Key>(i * 2));
+  }
+
+  return Set<Key>(keys.begin(), keys.end());
+}
+
+template <typename Key>
+void BM_ContainsOneByOne(benchmark::State& state) {
+  auto set = MakeSet<Key>(state.range(0));
+  auto probes = MakeRequests<Key>(state.range(0), kRequestSize * 64);
+  auto results = std::make_unique<bool[]>(kRequestSize);
+
+  for (auto _ : state) {
+    for (size_t first = 0; first < probes.size(); first += kRequestSize) {
+      for (int64_t i = 0; i < kRequestSize; ++i) {
+        results[i] = set.contains(probes[first + i]);
+      }
+      benchmark::DoNotOptimize(results.get());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * probes.size());
+}
+
+template <typename Key>
+void BM_ContainsMany(benchmark::State& state) {
+  auto set = MakeSet<Key>(state.range(0));
+  auto probes = MakeRequests<Key>(state.range(0), kRequestSize * 64);
+  auto results = std::make_unique<bool[]>(kRequestSize);
+
+  for (auto _ : state) {
+    for (size_t first = 0; first < probes.size(); first += kRequestSize) {
+      set.contains_many(std::span<const Key>(probes.data() + first, kRequestSize), std::span<bool>(results.get(), kRequestSize));
+      benchmark::DoNotOptimize(results.get());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * probes.size());
+}
+
+} // namespace
+
+BENCHMARK(BM_ContainsOneByOne<int64_t>)->RangeMultiplier(10)->Range(1'000, 10'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ContainsMany<int64_t>)->RangeMultiplier(10)->Range(1'000, 10'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ContainsOneByOne<std::string>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ContainsMany<std::string>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
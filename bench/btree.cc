@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <cstdint>
+#include <functional>
+#include <lib/set.hpp>
+#include <memory>
+#include <set>
+#include <string>
+
+#ifdef SET_BENCH_WITH_ABSL
+#include <absl/container/btree_set.h>
+#endif
+
+/* B+-tree engine against the binary trees: random lookups, random inserts and full scans */
+
+namespace {
+
+template <typename Key>
+using BTreeOf = Set<Key, std::less<Key>, std::allocator<Key>, BTree<>>;
+
+template <typename Container>
+void BM_EngineFind(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto keys = MakeKeys<Key>(state.range(0), KeyOrder::kRandom);
+  auto queries = MakeKeys<Key>(state.range(0), KeyOrder::kRandom, 7);
+  Container container(keys.begin(), keys.end());
+
+  for (auto _ : state) {
+    for (const auto& query : queries) {
+      benchmark::DoNotOptimize(container.find(query));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+template <typename Container>
+void BM_EngineInsert(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto keys = MakeKeys<Key>(state.range(0), KeyOrder::kRandom);
+
+  for (auto _ : state) {
+    Container container;
+    for (const auto& key : keys) {
+      container.insert(key);
+    }
+    benchmark::DoNotOptimize(container);
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+template <typename Container>
+void BM_EngineScan(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto keys = MakeKeys<Key>(state.range(0), KeyOrder::kRandom);
+  Container container(keys.begin(), keys.end());
+
+  for (auto _ : state) {
+    for (const auto& key : container) {
+      benchmark::DoNotOptimize(key);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+} // namespace
+
+#define ENGINE_BENCHMARK_CONTAINER(...)                                                                                 \
+  BENCHMARK(BM_EngineFind<__VA_ARGS__>)->RangeMultiplier(10)->Range(1'000, 10'000'000)->Unit(benchmark::kMillisecond);   \
+  BENCHMARK(BM_EngineInsert<__VA_ARGS__>)->RangeMultiplier(10)->Range(1'000, 10'000'000)->Unit(benchmark::kMillisecond); \
+  BENCHMARK(BM_EngineScan<__VA_ARGS__>)->RangeMultiplier(10)->Range(1'000, 10'000'000)->Unit(benchmark::kMillisecond);
+
+ENGINE_BENCHMARK_CONTAINER(BTreeOf<int64_t>)
+ENGINE_BENCHMARK_CONTAINER(Set<int64_t>)
+ENGINE_BENCHMARK_CONTAINER(std::set<int64_t>)
+ENGINE_BENCHMARK_CONTAINER(BTreeOf<std::string>)
+ENGINE_BENCHMARK_CONTAINER(Set<std::string>)
+
+#ifdef SET_BENCH_WITH_ABSL
+ENGINE_BENCHMARK_CONTAINER(absl::btree_set<int64_t>)
+#endif
@@ -0,0 +1,73 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <cstdint>
+#include <lib/set.hpp>
+#include <set>
+
+namespace {
+
+// cold start: the whole snapshot is already sorted
+template <typename Container>
+void BM_LoadSortedPerKey(benchmark::State& state) {
+  auto keys = MakeKeys<int64_t>(state.range(0), KeyOrder::kSorted);
+
+  for (auto _ : state) {
+    Container container;
+    for (auto key : keys) {
+      container.insert(key);
+    }
+    benchmark::DoNotOptimize(container);
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// near sorted stream, every key is appended with end() as the hint
+template <typename Container>
+void BM_LoadSortedHinted(benchmark::State& state) {
+  auto keys = MakeKeys<int64_t>(state.range(0), KeyOrder::kSorted);
+
+  for (auto _ : state) {
+    Container container;
+    for (auto key : keys) {
+      container.insert(container.end(), key);
+    }
+    benchmark::DoNotOptimize(container);
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+template <typename Container>
+void BM_LoadSortedRange(benchmark::State& state) {
+  auto keys = MakeKeys<int64_t>(state.range(0), KeyOrder::kSorted);
+
+  for (auto _ : state) {
+    Container container(keys.begin(), keys.end());
+    benchmark::DoNotOptimize(container);
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+template <typename Container>
+void BM_LoadRandomRange(benchmark::State& state) {
+  auto keys = MakeKeys<int64_t>(state.range(0), KeyOrder::kRandom);
+
+  for (auto _ : state) {
+    Container container(keys.begin(), keys.end());
+    benchmark::DoNotOptimize(container);
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+} // namespace
+
+BENCHMARK(BM_LoadSortedPerKey<Set<int64_t>>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadSortedHinted<Set<int64_t>>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadSortedRange<Set<int64_t>>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadRandomRange<Set<int64_t>>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadSortedHinted<std::set<int64_t>>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadSortedRange<std::set<int64_t>>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadRandomRange<std::set<int64_t>>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
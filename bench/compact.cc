@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <lib/compact_set.hpp>
+#include <lib/set.hpp>
+#include <memory>
+#include <set>
+
+/* Index links against pointer links and B-tree nodes: memory per key and random lookups in large sets of small keys */
+
+namespace {
+
+// std::allocator which sums the bytes it hands out, malloc headers aren't counted
+struct ByteCounter {
+  static inline std::size_t bytes = 0;
+};
+
+template <typename T>
+struct ByteCountingAllocator : std::allocator<T> {
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = ByteCountingAllocator<U>;
+  };
+
+  ByteCountingAllocator() = default;
+
+  template <typename U>
+  ByteCountingAllocator(const ByteCountingAllocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    ByteCounter::bytes += n * sizeof(T);
+    return std::allocator<T>::allocate(n);
+  }
+
+  void deallocate(T* ptr, std::size_t n) {
+    ByteCounter::bytes -= n * sizeof(T);
+    std::allocator<T>::deallocate(ptr, n);
+  }
+};
+
+template <typename Key>
+using IndexSet = CompactSet<Key, std::less<Key>, ByteCountingAllocator<Key>>;
+
+template <typename Key>
+using StdSet = std::set<Key, std::less<Key>, ByteCountingAllocator<Key>>;
+
+template <typename Key>
+using PointerSet = Set<Key, std::less<Key>, ByteCountingAllocator<Key>>;
+
+template <typename Key>
+using BTreeSetOf = Set<Key, std::less<Key>, ByteCountingAllocator<Key>, BTree<>>;
+
+template <typename Container>
+void BM_CompactInsert(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto keys = MakeKeys<Key>(state.range(0), KeyOrder::kRandom);
+  std::size_t bytes = 0;
+
+  for (auto _ : state) {
+    auto before = ByteCounter::bytes;
+
+    Container container;
+    for (const auto& key : keys) {
+      container.insert(key);
+    }
+
+    bytes = ByteCounter::bytes - before;
+    benchmark::DoNotOptimize(container);
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+  state.counters["bytes_per_key"] = static_cast<double>(bytes) / static_cast<double>(keys.size());
+}
+
+template <typename Container>
+void BM_CompactFind(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto keys = MakeKeys<Key>(state.range(0), KeyOrder::kRandom);
+  auto queries = MakeKeys<Key>(state.range(0), KeyOrder::kRandom, 7);
+  Container container(keys.begin(), keys.end());
+
+  for (auto _ : state) {
+    for (const auto& query : queries) {
+      benchmark::DoNotOptimize(container.find(query));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+} // namespace
+
+#define COMPACT_BENCHMARK_CONTAINER(...)                                                                                \
+  BENCHMARK(BM_CompactInsert<__VA_ARGS__>)->RangeMultiplier(10)->Range(1'000, 10'000'000)->Unit(benchmark::kMillisecond); \
+  BENCHMARK(BM_CompactFind<__VA_ARGS__>)->RangeMultiplier(10)->Range(1'000, 10'000'000)->Unit(benchmark::kMillisecond);
+
+COMPACT_BENCHMARK_CONTAINER(IndexSet<int>)
+COMPACT_BENCHMARK_CONTAINER(PointerSet<int>)
+COMPACT_BENCHMARK_CONTAINER(StdSet<int>)
+COMPACT_BENCHMARK_CONTAINER(BTreeSetOf<int>)
+COMPACT_BENCHMARK_CONTAINER(IndexSet<int64_t>)
+COMPACT_BENCHMARK_CONTAINER(PointerSet<int64_t>)
+COMPACT_BENCHMARK_CONTAINER(StdSet<int64_t>)
+COMPACT_BENCHMARK_CONTAINER(BTreeSetOf<int64_t>)
@@ -0,0 +1,101 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <atomic>
+#include <cstdint>
+#include <lib/concurrent_set.hpp>
+#include <lib/set.hpp>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+/* Lookups from 1 to 64 threads while one background thread keeps writing: the lock-free
+ * readers of ConcurrentSet against Set behind a reader-writer lock */
+
+namespace {
+
+constexpr int64_t kSetSize = 1'000'000;
+constexpr int64_t kLookupsPerThread = 1 << 16;
+constexpr int64_t kProbes = kLookupsPerThread * 4;
+
+class LockedSet {
+public:
+  bool contains(int64_t key) const {
+    std::shared_lock lock(mutex_);
+    return set_.contains(key);
+  }
+
+  void insert(int64_t key) {
+    std::unique_lock lock(mutex_);
+    set_.insert(key);
+  }
+
+  void erase(int64_t key) {
+    std::unique_lock lock(mutex_);
+    set_.erase(key);
+  }
+
+private:
+  mutable std::shared_mutex mutex_;
+  Set<int64_t> set_;
+};
+
+// shared by the threads of one benchmark run, built by its first thread
+template <typename Container>
+struct Fixture {
+  Container container;
+  std::vector<int64_t> probes;
+  std::atomic<bool> stop{false};
+  std::thread writer;
+
+  Fixture() {
+    // even keys are in, the writer churns odd ones
+    for (int64_t i = 0; i < kSetSize; ++i) {
+      container.insert(i * 2);
+    }
+
+    auto ids = MakeKeys<int64_t>(kSetSize * 2, KeyOrder::kRandom, 5);
+    probes.assign(ids.begin(), ids.begin() + kProbes);
+
+    writer = std::thread([this] {
+      for (int64_t i = 0; !stop.load(std::memory_order_relaxed); i = (i + 1) % kSetSize) {
+        container.insert(i * 2 + 1);
+        container.erase(i * 2 + 1);
+      }
+    });
+  }
+
+  ~Fixture() {
+    stop.store(true);
+    writer.join();
+  }
+};
+
+template <typename Container>
+void BM_ConcurrentContains(benchmark::State& state) {
+  static Fixture<Container>* fixture = nullptr;
+  if (state.thread_index() == 0) {
+    fixture = new Fixture<Container>();
+  }
+
+  // every thread starts on its own part of the probes, the fixture is ready once the loop starts
+  auto offset = state.thread_index() * 4099 % kProbes;
+
+  for (auto _ : state) {
+    for (int64_t i = 0; i < kLookupsPerThread; ++i) {
+      benchmark::DoNotOptimize(fixture->container.contains(fixture->probes[(offset + i) % kProbes]));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * kLookupsPerThread);
+
+  if (state.thread_index() == 0) {
+    delete fixture;
+    fixture = nullptr;
+  }
+}
+
+} // namespace
+
+BENCHMARK(BM_ConcurrentContains<ConcurrentSet<int64_t>>)->ThreadRange(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ConcurrentContains<LockedSet>)->ThreadRange(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,68 @@
+#include <benchmark/benchmark.h>
+#include <lib/set.hpp>
+#include <random>
+#include <tests/counting_allocator.hpp>
+#include <vector>
+
+namespace {
+
+// key whose move may throw, so emplace has to construct the node before searching
+struct PlainKey {
+  PlainKey(int v = 0) : value{v} {}
+  PlainKey(const PlainKey&) = default;
+  PlainKey(PlainKey&& other) : value{other.value} {}
+
+  bool operator<(const PlainKey& other) const { return value < other.value; }
+
+  int value;
+};
+
+// 70% of the stream hits keys which are already present
+std::vector<int> MakeDuplicateHeavyStream(int present, int count) {
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<int> existing(0, present - 1);
+  std::uniform_int_distribution<int> fresh(present, present * 8);
+  std::bernoulli_distribution is_duplicate(0.7);
+
+  std::vector<int> stream;
+  stream.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    stream.push_back(is_duplicate(gen) ? existing(gen) : fresh(gen));
+  }
+
+  return stream;
+}
+
+template <typename Key>
+void BM_DuplicateHeavyEmplace(benchmark::State& state) {
+  const int present = state.range(0);
+  auto stream = MakeDuplicateHeavyStream(present, present);
+
+  std::size_t allocations = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    Set<Key, std::less<Key>, CountingAllocator<Key>> set;
+    for (int i = 0; i < present; ++i) {
+      set.emplace(i);
+    }
+    AllocationCounter::Reset();
+    state.ResumeTiming();
+
+    for (int key : stream) {
+      benchmark::DoNotOptimize(set.emplace(key));
+    }
+
+    allocations += AllocationCounter::allocations;
+  }
+
+  state.counters["allocs_per_insert"] = benchmark::Counter(
+      static_cast<double>(allocations) / (state.iterations() * stream.size()));
+  state.SetItemsProcessed(state.iterations() * stream.size());
+}
+
+} // namespace
+
+// allocate-then-search path
+BENCHMARK(BM_DuplicateHeavyEmplace<PlainKey>)->Range(1 << 10, 1 << 16);
+// search-then-allocate path
+BENCHMARK(BM_DuplicateHeavyEmplace<int>)->Range(1 << 10, 1 << 16);
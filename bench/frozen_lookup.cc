@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <cstdint>
+#include <lib/frozen_set.hpp>
+#include <lib/set.hpp>
+#include <set>
+#include <string>
+
+#ifdef SET_BENCH_WITH_ABSL
+#include <absl/container/btree_set.h>
+#endif
+
+/* Built once, queried many times: random lookups of present and missing keys
+ * in a frozen snapshot against the pointer trees it was made of */
+
+namespace {
+
+// half of the queries miss, ids of the built keys are even
+template <typename Key>
+std::vector<Key> MakeQueries(int64_t count) {
+  auto keys = MakeKeys<Key>(count * 2, KeyOrder::kRandom, 11);
+  keys.resize(count);
+  return keys;
+}
+
+template <typename Key>
+std::vector<Key> MakeEvenKeys(int64_t count) {
+  std::vector<Key> keys;
+  keys.reserve(count);
+  for (int64_t i = 0; i < count; ++i) {
+    keys.push_back(MakeKey<Key>(i * 2));
+  }
+
+  return keys;
+}
+
+template <typename Container>
+void BM_FrozenContains(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto keys = MakeEvenKeys<Key>(state.range(0));
+  auto queries = MakeQueries<Key>(state.range(0));
+  Container container(keys.begin(), keys.end());
+
+  for (auto _ : state) {
+    for (const auto& query : queries) {
+      benchmark::DoNotOptimize(container.contains(query));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+template <typename Container>
+void BM_FrozenLowerBound(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto keys = MakeEvenKeys<Key>(state.range(0));
+  auto queries = MakeQueries<Key>(state.range(0));
+  Container container(keys.begin(), keys.end());
+
+  for (auto _ : state) {
+    for (const auto& query : queries) {
+      benchmark::DoNotOptimize(container.lower_bound(query));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+} // namespace
+
+#define FROZEN_BENCHMARK_CONTAINER(...)                                                                                 \
+  BENCHMARK(BM_FrozenContains<__VA_ARGS__>)->RangeMultiplier(10)->Range(1'000, 10'000'000)->Unit(benchmark::kMillisecond);  \
+  BENCHMARK(BM_FrozenLowerBound<__VA_ARGS__>)->RangeMultiplier(10)->Range(1'000, 10'000'000)->Unit(benchmark::kMillisecond);
+
+FROZEN_BENCHMARK_CONTAINER(FrozenSet<int64_t>)
+FROZEN_BENCHMARK_CONTAINER(Set<int64_t>)
+FROZEN_BENCHMARK_CONTAINER(std::set<int64_t>)
+FROZEN_BENCHMARK_CONTAINER(FrozenSet<std::string>)
+FROZEN_BENCHMARK_CONTAINER(Set<std::string>)
+FROZEN_BENCHMARK_CONTAINER(std::set<std::string>)
+
+#ifdef SET_BENCH_WITH_ABSL
+FROZEN_BENCHMARK_CONTAINER(absl::btree_set<int64_t>)
+FROZEN_BENCHMARK_CONTAINER(absl::btree_set<std::string>)
+#endif
@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+#include <lib/set.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// long enough to never fit into the small string buffer
+std::vector<std::string> MakeKeys(int count) {
+  std::vector<std::string> keys;
+  keys.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    keys.push_back("service/region-eu-west/instance-" + std::to_string(i * 7919 % count));
+  }
+
+  return keys;
+}
+
+template <typename Comparator>
+void BM_StringViewFind(benchmark::State& state) {
+  auto keys = MakeKeys(state.range(0));
+  Set<std::string, Comparator> set;
+  for (const auto& key : keys) {
+    set.insert(key);
+  }
+
+  std::vector<std::string_view> probes(keys.begin(), keys.end());
+
+  for (auto _ : state) {
+    for (auto probe : probes) {
+      if constexpr (TransparentComparator<Comparator>) {
+        benchmark::DoNotOptimize(set.find(probe));
+      } else {
+        benchmark::DoNotOptimize(set.find(std::string(probe))); // has to materialize a key
+      }
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * probes.size());
+}
+
+} // namespace
+
+BENCHMARK(BM_StringViewFind<std::less<std::string>>)->Range(1 << 10, 1 << 16);
+BENCHMARK(BM_StringViewFind<std::less<>>)->Range(1 << 10, 1 << 16);
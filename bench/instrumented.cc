@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <cstdint>
+#include <functional>
+#include <lib/set.hpp>
+#include <memory>
+
+/* Price of the counters: lookups and scans of a plain set against an instrumented one */
+
+namespace {
+
+template <typename Key>
+using InstrumentedOf = Set<Key, std::less<Key>, std::allocator<Key>, Instrumented<>>;
+
+template <typename Container>
+void BM_CountedContains(benchmark::State& state) {
+  auto keys = MakeKeys<int64_t>(state.range(0), KeyOrder::kRandom);
+  Container container(keys.begin(), keys.end());
+  auto queries = MakeKeys<int64_t>(state.range(0), KeyOrder::kRandom, 7);
+
+  for (auto _ : state) {
+    for (auto query : queries) {
+      benchmark::DoNotOptimize(container.contains(query));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+template <typename Container>
+void BM_CountedScan(benchmark::State& state) {
+  auto keys = MakeKeys<int64_t>(state.range(0), KeyOrder::kRandom);
+  Container container(keys.begin(), keys.end());
+
+  for (auto _ : state) {
+    for (const auto& key : container) {
+      benchmark::DoNotOptimize(key);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+} // namespace
+
+#define COUNTED_BENCHMARK_CONTAINER(...)                                                                                 \
+  BENCHMARK(BM_CountedContains<__VA_ARGS__>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMicrosecond); \
+  BENCHMARK(BM_CountedScan<__VA_ARGS__>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMicrosecond);
+
+COUNTED_BENCHMARK_CONTAINER(Set<int64_t>)
+COUNTED_BENCHMARK_CONTAINER(InstrumentedOf<int64_t>)
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+enum class KeyOrder : int64_t {
+  kRandom = 0,
+  kSorted = 1,
+  kReversed = 2,
+};
+
+template <typename Key>
+Key MakeKey(int64_t i);
+
+template <>
+inline int64_t MakeKey<int64_t>(int64_t i) {
+  return i;
+}
+
+template <>
+inline int MakeKey<int>(int64_t i) {
+  return static_cast<int>(i);
+}
+
+// zero padded, so strings sort the same way as the numbers they are made of
+template <>
+inline std::string MakeKey<std::string>(int64_t i) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "key-%016lld", static_cast<long long>(i));
+  return buffer;
+}
+
+// distinct keys 0..count-1 in the requested order
+template <typename Key>
+std::vector<Key> MakeKeys(int64_t count, KeyOrder order, uint32_t seed = 42) {
+  std::vector<int64_t> ids(count);
+  std::iota(ids.begin(), ids.end(), 0);
+
+  if (order == KeyOrder::kRandom) {
+    std::shuffle(ids.begin(), ids.end(), std::mt19937_64{seed});
+  } else if (order == KeyOrder::kReversed) {
+    std::reverse(ids.begin(), ids.end());
+  }
+
+  std::vector<Key> keys;
+  keys.reserve(count);
+  for (auto id : ids) {
+    keys.push_back(MakeKey<Key>(id));
+  }
+
+  return keys;
+}
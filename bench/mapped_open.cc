@@ -0,0 +1,64 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <lib/mapped_set.hpp>
+#include <lib/set.hpp>
+#include <string>
+
+/* Startup from a saved set: inserting the keys one by one against mapping an image,
+ * with and without the checksum pass, and lookups served from the mapping */
+
+namespace {
+
+std::string SaveImage(int64_t count) {
+  auto path = "/tmp/set_bench_" + std::to_string(count) + ".set";
+  auto keys = MakeKeys<int64_t>(count, KeyOrder::kRandom);
+  Set<int64_t>(keys.begin(), keys.end()).save(path);
+  return path;
+}
+
+void BM_LoadByInsert(benchmark::State& state) {
+  auto keys = MakeKeys<int64_t>(state.range(0), KeyOrder::kRandom);
+
+  for (auto _ : state) {
+    Set<int64_t> set;
+    for (auto key : keys) {
+      set.insert(key);
+    }
+    benchmark::DoNotOptimize(set);
+  }
+}
+
+// range(1) selects the checksum pass
+void BM_OpenMapped(benchmark::State& state) {
+  auto path = SaveImage(state.range(0));
+
+  for (auto _ : state) {
+    auto mapped = Set<int64_t>::open_mapped(path, state.range(1) != 0);
+    benchmark::DoNotOptimize(mapped.contains(state.range(0) / 2));
+  }
+
+  std::remove(path.c_str());
+}
+
+void BM_MappedContains(benchmark::State& state) {
+  auto path = SaveImage(state.range(0));
+  auto mapped = Set<int64_t>::open_mapped(path);
+  auto queries = MakeKeys<int64_t>(state.range(0) * 2, KeyOrder::kRandom, 11);
+
+  for (auto _ : state) {
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      benchmark::DoNotOptimize(mapped.contains(queries[i]));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  std::remove(path.c_str());
+}
+
+} // namespace
+
+BENCHMARK(BM_LoadByInsert)->RangeMultiplier(10)->Range(10'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_OpenMapped)->ArgsProduct({{10'000, 100'000, 1'000'000}, {0, 1}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MappedContains)->RangeMultiplier(10)->Range(10'000, 1'000'000)->Unit(benchmark::kMillisecond);
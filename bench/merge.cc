@@ -0,0 +1,56 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <lib/set.hpp>
+#include <string>
+
+namespace {
+
+// rebalancing of two shards: every key of the source moves to the target, half of them
+// interleave with the keys already there
+template <typename Move>
+void RunShardMove(benchmark::State& state, Move move) {
+  auto keys = MakeKeys<std::string>(state.range(0) * 2, KeyOrder::kRandom);
+  auto middle = keys.begin() + state.range(0);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    Set<std::string> target(keys.begin(), middle);
+    Set<std::string> source(middle, keys.end());
+    state.ResumeTiming();
+
+    move(target, source);
+    benchmark::DoNotOptimize(target);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ShardMoveEraseInsert(benchmark::State& state) {
+  RunShardMove(state, [](auto& target, auto& source) {
+    while (!source.empty()) {
+      auto it = source.begin();
+      target.insert(*it);
+      source.erase(it);
+    }
+  });
+}
+
+void BM_ShardMoveExtract(benchmark::State& state) {
+  RunShardMove(state, [](auto& target, auto& source) {
+    while (!source.empty()) {
+      target.insert(source.extract(source.begin()));
+    }
+  });
+}
+
+void BM_ShardMoveMerge(benchmark::State& state) {
+  RunShardMove(state, [](auto& target, auto& source) {
+    target.merge(source);
+  });
+}
+
+} // namespace
+
+BENCHMARK(BM_ShardMoveEraseInsert)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ShardMoveExtract)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ShardMoveMerge)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <cstdint>
+#include <iterator>
+#include <lib/set.hpp>
+#include <set>
+
+namespace {
+
+using RankedSet = Set<int64_t, std::less<int64_t>, std::allocator<int64_t>, OrderStatistic<RedBlack>>;
+
+// p50, p90 and p99 of a live set
+template <typename Container>
+void BM_Percentiles(benchmark::State& state) {
+  auto keys = MakeKeys<int64_t>(state.range(0), KeyOrder::kRandom);
+  Container container(keys.begin(), keys.end());
+
+  for (auto _ : state) {
+    for (auto percent : {50, 90, 99}) {
+      auto k = container.size() * percent / 100;
+      benchmark::DoNotOptimize(*std::next(container.begin(), static_cast<std::ptrdiff_t>(k)));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * 3);
+}
+
+// price of keeping subtree sizes up to date
+template <typename Container>
+void BM_RankedInsert(benchmark::State& state) {
+  auto keys = MakeKeys<int64_t>(state.range(0), KeyOrder::kRandom);
+
+  for (auto _ : state) {
+    Container container;
+    for (auto key : keys) {
+      container.insert(key);
+    }
+    benchmark::DoNotOptimize(container);
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+} // namespace
+
+BENCHMARK(BM_Percentiles<RankedSet>)->RangeMultiplier(10)->Range(1'000, 1'000'000);
+BENCHMARK(BM_Percentiles<std::set<int64_t>>)->RangeMultiplier(10)->Range(1'000, 1'000'000);
+BENCHMARK(BM_RankedInsert<RankedSet>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RankedInsert<Set<int64_t>>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMillisecond);
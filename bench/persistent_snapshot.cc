@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <cstdint>
+#include <lib/persistent_set.hpp>
+#include <lib/set.hpp>
+#include <vector>
+
+/* Cost of a snapshot: a deep copy of Set against an O(1) copy of PersistentSet, and what
+ * the sharing costs the writes, which path copy whenever a snapshot is held */
+
+namespace {
+
+template <typename Container>
+void BM_Snapshot(benchmark::State& state) {
+  auto keys = MakeKeys<int64_t>(state.range(0), KeyOrder::kRandom);
+  Container container(keys.begin(), keys.end());
+
+  for (auto _ : state) {
+    Container snapshot = container;
+    benchmark::DoNotOptimize(snapshot);
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+// every write follows a fresh snapshot when state.range(1) is set, otherwise none is held
+template <typename Container>
+void BM_WriteAfterSnapshot(benchmark::State& state) {
+  auto keys = MakeKeys<int64_t>(state.range(0) * 2, KeyOrder::kRandom);
+  Container container(keys.begin(), keys.begin() + state.range(0));
+  bool snapshots = state.range(1) != 0;
+
+  size_t next = 0;
+  for (auto _ : state) {
+    auto key = keys[state.range(0) + next % state.range(0)];
+    if (snapshots) {
+      Container snapshot = container;
+      container.insert(key);
+      container.erase(key);
+      benchmark::DoNotOptimize(snapshot);
+    } else {
+      container.insert(key);
+      container.erase(key);
+    }
+    ++next;
+  }
+
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+
+} // namespace
+
+BENCHMARK(BM_Snapshot<Set<int64_t>>)->RangeMultiplier(10)->Range(1'000, 100'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Snapshot<PersistentSet<int64_t>>)->RangeMultiplier(10)->Range(1'000, 100'000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_WriteAfterSnapshot<PersistentSet<int64_t>>)->ArgsProduct({{10'000, 1'000'000}, {0, 1}});
+BENCHMARK(BM_WriteAfterSnapshot<Set<int64_t>>)->ArgsProduct({{10'000, 1'000'000}, {0}});
@@ -0,0 +1,124 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <cstdint>
+#include <lib/set.hpp>
+#include <set>
+#include <string>
+
+#ifdef SET_BENCH_WITH_ABSL
+#include <absl/container/btree_set.h>
+#endif
+
+/* Every benchmark takes two arguments: number of keys and KeyOrder of the keys.
+ * Insert and Erase measure the whole batch in the given order, Find looks every key up
+ * in the given order on a prebuilt container, Iterate walks the prebuilt container once */
+
+namespace {
+
+template <typename Container>
+Container Build(const std::vector<typename Container::value_type>& keys) {
+  Container container;
+  for (const auto& key : keys) {
+    container.insert(key);
+  }
+
+  return container;
+}
+
+template <typename Container>
+void BM_Insert(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto keys = MakeKeys<Key>(state.range(0), static_cast<KeyOrder>(state.range(1)));
+
+  for (auto _ : state) {
+    Container container;
+    for (const auto& key : keys) {
+      container.insert(key);
+    }
+
+    state.PauseTiming(); // destruction isn't a part of insertion
+    { auto dropped = std::move(container); }
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+template <typename Container>
+void BM_Find(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto keys = MakeKeys<Key>(state.range(0), static_cast<KeyOrder>(state.range(1)));
+  auto container = Build<Container>(MakeKeys<Key>(state.range(0), KeyOrder::kRandom, 7));
+
+  for (auto _ : state) {
+    for (const auto& key : keys) {
+      benchmark::DoNotOptimize(container.find(key));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+template <typename Container>
+void BM_Erase(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto keys = MakeKeys<Key>(state.range(0), static_cast<KeyOrder>(state.range(1)));
+  auto prebuilt = Build<Container>(MakeKeys<Key>(state.range(0), KeyOrder::kRandom, 7));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto container = prebuilt;
+    state.ResumeTiming();
+
+    for (const auto& key : keys) {
+      container.erase(key);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+template <typename Container>
+void BM_Iterate(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto container = Build<Container>(MakeKeys<Key>(state.range(0), static_cast<KeyOrder>(state.range(1))));
+
+  for (auto _ : state) {
+    for (const auto& key : container) {
+      benchmark::DoNotOptimize(key);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void Sizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"n", "order"});
+  benchmark->ArgsProduct({
+    benchmark::CreateRange(1'000, 10'000'000, 10),
+    {
+      static_cast<int64_t>(KeyOrder::kRandom),
+      static_cast<int64_t>(KeyOrder::kSorted),
+      static_cast<int64_t>(KeyOrder::kReversed),
+    },
+  });
+  benchmark->Unit(benchmark::kMillisecond);
+}
+
+} // namespace
+
+#define SET_BENCHMARK_CONTAINER(...)                  \
+  BENCHMARK(BM_Insert<__VA_ARGS__>)->Apply(Sizes);  \
+  BENCHMARK(BM_Find<__VA_ARGS__>)->Apply(Sizes);    \
+  BENCHMARK(BM_Erase<__VA_ARGS__>)->Apply(Sizes);   \
+  BENCHMARK(BM_Iterate<__VA_ARGS__>)->Apply(Sizes);
+
+SET_BENCHMARK_CONTAINER(Set<int64_t>)
+SET_BENCHMARK_CONTAINER(Set<std::string>)
+SET_BENCHMARK_CONTAINER(std::set<int64_t>)
+SET_BENCHMARK_CONTAINER(std::set<std::string>)
+
+#ifdef SET_BENCH_WITH_ABSL
+SET_BENCHMARK_CONTAINER(absl::btree_set<int64_t>)
+SET_BENCHMARK_CONTAINER(absl::btree_set<std::string>)
+#endif
@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+#include <bench/keys.hpp>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <lib/set.hpp>
+#include <memory>
+#include <set>
+#include <string>
+
+/* Full scans with the parent-climbing iterators against the threaded ones. Keys are
+ * inserted in random order, so neighbours in the scan are scattered over the heap */
+
+namespace {
+
+template <typename Key>
+using ThreadedOf = Set<Key, std::less<Key>, std::allocator<Key>, Threaded<>>;
+
+template <typename Container>
+void BM_ScanForward(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto keys = MakeKeys<Key>(state.range(0), KeyOrder::kRandom);
+  Container container;
+  for (const auto& key : keys) {
+    container.insert(key);
+  }
+
+  for (auto _ : state) {
+    for (const auto& key : container) {
+      benchmark::DoNotOptimize(key);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+template <typename Container>
+void BM_ScanBackward(benchmark::State& state) {
+  using Key = typename Container::value_type;
+  auto keys = MakeKeys<Key>(state.range(0), KeyOrder::kRandom);
+  Container container;
+  for (const auto& key : keys) {
+    container.insert(key);
+  }
+
+  for (auto _ : state) {
+    for (auto it = container.end(); it != container.begin();) {
+      benchmark::DoNotOptimize(*--it);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+} // namespace
+
+#define SCAN_BENCHMARK_CONTAINER(...)                                                                                  \
+  BENCHMARK(BM_ScanForward<__VA_ARGS__>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMicrosecond); \
+  BENCHMARK(BM_ScanBackward<__VA_ARGS__>)->RangeMultiplier(10)->Range(1'000, 1'000'000)->Unit(benchmark::kMicrosecond);
+
+SCAN_BENCHMARK_CONTAINER(Set<int64_t>)
+SCAN_BENCHMARK_CONTAINER(ThreadedOf<int64_t>)
+SCAN_BENCHMARK_CONTAINER(std::set<int64_t>)
+SCAN_BENCHMARK_CONTAINER(Set<std::string>)
+SCAN_BENCHMARK_CONTAINER(ThreadedOf<std::string>)
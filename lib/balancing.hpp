@@ -0,0 +1,387 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+
+#include <lib/node.hpp>
+#include <lib/traversals.hpp>
+
+/* Balancing policies for Set. Each policy is notified after a node was linked
+ * into the tree (OnInsert) and after a node with at most one child was spliced
+ * out of it (OnErase). `header` is the fake "end" node, the real tree is its left subtree.
+ * OnBuild initializes nodes of a tree built bottom-up by halving a sorted sequence,
+ * there every level is full except the deepest one at max_depth.
+ * Policies keep their bookkeeping in Node::balance.
+ * Hooks which rotate are parametrized with the augmentation, which gets to update
+ * its per node data after every rotation, policies wrapping another one pass it on */
+
+// per node data on top of the balancing bookkeeping, node is the type Set allocates
+// and inorder is the traversal of its regular iterators
+struct NoAugment {
+  template <typename T>
+  using node = Node<T>;
+
+  template <typename T>
+  using inorder = InOrder<T>;
+
+  template <typename T>
+  static void Update(Node<T>*) {}
+
+  template <typename T>
+  static void Copy(Node<T>*, const Node<T>*) {}
+};
+
+// augmentation is declared by the policy, plain policies have none
+template <typename Balancing>
+struct AugmentOf {
+  using type = NoAugment;
+};
+
+template <typename Balancing> requires requires { typename Balancing::augment; }
+struct AugmentOf<Balancing> {
+  using type = typename Balancing::augment;
+};
+
+template <typename Augment = NoAugment, typename T>
+void RotateLeft(Node<T>* x) {
+  auto* y = x->right;
+
+  x->right = y->left;
+  if (y->left != nullptr) {
+    y->left->parent = x;
+  }
+
+  y->parent = x->parent;
+  // every real node has a parent, at least the "end" one
+  if (x->parent->left == x) {
+    x->parent->left = y;
+  } else {
+    x->parent->right = y;
+  }
+
+  y->left = x;
+  x->parent = y;
+
+  // x is below y now
+  Augment::Update(x);
+  Augment::Update(y);
+}
+
+template <typename Augment = NoAugment, typename T>
+void RotateRight(Node<T>* x) {
+  auto* y = x->left;
+
+  x->left = y->right;
+  if (y->right != nullptr) {
+    y->right->parent = x;
+  }
+
+  y->parent = x->parent;
+  if (x->parent->left == x) {
+    x->parent->left = y;
+  } else {
+    x->parent->right = y;
+  }
+
+  y->right = x;
+  x->parent = y;
+
+  Augment::Update(x);
+  Augment::Update(y);
+}
+
+// plain binary search tree, shape depends on the insertion order
+struct Unbalanced {
+  template <typename Augment = NoAugment, typename T>
+  static void OnInsert(Node<T>*, Node<T>*) {}
+
+  template <typename Augment = NoAugment, typename T>
+  static void OnErase(Node<T>*, Node<T>*, Node<T>*, bool, Node<T>*) {}
+
+  template <typename T>
+  static void OnBuild(Node<T>*, std::size_t, std::size_t, int, int) {}
+};
+
+// balance field holds the color, freshly constructed nodes are red
+struct RedBlack {
+  static constexpr signed char kRed = 0;
+  static constexpr signed char kBlack = 1;
+
+  template <typename T>
+  static bool IsRed(Node<T>* node) {
+    return node != nullptr && node->balance == kRed;
+  }
+
+  template <typename Augment = NoAugment, typename T>
+  static void OnInsert(Node<T>* node, Node<T>* header) {
+    // parent is red so it's not the root, therefore grandparent is a real node
+    while (node->parent != header && IsRed(node->parent)) {
+      auto* parent = node->parent;
+      auto* grandparent = parent->parent;
+
+      if (parent == grandparent->left) {
+        auto* uncle = grandparent->right;
+
+        if (IsRed(uncle)) {
+          parent->balance = kBlack;
+          uncle->balance = kBlack;
+          grandparent->balance = kRed;
+          node = grandparent;
+          continue;
+        }
+
+        if (node == parent->right) {
+          node = parent;
+          RotateLeft<Augment>(node);
+          parent = node->parent;
+        }
+
+        parent->balance = kBlack;
+        grandparent->balance = kRed;
+        RotateRight<Augment>(grandparent);
+      } else {
+        auto* uncle = grandparent->left;
+
+        if (IsRed(uncle)) {
+          parent->balance = kBlack;
+          uncle->balance = kBlack;
+          grandparent->balance = kRed;
+          node = grandparent;
+          continue;
+        }
+
+        if (node == parent->left) {
+          node = parent;
+          RotateRight<Augment>(node);
+          parent = node->parent;
+        }
+
+        parent->balance = kBlack;
+        grandparent->balance = kRed;
+        RotateLeft<Augment>(grandparent);
+      }
+    }
+
+    header->left->balance = kBlack;
+  }
+
+  template <typename T>
+  static void OnBuild(Node<T>* node, std::size_t, std::size_t, int depth, int max_depth) {
+    // black height is the same on every path when only the (incomplete) deepest level is red
+    node->balance = depth == max_depth && depth > 0 ? kRed : kBlack;
+  }
+
+  template <typename Augment = NoAugment, typename T>
+  static void OnErase(Node<T>* removed, Node<T>* child, Node<T>* parent, bool was_left, Node<T>* header) {
+    if (removed->balance == kRed) {
+      return; // black heights didn't change
+    }
+
+    // child carries an extra black, push it up until it can be absorbed
+    while (child != header->left && !IsRed(child)) {
+      if (was_left) {
+        auto* sibling = parent->right;
+
+        if (IsRed(sibling)) {
+          sibling->balance = kBlack;
+          parent->balance = kRed;
+          RotateLeft<Augment>(parent);
+          sibling = parent->right;
+        }
+
+        if (!IsRed(sibling->left) && !IsRed(sibling->right)) {
+          sibling->balance = kRed;
+          child = parent;
+          parent = parent->parent;
+          was_left = parent->left == child;
+          continue;
+        }
+
+        if (!IsRed(sibling->right)) {
+          sibling->left->balance = kBlack;
+          sibling->balance = kRed;
+          RotateRight<Augment>(sibling);
+          sibling = parent->right;
+        }
+
+        sibling->balance = parent->balance;
+        parent->balance = kBlack;
+        sibling->right->balance = kBlack;
+        RotateLeft<Augment>(parent);
+        child = header->left;
+      } else {
+        auto* sibling = parent->left;
+
+        if (IsRed(sibling)) {
+          sibling->balance = kBlack;
+          parent->balance = kRed;
+          RotateRight<Augment>(parent);
+          sibling = parent->left;
+        }
+
+        if (!IsRed(sibling->left) && !IsRed(sibling->right)) {
+          sibling->balance = kRed;
+          child = parent;
+          parent = parent->parent;
+          was_left = parent->left == child;
+          continue;
+        }
+
+        if (!IsRed(sibling->left)) {
+          sibling->right->balance = kBlack;
+          sibling->balance = kRed;
+          RotateLeft<Augment>(sibling);
+          sibling = parent->left;
+        }
+
+        sibling->balance = parent->balance;
+        parent->balance = kBlack;
+        sibling->left->balance = kBlack;
+        RotateRight<Augment>(parent);
+        child = header->left;
+      }
+    }
+
+    if (child != nullptr) {
+      child->balance = kBlack;
+    }
+  }
+};
+
+// balance field holds height(right) - height(left), always in [-1, 1]
+struct Avl {
+  template <typename Augment = NoAugment, typename T>
+  static void OnInsert(Node<T>* node, Node<T>* header) {
+    // climb while the height of the subtree rooted at node has grown
+    while (node->parent != header) {
+      auto* parent = node->parent;
+
+      if (node == parent->left) {
+        if (parent->balance == 1) {
+          parent->balance = 0;
+          return;
+        }
+
+        if (parent->balance == 0) {
+          parent->balance = -1;
+          node = parent;
+          continue;
+        }
+
+        FixLeftHeavy<Augment>(parent);
+        return;
+      } else {
+        if (parent->balance == -1) {
+          parent->balance = 0;
+          return;
+        }
+
+        if (parent->balance == 0) {
+          parent->balance = 1;
+          node = parent;
+          continue;
+        }
+
+        FixRightHeavy<Augment>(parent);
+        return;
+      }
+    }
+  }
+
+  template <typename T>
+  static void OnBuild(Node<T>* node, std::size_t left_size, std::size_t right_size, int, int) {
+    // height of such a subtree only depends on its size
+    node->balance = static_cast<signed char>(std::bit_width(right_size) - std::bit_width(left_size));
+  }
+
+  template <typename Augment = NoAugment, typename T>
+  static void OnErase(Node<T>*, Node<T>*, Node<T>* parent, bool was_left, Node<T>* header) {
+    // climb while the height of the subtree on the `was_left` side of parent has shrunk
+    while (parent != header) {
+      if (was_left) {
+        if (parent->balance == -1) {
+          parent->balance = 0;
+        } else if (parent->balance == 0) {
+          parent->balance = 1;
+          return;
+        } else {
+          bool height_kept = parent->right->balance == 0;
+          parent = FixRightHeavy<Augment>(parent);
+          if (height_kept) return;
+        }
+      } else {
+        if (parent->balance == 1) {
+          parent->balance = 0;
+        } else if (parent->balance == 0) {
+          parent->balance = -1;
+          return;
+        } else {
+          bool height_kept = parent->left->balance == 0;
+          parent = FixLeftHeavy<Augment>(parent);
+          if (height_kept) return;
+        }
+      }
+
+      was_left = parent->parent->left == parent;
+      parent = parent->parent;
+    }
+  }
+
+private:
+  // node's left subtree is two levels higher than the right one, returns new subtree root
+  template <typename Augment, typename T>
+  static Node<T>* FixLeftHeavy(Node<T>* node) {
+    auto* left = node->left;
+
+    if (left->balance <= 0) {
+      RotateRight<Augment>(node);
+      if (left->balance == 0) { // only possible after erasure
+        left->balance = 1;
+        node->balance = -1;
+      } else {
+        left->balance = 0;
+        node->balance = 0;
+      }
+
+      return left;
+    }
+
+    auto* pivot = left->right;
+    RotateLeft<Augment>(left);
+    RotateRight<Augment>(node);
+
+    left->balance = pivot->balance == 1 ? -1 : 0;
+    node->balance = pivot->balance == -1 ? 1 : 0;
+    pivot->balance = 0;
+
+    return pivot;
+  }
+
+  template <typename Augment, typename T>
+  static Node<T>* FixRightHeavy(Node<T>* node) {
+    auto* right = node->right;
+
+    if (right->balance >= 0) {
+      RotateLeft<Augment>(node);
+      if (right->balance == 0) {
+        right->balance = -1;
+        node->balance = 1;
+      } else {
+        right->balance = 0;
+        node->balance = 0;
+      }
+
+      return right;
+    }
+
+    auto* pivot = right->left;
+    RotateRight<Augment>(right);
+    RotateLeft<Augment>(node);
+
+    right->balance = pivot->balance == -1 ? 1 : 0;
+    node->balance = pivot->balance == 1 ? -1 : 0;
+    pivot->balance = 0;
+
+    return pivot;
+  }
+};
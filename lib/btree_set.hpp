@@ -0,0 +1,1041 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include <lib/comparator.hpp>
+#include <lib/simd_search.hpp>
+
+/* B+-tree engine for Set: keys live in wide leaves chained into a list, inner nodes hold
+ * copies of keys as separators. A node takes NodeBytes, a whole number of cache lines,
+ * so a lookup touches a few lines per level and only log_B(n) levels. Selected as
+ * Set<Key, Comparator, Alloc, BTree<NodeBytes>>, which exposes BTreeSet under the usual name */
+template <std::size_t NodeBytes = 256>
+struct BTree {
+  static_assert(NodeBytes % 64 == 0, "B-tree nodes are made of whole cache lines");
+};
+
+struct BTreeNode {
+  std::uint32_t count = 0; // keys in a leaf, separators in an inner node
+};
+
+// keys are constructed in place, only the first count of them are alive
+template <typename Key, std::size_t NodeBytes>
+struct BTreeLeaf : BTreeNode {
+  static constexpr std::uint32_t kCapacity = std::max<std::size_t>(
+    4, (NodeBytes - sizeof(BTreeNode) - 2 * sizeof(void*)) / sizeof(Key));
+  static constexpr std::uint32_t kMinCount = kCapacity / 2;
+
+  Key* keys() {
+    return std::launder(reinterpret_cast<Key*>(storage));
+  }
+
+  const Key* keys() const {
+    return std::launder(reinterpret_cast<const Key*>(storage));
+  }
+
+  // leaves form a circular list through the "end" leaf of the set, which holds no keys
+  BTreeLeaf* prev = this;
+  BTreeLeaf* next = this;
+  alignas(Key) std::byte storage[kCapacity * sizeof(Key)];
+};
+
+// child i holds keys in [separator i - 1, separator i)
+template <typename Key, std::size_t NodeBytes>
+struct BTreeInner : BTreeNode {
+  static constexpr std::uint32_t kCapacity = std::max<std::size_t>(
+    4, (NodeBytes - sizeof(BTreeNode) - sizeof(void*)) / (sizeof(Key) + sizeof(void*)));
+  static constexpr std::uint32_t kMinCount = (kCapacity - 1) / 2;
+
+  Key* keys() {
+    return std::launder(reinterpret_cast<Key*>(storage));
+  }
+
+  const Key* keys() const {
+    return std::launder(reinterpret_cast<const Key*>(storage));
+  }
+
+  alignas(Key) std::byte storage[kCapacity * sizeof(Key)];
+  BTreeNode* children[kCapacity + 1];
+};
+
+// walks the leaf list, the "end" leaf with index 0 is the end
+template <typename Key, typename Leaf>
+struct BTreeIterator {
+  BTreeIterator() = default;
+  BTreeIterator(Leaf* leaf, std::uint32_t index) : leaf_{leaf}, index_{index} {}
+
+  using value_type = Key;
+  using difference_type = std::ptrdiff_t;
+  using reference = const Key&;
+  using pointer = const Key*;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  reference operator*() const;
+  pointer operator->() const;
+
+  BTreeIterator& operator++();
+  BTreeIterator& operator--();
+  BTreeIterator operator++(int);
+  BTreeIterator operator--(int);
+
+  bool operator==(const BTreeIterator& other) const;
+
+  Leaf* leaf() const;
+  std::uint32_t index() const;
+
+private:
+  Leaf* leaf_ = nullptr;
+  std::uint32_t index_ = 0;
+};
+
+template <typename Key, typename Leaf>
+typename BTreeIterator<Key, Leaf>::reference BTreeIterator<Key, Leaf>::operator*() const {
+  return leaf_->keys()[index_];
+}
+
+template <typename Key, typename Leaf>
+typename BTreeIterator<Key, Leaf>::pointer BTreeIterator<Key, Leaf>::operator->() const {
+  return leaf_->keys() + index_;
+}
+
+template <typename Key, typename Leaf>
+BTreeIterator<Key, Leaf>& BTreeIterator<Key, Leaf>::operator++() {
+  if (++index_ == leaf_->count) {
+    leaf_ = leaf_->next;
+    index_ = 0;
+  }
+
+  return *this;
+}
+
+template <typename Key, typename Leaf>
+BTreeIterator<Key, Leaf>& BTreeIterator<Key, Leaf>::operator--() {
+  if (index_ == 0) {
+    leaf_ = leaf_->prev;
+    index_ = leaf_->count;
+  }
+
+  --index_;
+  return *this;
+}
+
+template <typename Key, typename Leaf>
+BTreeIterator<Key, Leaf> BTreeIterator<Key, Leaf>::operator++(int) {
+  auto copy = *this;
+  ++*this;
+  return copy;
+}
+
+template <typename Key, typename Leaf>
+BTreeIterator<Key, Leaf> BTreeIterator<Key, Leaf>::operator--(int) {
+  auto copy = *this;
+  --*this;
+  return copy;
+}
+
+template <typename Key, typename Leaf>
+bool BTreeIterator<Key, Leaf>::operator==(const BTreeIterator& other) const {
+  return leaf_ == other.leaf_ && index_ == other.index_;
+}
+
+template <typename Key, typename Leaf>
+Leaf* BTreeIterator<Key, Leaf>::leaf() const {
+  return leaf_;
+}
+
+template <typename Key, typename Leaf>
+std::uint32_t BTreeIterator<Key, Leaf>::index() const {
+  return index_;
+}
+
+/* Keys have to be copyable, separators are copies of keys.
+ * Inserting or erasing a key moves its neighbours within and between leaves,
+ * so unlike with the binary trees every modification invalidates iterators */
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+class BTreeSet {
+public:
+  using value_type = Key;
+  using key_type = Key;
+  using key_compare = Comparator;
+  using value_compare = Comparator;
+  using reference = const Key&;
+  using const_reference = const Key&;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  using leaf_type = BTreeLeaf<Key, NodeBytes>;
+  using inner_type = BTreeInner<Key, NodeBytes>;
+  using allocator_type = std::allocator_traits<Alloc>::template rebind_alloc<leaf_type>;
+
+  using iterator = BTreeIterator<Key, leaf_type>;
+  using const_iterator = iterator;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = reverse_iterator;
+
+  BTreeSet() = default;
+  ~BTreeSet();
+
+  BTreeSet(const BTreeSet& other);
+  BTreeSet(BTreeSet&& other) noexcept;
+
+  template <std::input_iterator It>
+  BTreeSet(It first, It last);
+  BTreeSet(std::initializer_list<Key> keys);
+
+  BTreeSet& operator=(const BTreeSet& other);
+  BTreeSet& operator=(BTreeSet&& other) noexcept;
+
+  void swap(BTreeSet& other) noexcept;
+
+  [[nodiscard]] const_iterator begin() const;
+  [[nodiscard]] const_iterator end() const;
+  [[nodiscard]] const_iterator cbegin() const;
+  [[nodiscard]] const_iterator cend() const;
+  [[nodiscard]] const_reverse_iterator rbegin() const;
+  [[nodiscard]] const_reverse_iterator rend() const;
+
+  template <typename... Args>
+  std::pair<bool, iterator> emplace(Args&&... args);
+
+  std::pair<bool, iterator> insert(const Key& key);
+  std::pair<bool, iterator> insert(Key&& key);
+
+  template <std::input_iterator It>
+  void insert(It first, It last);
+  void insert(std::initializer_list<Key> keys);
+
+  size_type erase(const Key& key);
+  const_iterator erase(const_iterator it);
+  void clear();
+
+  [[nodiscard]] const_iterator find(const Key& key) const;
+  [[nodiscard]] bool contains(const Key& key) const;
+  [[nodiscard]] const_iterator lower_bound(const Key& key) const;
+  [[nodiscard]] const_iterator upper_bound(const Key& key) const;
+  [[nodiscard]] std::pair<const_iterator, const_iterator> equal_range(const Key& key) const;
+
+  // overloads below accept anything comparable with Key, if the comparator is transparent
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] const_iterator find(const K& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] bool contains(const K& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] const_iterator lower_bound(const K& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] const_iterator upper_bound(const K& key) const;
+
+  [[nodiscard]] size_type size() const;
+  [[nodiscard]] bool empty() const;
+
+  // number of levels, 0 for an empty set
+  [[nodiscard]] size_type height() const;
+
+private:
+  using inner_allocator_type = std::allocator_traits<Alloc>::template rebind_alloc<inner_type>;
+
+  // inner node on the way down to a leaf and the child taken there
+  struct PathEntry {
+    inner_type* node;
+    std::uint32_t index;
+  };
+
+  // a node has at least two children, so 2^64 keys fit into 64 levels
+  using Path = std::array<PathEntry, 64>;
+
+  // searches inside of a node: vector compares for arithmetic keys under < or >,
+  // a branchless binary search running log2(count) times without jumps for the rest
+  template <typename K>
+  std::uint32_t LowerBoundIn(const Key* keys, std::uint32_t count, const K& key) const;
+
+  template <typename K>
+  std::uint32_t UpperBoundIn(const Key* keys, std::uint32_t count, const K& key) const;
+
+  // leaf which might hold key, every separator equal to key leads right
+  template <typename K>
+  const leaf_type* FindLeaf(const K& key) const;
+
+  template <typename K>
+  iterator FindKey(const K& key) const;
+
+  template <typename K>
+  iterator LowerBoundKey(const K& key) const;
+
+  template <typename K>
+  iterator UpperBoundKey(const K& key) const;
+
+  // index past the last key of a leaf means the first key of the next one
+  iterator Normalize(leaf_type* leaf, std::uint32_t index) const;
+
+  std::pair<bool, iterator> InsertKey(Key&& key);
+  void SplitLeaf(inner_type* parent, std::uint32_t index);
+  void SplitInner(inner_type* parent, std::uint32_t index);
+  inner_type* GrowRoot();
+
+  template <typename K>
+  size_type EraseKey(const K& key);
+  iterator EraseAt(const Path& path, std::uint32_t depth, leaf_type* leaf, std::uint32_t index);
+  void FixInner(const Path& path, std::uint32_t depth);
+
+  // separator index and the child right of it leave the node
+  void RemoveSeparator(inner_type* node, std::uint32_t index);
+
+  leaf_type* ConstructLeaf();
+  inner_type* ConstructInner();
+  void DropLeaf(leaf_type* leaf);
+  void DropInner(inner_type* inner);
+  void DropSubtree(BTreeNode* node, size_type level);
+  void RelinkHeader();
+
+  Comparator comparator_;
+  allocator_type allocator_;
+  inner_allocator_type inner_allocator_{allocator_};
+
+  leaf_type header_;               // "end" leaf, first and last leaves link to it
+  BTreeNode* root_ = nullptr;
+  size_type height_ = 0;           // leaves are at level 1
+  size_type size_ = 0;
+};
+
+namespace btree_detail {
+
+// room for value at pos, keys [pos, count) move one slot right
+template <typename Key, typename V>
+void InsertAt(Key* keys, std::uint32_t count, std::uint32_t pos, V&& value) {
+  if (pos == count) {
+    std::construct_at(keys + count, std::forward<V>(value));
+    return;
+  }
+
+  std::construct_at(keys + count, std::move(keys[count - 1]));
+  std::move_backward(keys + pos, keys + count - 1, keys + count);
+  keys[pos] = std::forward<V>(value);
+}
+
+template <typename Key>
+void EraseAt(Key* keys, std::uint32_t count, std::uint32_t pos) {
+  std::move(keys + pos + 1, keys + count, keys + pos);
+  std::destroy_at(keys + count - 1);
+}
+
+// n keys move into uninitialized slots, the source slots end up destroyed
+template <typename Key>
+void Relocate(Key* from, std::uint32_t n, Key* to) {
+  std::uninitialized_move_n(from, n, to);
+  std::destroy_n(from, n);
+}
+
+} // namespace btree_detail
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+BTreeSet<Key, Comparator, Alloc, NodeBytes>::~BTreeSet() {
+  clear();
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+BTreeSet<Key, Comparator, Alloc, NodeBytes>::BTreeSet(const BTreeSet& other)
+  : comparator_{other.comparator_},
+    allocator_{std::allocator_traits<allocator_type>::select_on_container_copy_construction(other.allocator_)} {
+  try {
+    for (const auto& key : other) {
+      insert(key);
+    }
+  } catch (...) {
+    clear(); // destructor won't be called for a throwing constructor
+    throw;
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+BTreeSet<Key, Comparator, Alloc, NodeBytes>::BTreeSet(BTreeSet&& other) noexcept
+  : comparator_{other.comparator_},
+    allocator_{other.allocator_},
+    inner_allocator_{other.inner_allocator_},
+    root_{std::exchange(other.root_, nullptr)},
+    height_{std::exchange(other.height_, 0)},
+    size_{std::exchange(other.size_, 0)} {
+  // leaves are taken over, both "end" leaves are part of the wrong lists now
+  std::swap(header_.prev, other.header_.prev);
+  std::swap(header_.next, other.header_.next);
+  RelinkHeader();
+  other.RelinkHeader();
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <std::input_iterator It>
+BTreeSet<Key, Comparator, Alloc, NodeBytes>::BTreeSet(It first, It last) {
+  try {
+    insert(first, last);
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+BTreeSet<Key, Comparator, Alloc, NodeBytes>::BTreeSet(std::initializer_list<Key> keys)
+  : BTreeSet(keys.begin(), keys.end()) {
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+BTreeSet<Key, Comparator, Alloc, NodeBytes>& BTreeSet<Key, Comparator, Alloc, NodeBytes>::operator=(const BTreeSet& other) {
+  if (this != &other) {
+    BTreeSet copy(other);
+    swap(copy);
+  }
+
+  return *this;
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+BTreeSet<Key, Comparator, Alloc, NodeBytes>& BTreeSet<Key, Comparator, Alloc, NodeBytes>::operator=(BTreeSet&& other) noexcept {
+  if (this != &other) {
+    swap(other);
+  }
+
+  return *this;
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+void BTreeSet<Key, Comparator, Alloc, NodeBytes>::swap(BTreeSet& other) noexcept {
+  std::swap(comparator_, other.comparator_);
+  std::swap(allocator_, other.allocator_);
+  std::swap(inner_allocator_, other.inner_allocator_);
+  std::swap(root_, other.root_);
+  std::swap(height_, other.height_);
+  std::swap(size_, other.size_);
+  std::swap(header_.prev, other.header_.prev);
+  std::swap(header_.next, other.header_.next);
+  RelinkHeader();
+  other.RelinkHeader();
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+void BTreeSet<Key, Comparator, Alloc, NodeBytes>::RelinkHeader() {
+  if (root_ == nullptr) {
+    header_.prev = &header_;
+    header_.next = &header_;
+    return;
+  }
+
+  header_.next->prev = &header_;
+  header_.prev->next = &header_;
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::leaf_type* BTreeSet<Key, Comparator, Alloc, NodeBytes>::ConstructLeaf() {
+  auto* ptr = allocator_.allocate(1);
+  ::new (static_cast<void*>(ptr)) leaf_type();
+  return ptr;
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::inner_type* BTreeSet<Key, Comparator, Alloc, NodeBytes>::ConstructInner() {
+  auto* ptr = inner_allocator_.allocate(1);
+  ::new (static_cast<void*>(ptr)) inner_type();
+  return ptr;
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+void BTreeSet<Key, Comparator, Alloc, NodeBytes>::DropLeaf(leaf_type* leaf) {
+  std::destroy_n(leaf->keys(), leaf->count);
+  leaf->prev->next = leaf->next;
+  leaf->next->prev = leaf->prev;
+  allocator_.deallocate(leaf, 1);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+void BTreeSet<Key, Comparator, Alloc, NodeBytes>::DropInner(inner_type* inner) {
+  std::destroy_n(inner->keys(), inner->count);
+  inner_allocator_.deallocate(inner, 1);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+void BTreeSet<Key, Comparator, Alloc, NodeBytes>::DropSubtree(BTreeNode* node, size_type level) {
+  // recursion is only as deep as the tree is high
+  if (level == 1) {
+    DropLeaf(static_cast<leaf_type*>(node));
+    return;
+  }
+
+  auto* inner = static_cast<inner_type*>(node);
+  for (std::uint32_t i = 0; i <= inner->count; ++i) {
+    DropSubtree(inner->children[i], level - 1);
+  }
+
+  DropInner(inner);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+void BTreeSet<Key, Comparator, Alloc, NodeBytes>::clear() {
+  if (root_ != nullptr) {
+    DropSubtree(root_, height_);
+  }
+
+  root_ = nullptr;
+  height_ = 0;
+  size_ = 0;
+  RelinkHeader();
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <typename K>
+std::uint32_t BTreeSet<Key, Comparator, Alloc, NodeBytes>::LowerBoundIn(const Key* keys, std::uint32_t count, const K& key) const {
+  if constexpr (SimdSearchable<Key, Comparator> && std::same_as<K, Key>) {
+    return SimdLowerBound<Comparator>(keys, count, key);
+  }
+
+  if (count == 0) {
+    return 0;
+  }
+
+  // answer stays in [base, base + n], the conditional move compiles to cmov for arithmetic keys
+  const Key* base = keys;
+  for (auto n = count; n > 1;) {
+    auto half = n / 2;
+    base = comparator_(base[half - 1], key) ? base + half : base;
+    n -= half;
+  }
+
+  return static_cast<std::uint32_t>(base - keys) + (comparator_(*base, key) ? 1 : 0);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <typename K>
+std::uint32_t BTreeSet<Key, Comparator, Alloc, NodeBytes>::UpperBoundIn(const Key* keys, std::uint32_t count, const K& key) const {
+  if constexpr (SimdSearchable<Key, Comparator> && std::same_as<K, Key>) {
+    return SimdUpperBound<Comparator>(keys, count, key);
+  }
+
+  if (count == 0) {
+    return 0;
+  }
+
+  const Key* base = keys;
+  for (auto n = count; n > 1;) {
+    auto half = n / 2;
+    base = comparator_(key, base[half - 1]) ? base : base + half;
+    n -= half;
+  }
+
+  return static_cast<std::uint32_t>(base - keys) + (comparator_(key, *base) ? 0 : 1);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <typename K>
+const typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::leaf_type* BTreeSet<Key, Comparator, Alloc, NodeBytes>::FindLeaf(const K& key) const {
+  const BTreeNode* node = root_;
+
+  for (auto level = height_; level > 1; --level) {
+    auto* inner = static_cast<const inner_type*>(node);
+    node = inner->children[UpperBoundIn(inner->keys(), inner->count, key)];
+  }
+
+  return static_cast<const leaf_type*>(node);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::Normalize(leaf_type* leaf, std::uint32_t index) const {
+  if (index == leaf->count) {
+    return iterator(leaf->next, 0);
+  }
+
+  return iterator(leaf, index);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <typename K>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::FindKey(const K& key) const {
+  if (root_ == nullptr) {
+    return end();
+  }
+
+  // iterators hand out const keys only, the set itself is never modified through them
+  auto* leaf = const_cast<leaf_type*>(FindLeaf(key));
+  auto index = LowerBoundIn(leaf->keys(), leaf->count, key);
+
+  if (index == leaf->count || comparator_(key, leaf->keys()[index])) {
+    return end();
+  }
+
+  return iterator(leaf, index);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <typename K>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::LowerBoundKey(const K& key) const {
+  if (root_ == nullptr) {
+    return end();
+  }
+
+  auto* leaf = const_cast<leaf_type*>(FindLeaf(key));
+  return Normalize(leaf, LowerBoundIn(leaf->keys(), leaf->count, key));
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <typename K>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::UpperBoundKey(const K& key) const {
+  if (root_ == nullptr) {
+    return end();
+  }
+
+  auto* leaf = const_cast<leaf_type*>(FindLeaf(key));
+  return Normalize(leaf, UpperBoundIn(leaf->keys(), leaf->count, key));
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::begin() const {
+  return const_iterator(header_.next, 0);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::end() const {
+  return const_iterator(const_cast<leaf_type*>(&header_), 0);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::cbegin() const {
+  return begin();
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::cend() const {
+  return end();
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_reverse_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::rbegin() const {
+  return const_reverse_iterator(end());
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_reverse_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::rend() const {
+  return const_reverse_iterator(begin());
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <typename... Args>
+std::pair<bool, typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::iterator> BTreeSet<Key, Comparator, Alloc, NodeBytes>::emplace(Args&&... args) {
+  return InsertKey(Key{std::forward<Args>(args)...});
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+std::pair<bool, typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::iterator> BTreeSet<Key, Comparator, Alloc, NodeBytes>::insert(const Key& key) {
+  // copied before the search, a throwing copy can't leave a half shifted leaf behind
+  return InsertKey(Key(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+std::pair<bool, typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::iterator> BTreeSet<Key, Comparator, Alloc, NodeBytes>::insert(Key&& key) {
+  return InsertKey(std::move(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <std::input_iterator It>
+void BTreeSet<Key, Comparator, Alloc, NodeBytes>::insert(It first, It last) {
+  for (; first != last; ++first) {
+    emplace(*first);
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+void BTreeSet<Key, Comparator, Alloc, NodeBytes>::insert(std::initializer_list<Key> keys) {
+  insert(keys.begin(), keys.end());
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::inner_type* BTreeSet<Key, Comparator, Alloc, NodeBytes>::GrowRoot() {
+  auto* root = ConstructInner();
+  root->children[0] = root_;
+  root_ = root;
+  ++height_;
+  return root;
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+void BTreeSet<Key, Comparator, Alloc, NodeBytes>::SplitLeaf(inner_type* parent, std::uint32_t index) {
+  auto* leaf = static_cast<leaf_type*>(parent->children[index]);
+  auto* right = ConstructLeaf();
+
+  // separator goes in first, it's the only step which may throw. right isn't linked
+  // anywhere yet, so it's simply given back then
+  auto half = leaf->count / 2;
+  try {
+    btree_detail::InsertAt(parent->keys(), parent->count, index, leaf->keys()[half]);
+  } catch (...) {
+    allocator_.deallocate(right, 1);
+    throw;
+  }
+
+  btree_detail::Relocate(leaf->keys() + half, leaf->count - half, right->keys());
+  right->count = leaf->count - half;
+  leaf->count = half;
+
+  right->prev = leaf;
+  right->next = leaf->next;
+  leaf->next->prev = right;
+  leaf->next = right;
+
+  std::copy_backward(parent->children + index + 1, parent->children + parent->count + 1, parent->children + parent->count + 2);
+  parent->children[index + 1] = right;
+  ++parent->count;
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+void BTreeSet<Key, Comparator, Alloc, NodeBytes>::SplitInner(inner_type* parent, std::uint32_t index) {
+  auto* node = static_cast<inner_type*>(parent->children[index]);
+  auto* right = ConstructInner();
+
+  // separator in the middle moves up, the ones after it go right together with their children
+  auto middle = node->count / 2;
+  try {
+    btree_detail::InsertAt(parent->keys(), parent->count, index, std::move(node->keys()[middle]));
+  } catch (...) {
+    inner_allocator_.deallocate(right, 1);
+    throw;
+  }
+  std::destroy_at(node->keys() + middle);
+
+  right->count = node->count - middle - 1;
+  btree_detail::Relocate(node->keys() + middle + 1, right->count, right->keys());
+  std::copy(node->children + middle + 1, node->children + node->count + 1, right->children);
+  node->count = middle;
+
+  std::copy_backward(parent->children + index + 1, parent->children + parent->count + 1, parent->children + parent->count + 2);
+  parent->children[index + 1] = right;
+  ++parent->count;
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+std::pair<bool, typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::iterator> BTreeSet<Key, Comparator, Alloc, NodeBytes>::InsertKey(Key&& key) {
+  if (root_ == nullptr) {
+    auto* leaf = ConstructLeaf();
+    leaf->prev = &header_;
+    leaf->next = &header_;
+    header_.prev = leaf;
+    header_.next = leaf;
+    root_ = leaf;
+    height_ = 1;
+  }
+
+  // full inner nodes are split on the way down, so a splitting child always has room in its parent
+  if (height_ > 1 && root_->count == inner_type::kCapacity) {
+    SplitInner(GrowRoot(), 0);
+  }
+
+  inner_type* parent = nullptr;
+  std::uint32_t child = 0;
+  BTreeNode* node = root_;
+
+  for (auto level = height_; level > 1; --level) {
+    parent = static_cast<inner_type*>(node);
+    child = UpperBoundIn(parent->keys(), parent->count, key);
+
+    if (level > 2 && parent->children[child]->count == inner_type::kCapacity) {
+      SplitInner(parent, child);
+      if (!comparator_(key, parent->keys()[child])) {
+        ++child;
+      }
+    }
+
+    node = parent->children[child];
+  }
+
+  auto* leaf = static_cast<leaf_type*>(node);
+  auto index = LowerBoundIn(leaf->keys(), leaf->count, key);
+
+  if (index != leaf->count && !comparator_(key, leaf->keys()[index])) {
+    return { false, iterator(leaf, index) };
+  }
+
+  // leaves are split only when a key really goes in, so failed inserts keep iterators valid
+  if (leaf->count == leaf_type::kCapacity) {
+    if (parent == nullptr) {
+      parent = GrowRoot();
+    }
+
+    SplitLeaf(parent, child);
+    if (index > leaf->count) {
+      index -= leaf->count;
+      leaf = leaf->next;
+    }
+  }
+
+  btree_detail::InsertAt(leaf->keys(), leaf->count, index, std::move(key));
+  ++leaf->count;
+  ++size_;
+  return { true, iterator(leaf, index) };
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::size_type BTreeSet<Key, Comparator, Alloc, NodeBytes>::erase(const Key& key) {
+  return EraseKey(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::erase(const_iterator it) {
+  // path is found again from the root, leaves don't know their parents
+  Path path;
+  BTreeNode* node = root_;
+  std::uint32_t depth = 0;
+
+  for (auto level = height_; level > 1; --level, ++depth) {
+    auto* inner = static_cast<inner_type*>(node);
+    path[depth] = { inner, UpperBoundIn(inner->keys(), inner->count, *it) };
+    node = inner->children[path[depth].index];
+  }
+
+  assert(node == it.leaf());
+  return EraseAt(path, depth, it.leaf(), it.index());
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <typename K>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::size_type BTreeSet<Key, Comparator, Alloc, NodeBytes>::EraseKey(const K& key) {
+  if (root_ == nullptr) {
+    return 0;
+  }
+
+  Path path;
+  BTreeNode* node = root_;
+  std::uint32_t depth = 0;
+
+  for (auto level = height_; level > 1; --level, ++depth) {
+    auto* inner = static_cast<inner_type*>(node);
+    path[depth] = { inner, UpperBoundIn(inner->keys(), inner->count, key) };
+    node = inner->children[path[depth].index];
+  }
+
+  auto* leaf = static_cast<leaf_type*>(node);
+  auto index = LowerBoundIn(leaf->keys(), leaf->count, key);
+
+  if (index == leaf->count || comparator_(key, leaf->keys()[index])) {
+    return 0;
+  }
+
+  EraseAt(path, depth, leaf, index);
+  return 1;
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::EraseAt(const Path& path, std::uint32_t depth, leaf_type* leaf, std::uint32_t index) {
+  // separators equal to the erased key may stay, they still split the keys correctly
+  btree_detail::EraseAt(leaf->keys(), leaf->count, index);
+  --leaf->count;
+  --size_;
+
+  if (depth == 0) {
+    if (leaf->count == 0) {
+      DropLeaf(leaf);
+      root_ = nullptr;
+      height_ = 0;
+      return end();
+    }
+
+    return Normalize(leaf, index);
+  }
+
+  if (leaf->count >= leaf_type::kMinCount) {
+    return Normalize(leaf, index);
+  }
+
+  // index follows the key after the erased one through borrowing and merging
+  auto [parent, child] = path[depth - 1];
+  auto* left = child > 0 ? static_cast<leaf_type*>(parent->children[child - 1]) : nullptr;
+  auto* right = child < parent->count ? static_cast<leaf_type*>(parent->children[child + 1]) : nullptr;
+
+  if (left != nullptr && left->count > leaf_type::kMinCount) {
+    btree_detail::InsertAt(leaf->keys(), leaf->count, 0, std::move(left->keys()[left->count - 1]));
+    std::destroy_at(left->keys() + left->count - 1);
+    --left->count;
+    ++leaf->count;
+    parent->keys()[child - 1] = leaf->keys()[0];
+    return Normalize(leaf, index + 1);
+  }
+
+  if (right != nullptr && right->count > leaf_type::kMinCount) {
+    std::construct_at(leaf->keys() + leaf->count, std::move(right->keys()[0]));
+    btree_detail::EraseAt(right->keys(), right->count, 0);
+    --right->count;
+    ++leaf->count;
+    parent->keys()[child] = right->keys()[0];
+    return Normalize(leaf, index);
+  }
+
+  if (left != nullptr) {
+    btree_detail::Relocate(leaf->keys(), leaf->count, left->keys() + left->count);
+    index += left->count;
+    left->count += leaf->count;
+    leaf->count = 0;
+    DropLeaf(leaf);
+    RemoveSeparator(parent, child - 1);
+    leaf = left;
+  } else {
+    btree_detail::Relocate(right->keys(), right->count, leaf->keys() + leaf->count);
+    leaf->count += right->count;
+    right->count = 0;
+    DropLeaf(right);
+    RemoveSeparator(parent, child);
+  }
+
+  FixInner(path, depth - 1);
+  return Normalize(leaf, index);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+void BTreeSet<Key, Comparator, Alloc, NodeBytes>::RemoveSeparator(inner_type* node, std::uint32_t index) {
+  btree_detail::EraseAt(node->keys(), node->count, index);
+  std::copy(node->children + index + 2, node->children + node->count + 1, node->children + index + 1);
+  --node->count;
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+void BTreeSet<Key, Comparator, Alloc, NodeBytes>::FixInner(const Path& path, std::uint32_t depth) {
+  // node at path[depth] lost a child, underfull nodes borrow through the parent or merge
+  while (true) {
+    auto* node = path[depth].node;
+
+    if (depth == 0) {
+      if (node->count == 0) {
+        root_ = node->children[0];
+        --height_;
+        DropInner(node);
+      }
+
+      return;
+    }
+
+    if (node->count >= inner_type::kMinCount) {
+      return;
+    }
+
+    auto [parent, child] = path[depth - 1];
+    auto* left = child > 0 ? static_cast<inner_type*>(parent->children[child - 1]) : nullptr;
+    auto* right = child < parent->count ? static_cast<inner_type*>(parent->children[child + 1]) : nullptr;
+
+    if (left != nullptr && left->count > inner_type::kMinCount) {
+      // rotation: parent's separator comes down, left's last one goes up
+      btree_detail::InsertAt(node->keys(), node->count, 0, std::move(parent->keys()[child - 1]));
+      std::copy_backward(node->children, node->children + node->count + 1, node->children + node->count + 2);
+      node->children[0] = left->children[left->count];
+      ++node->count;
+
+      parent->keys()[child - 1] = std::move(left->keys()[left->count - 1]);
+      std::destroy_at(left->keys() + left->count - 1);
+      --left->count;
+      return;
+    }
+
+    if (right != nullptr && right->count > inner_type::kMinCount) {
+      std::construct_at(node->keys() + node->count, std::move(parent->keys()[child]));
+      node->children[node->count + 1] = right->children[0];
+      ++node->count;
+
+      parent->keys()[child] = std::move(right->keys()[0]);
+      btree_detail::EraseAt(right->keys(), right->count, 0);
+      std::copy(right->children + 1, right->children + right->count + 1, right->children);
+      --right->count;
+      return;
+    }
+
+    // merge with a sibling, the separator between the two comes down between their keys
+    if (left == nullptr) {
+      left = node;
+      node = right;
+      ++child;
+    }
+
+    std::construct_at(left->keys() + left->count, std::move(parent->keys()[child - 1]));
+    btree_detail::Relocate(node->keys(), node->count, left->keys() + left->count + 1);
+    std::copy(node->children, node->children + node->count + 1, left->children + left->count + 1);
+    left->count += node->count + 1;
+    node->count = 0;
+    DropInner(node);
+    RemoveSeparator(parent, child - 1);
+
+    --depth;
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::find(const Key& key) const {
+  return FindKey(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+bool BTreeSet<Key, Comparator, Alloc, NodeBytes>::contains(const Key& key) const {
+  return FindKey(key) != end();
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::lower_bound(const Key& key) const {
+  return LowerBoundKey(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::upper_bound(const Key& key) const {
+  return UpperBoundKey(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+std::pair<typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator, typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator>
+BTreeSet<Key, Comparator, Alloc, NodeBytes>::equal_range(const Key& key) const {
+  auto lower = LowerBoundKey(key);
+  if (lower == end() || comparator_(key, *lower)) {
+    return { lower, lower };
+  }
+
+  return { lower, std::next(lower) };
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <typename K> requires TransparentComparator<Comparator>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::find(const K& key) const {
+  return FindKey(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <typename K> requires TransparentComparator<Comparator>
+bool BTreeSet<Key, Comparator, Alloc, NodeBytes>::contains(const K& key) const {
+  return FindKey(key) != end();
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <typename K> requires TransparentComparator<Comparator>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::lower_bound(const K& key) const {
+  return LowerBoundKey(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+template <typename K> requires TransparentComparator<Comparator>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::const_iterator BTreeSet<Key, Comparator, Alloc, NodeBytes>::upper_bound(const K& key) const {
+  return UpperBoundKey(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::size_type BTreeSet<Key, Comparator, Alloc, NodeBytes>::size() const {
+  return size_;
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+bool BTreeSet<Key, Comparator, Alloc, NodeBytes>::empty() const {
+  return size_ == 0;
+}
+
+template <typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+typename BTreeSet<Key, Comparator, Alloc, NodeBytes>::size_type BTreeSet<Key, Comparator, Alloc, NodeBytes>::height() const {
+  return height_;
+}
@@ -0,0 +1,1031 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include <lib/comparator.hpp>
+
+/* Node of CompactSet, links are 32-bit indices into the node pool of the set.
+ * Index 0 is the "end" node, it's the parent of the root and doubles as the null link,
+ * since the "end" node is never anybody's child. The color of the red-black tree
+ * lives in the top bit of the parent link, so a node of a 4-byte key takes 16 bytes */
+template <typename Key>
+struct CompactNode {
+  static constexpr std::uint32_t kBlack = std::uint32_t{1} << 31;
+  static constexpr std::uint32_t kMaxIndex = kBlack - 1;
+
+  CompactNode() {}
+  ~CompactNode() {}
+
+  std::uint32_t left = 0; // next free slot, while the slot is free
+  std::uint32_t right = 0;
+  std::uint32_t parent = 0;
+
+  union {
+    Key key; // alive only while the slot is in the tree
+  };
+};
+
+/* Chunk table of a CompactSet, allocated by its first insert. The set hands it over
+ * on moves and swaps, so iterators refer to it rather than to the set.
+ * The first chunk holds 2^kFirstChunkShift nodes, every next one as many as all previous together */
+template <typename Key>
+struct CompactChunks {
+  static constexpr int kFirstChunkShift = 4;
+  static constexpr int kMaxChunks = 32 - kFirstChunkShift; // enough for 2^31 slots
+
+  // table of sets which never allocated, with an "end" node of an empty tree. It's shared,
+  // so nothing may write to it
+  static CompactChunks* Empty();
+
+  CompactNode<Key>& At(std::uint32_t index) const;
+
+  std::uint32_t Successor(std::uint32_t index) const;
+  std::uint32_t Predecessor(std::uint32_t index) const;
+
+  CompactNode<Key>* chunks[kMaxChunks] = {};
+};
+
+template <typename Key>
+CompactChunks<Key>* CompactChunks<Key>::Empty() {
+  static CompactNode<Key> end;
+  static CompactChunks empty{{&end}};
+  return &empty;
+}
+
+template <typename Key>
+CompactNode<Key>& CompactChunks<Key>::At(std::uint32_t index) const {
+  // chunk k > 0 starts at 2^(kFirstChunkShift + k - 1)
+  auto chunk = std::bit_width(index >> kFirstChunkShift);
+  auto offset = chunk == 0 ? index : index - (std::uint32_t{1} << (kFirstChunkShift + chunk - 1));
+  return chunks[chunk][offset];
+}
+
+template <typename Key>
+std::uint32_t CompactChunks<Key>::Successor(std::uint32_t index) const {
+  if (At(index).right != 0) {
+    index = At(index).right;
+    while (At(index).left != 0) {
+      index = At(index).left;
+    }
+
+    return index;
+  }
+
+  // climb while coming from the right, the root climbs to the "end" node
+  auto parent = At(index).parent & CompactNode<Key>::kMaxIndex;
+  while (parent != 0 && At(parent).right == index) {
+    index = parent;
+    parent = At(parent).parent & CompactNode<Key>::kMaxIndex;
+  }
+
+  return parent;
+}
+
+template <typename Key>
+std::uint32_t CompactChunks<Key>::Predecessor(std::uint32_t index) const {
+  // whole tree is the left subtree of the "end" node
+  if (At(index).left != 0) {
+    index = At(index).left;
+    while (At(index).right != 0) {
+      index = At(index).right;
+    }
+
+    return index;
+  }
+
+  auto parent = At(index).parent & CompactNode<Key>::kMaxIndex;
+  while (parent != 0 && At(parent).left == index) {
+    index = parent;
+    parent = At(parent).parent & CompactNode<Key>::kMaxIndex;
+  }
+
+  return parent;
+}
+
+// inorder iterator, knows the chunk table of its set to translate indices into nodes
+template <typename Key>
+struct CompactIterator {
+  CompactIterator() = default;
+  CompactIterator(const CompactChunks<Key>* chunks, std::uint32_t index) : chunks_{chunks}, index_{index} {}
+
+  using value_type = Key;
+  using difference_type = std::ptrdiff_t;
+  using reference = const value_type&;
+  using pointer = const value_type*;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  reference operator*() const;
+  pointer operator->() const;
+
+  CompactIterator& operator++();
+  CompactIterator& operator--();
+  CompactIterator operator++(int);
+  CompactIterator operator--(int);
+
+  bool operator==(const CompactIterator& other) const;
+
+  std::uint32_t index() const;
+
+private:
+  const CompactChunks<Key>* chunks_ = nullptr;
+  std::uint32_t index_ = 0;
+};
+
+template <typename Key>
+typename CompactIterator<Key>::reference CompactIterator<Key>::operator*() const {
+  return chunks_->At(index_).key;
+}
+
+template <typename Key>
+typename CompactIterator<Key>::pointer CompactIterator<Key>::operator->() const {
+  return &chunks_->At(index_).key;
+}
+
+template <typename Key>
+CompactIterator<Key>& CompactIterator<Key>::operator++() {
+  index_ = chunks_->Successor(index_);
+  return *this;
+}
+
+template <typename Key>
+CompactIterator<Key>& CompactIterator<Key>::operator--() {
+  index_ = chunks_->Predecessor(index_);
+  return *this;
+}
+
+template <typename Key>
+CompactIterator<Key> CompactIterator<Key>::operator++(int) {
+  auto copy = *this;
+  ++*this;
+  return copy;
+}
+
+template <typename Key>
+CompactIterator<Key> CompactIterator<Key>::operator--(int) {
+  auto copy = *this;
+  --*this;
+  return copy;
+}
+
+template <typename Key>
+bool CompactIterator<Key>::operator==(const CompactIterator& other) const {
+  return index_ == other.index_ && chunks_ == other.chunks_;
+}
+
+template <typename Key>
+std::uint32_t CompactIterator<Key>::index() const {
+  return index_;
+}
+
+/* Red-black tree set with 32-bit index links. Nodes live in chunks which double in size,
+ * so they never move and references to keys stay valid until the key is erased.
+ * Nothing is allocated before the first insert, so default construction and moves never throw.
+ * Erased slots are reused through a free list chained by their left links.
+ * Meant for large sets of small keys, where three pointers per node cost more than the key */
+template<
+  typename Key,
+  typename Comparator = std::less<Key>,
+  typename Alloc = std::allocator<Key>
+>
+class CompactSet {
+public:
+  using value_type = Key;
+  using key_type = Key;
+  using key_compare = Comparator;
+  using value_compare = Comparator;
+  using reference = const Key&;
+  using const_reference = const Key&;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using allocator_type = std::allocator_traits<Alloc>::template rebind_alloc<CompactNode<Key>>;
+
+  using iterator = CompactIterator<Key>;
+  using const_iterator = iterator;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = reverse_iterator;
+
+  CompactSet() noexcept;
+  ~CompactSet();
+
+  CompactSet(const CompactSet& other);
+  CompactSet(CompactSet&& other) noexcept;
+
+  template <std::input_iterator It>
+  CompactSet(It first, It last);
+  CompactSet(std::initializer_list<Key> keys);
+
+  CompactSet& operator=(const CompactSet& other);
+  CompactSet& operator=(CompactSet&& other) noexcept;
+
+  void swap(CompactSet& other) noexcept;
+
+  [[nodiscard]] const_iterator begin() const;
+  [[nodiscard]] const_iterator end() const;
+  [[nodiscard]] const_iterator cbegin() const;
+  [[nodiscard]] const_iterator cend() const;
+  [[nodiscard]] const_reverse_iterator rbegin() const;
+  [[nodiscard]] const_reverse_iterator rend() const;
+
+  template <typename... Args>
+  std::pair<bool, iterator> emplace(Args&&... args);
+
+  std::pair<bool, iterator> insert(const Key& key);
+  std::pair<bool, iterator> insert(Key&& key);
+
+  template <std::input_iterator It>
+  void insert(It first, It last);
+
+  size_type erase(const Key& key);
+  const_iterator erase(const_iterator it);
+  void clear();
+
+  [[nodiscard]] const_iterator find(const Key& key) const;
+  [[nodiscard]] bool contains(const Key& key) const;
+  [[nodiscard]] const_iterator lower_bound(const Key& key) const;
+  [[nodiscard]] const_iterator upper_bound(const Key& key) const;
+
+  // overloads below accept anything comparable with Key, if the comparator is transparent
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] const_iterator find(const K& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] bool contains(const K& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] const_iterator lower_bound(const K& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] const_iterator upper_bound(const K& key) const;
+
+  [[nodiscard]] size_type size() const;
+  [[nodiscard]] bool empty() const;
+
+  // number of levels, 0 for an empty set
+  [[nodiscard]] size_type height() const;
+
+private:
+  using Node = CompactNode<Key>;
+  using Chunks = CompactChunks<Key>;
+
+  Node& NodeAt(std::uint32_t index) const;
+
+  std::uint32_t& Left(std::uint32_t index) const;
+  std::uint32_t& Right(std::uint32_t index) const;
+  std::uint32_t Parent(std::uint32_t index) const;
+  void SetParent(std::uint32_t index, std::uint32_t parent) const;
+
+  bool IsRed(std::uint32_t index) const; // null link is black
+  void SetBlack(std::uint32_t index, bool is_black) const;
+
+  // slot management, keys are constructed and destroyed in place.
+  // The "end" node takes slot 0 on the first insert
+  void AllocateEndNode();
+  std::uint32_t AllocateSlot();
+  void FreeSlot(std::uint32_t index);
+  void ReleaseChunks();
+
+  template <typename K>
+  std::pair<bool, iterator> InsertKey(K&& key);
+
+  template <typename K>
+  std::uint32_t FindIndex(const K& key) const;
+
+  template <typename K>
+  std::uint32_t LowerBoundIndex(const K& key) const;
+
+  template <typename K>
+  std::uint32_t UpperBoundIndex(const K& key) const;
+
+  void RotateLeft(std::uint32_t x);
+  void RotateRight(std::uint32_t x);
+  void InsertFixup(std::uint32_t node);
+  void EraseFixup(std::uint32_t child, std::uint32_t parent, bool was_left);
+  void EraseIndex(std::uint32_t node);
+
+  Comparator comparator_;
+  allocator_type allocator_;
+
+  Chunks* chunks_ = Chunks::Empty(); // owned, unless it's the empty one
+  std::uint32_t capacity_ = 0; // slots in all chunks together
+  std::uint32_t used_ = 0;     // slots handed out at least once, the rest was never touched
+  std::uint32_t free_ = 0;     // head of the free list, 0 if it's empty
+  size_type size_ = 0;
+};
+
+template <typename Key, typename Comparator, typename Alloc>
+CompactSet<Key, Comparator, Alloc>::CompactSet() noexcept = default;
+
+template <typename Key, typename Comparator, typename Alloc>
+CompactSet<Key, Comparator, Alloc>::~CompactSet() {
+  clear();
+  ReleaseChunks();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+CompactSet<Key, Comparator, Alloc>::CompactSet(const CompactSet& other)
+  : comparator_{other.comparator_},
+    allocator_{std::allocator_traits<allocator_type>::select_on_container_copy_construction(other.allocator_)} {
+  try {
+    for (const auto& key : other) {
+      insert(key);
+    }
+  } catch (...) {
+    clear(); // destructor won't be called for a throwing constructor
+    ReleaseChunks();
+    throw;
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+CompactSet<Key, Comparator, Alloc>::CompactSet(CompactSet&& other) noexcept
+  : comparator_{other.comparator_},
+    allocator_{other.allocator_},
+    chunks_{std::exchange(other.chunks_, Chunks::Empty())},
+    capacity_{std::exchange(other.capacity_, 0)},
+    used_{std::exchange(other.used_, 0)},
+    free_{std::exchange(other.free_, 0)},
+    size_{std::exchange(other.size_, 0)} {
+  // other is left as a default constructed set, it allocates again on its next insert
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <std::input_iterator It>
+CompactSet<Key, Comparator, Alloc>::CompactSet(It first, It last)
+  : CompactSet() {
+  insert(first, last);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+CompactSet<Key, Comparator, Alloc>::CompactSet(std::initializer_list<Key> keys)
+  : CompactSet(keys.begin(), keys.end()) {
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+CompactSet<Key, Comparator, Alloc>& CompactSet<Key, Comparator, Alloc>::operator=(const CompactSet& other) {
+  if (this != &other) {
+    CompactSet copy(other);
+    swap(copy);
+  }
+
+  return *this;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+CompactSet<Key, Comparator, Alloc>& CompactSet<Key, Comparator, Alloc>::operator=(CompactSet&& other) noexcept {
+  if (this != &other) {
+    swap(other);
+  }
+
+  return *this;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void CompactSet<Key, Comparator, Alloc>::swap(CompactSet& other) noexcept {
+  std::swap(comparator_, other.comparator_);
+  std::swap(allocator_, other.allocator_);
+  std::swap(chunks_, other.chunks_);
+  std::swap(capacity_, other.capacity_);
+  std::swap(used_, other.used_);
+  std::swap(free_, other.free_);
+  std::swap(size_, other.size_);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::Node& CompactSet<Key, Comparator, Alloc>::NodeAt(std::uint32_t index) const {
+  return chunks_->At(index);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+std::uint32_t& CompactSet<Key, Comparator, Alloc>::Left(std::uint32_t index) const {
+  return NodeAt(index).left;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+std::uint32_t& CompactSet<Key, Comparator, Alloc>::Right(std::uint32_t index) const {
+  return NodeAt(index).right;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+std::uint32_t CompactSet<Key, Comparator, Alloc>::Parent(std::uint32_t index) const {
+  return NodeAt(index).parent & Node::kMaxIndex;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void CompactSet<Key, Comparator, Alloc>::SetParent(std::uint32_t index, std::uint32_t parent) const {
+  auto& link = NodeAt(index).parent;
+  link = (link & Node::kBlack) | parent;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool CompactSet<Key, Comparator, Alloc>::IsRed(std::uint32_t index) const {
+  return index != 0 && (NodeAt(index).parent & Node::kBlack) == 0;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void CompactSet<Key, Comparator, Alloc>::SetBlack(std::uint32_t index, bool is_black) const {
+  auto& link = NodeAt(index).parent;
+  link = is_black ? (link | Node::kBlack) : (link & Node::kMaxIndex);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void CompactSet<Key, Comparator, Alloc>::AllocateEndNode() {
+  auto* chunks = new Chunks();
+  chunks_ = chunks;
+
+  try {
+    AllocateSlot();
+  } catch (...) {
+    chunks_ = Chunks::Empty();
+    delete chunks;
+    throw;
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+std::uint32_t CompactSet<Key, Comparator, Alloc>::AllocateSlot() {
+  std::uint32_t index;
+
+  if (free_ != 0) {
+    index = std::exchange(free_, Left(free_));
+  } else {
+    if (used_ == capacity_) {
+      if (capacity_ > Node::kMaxIndex / 2) {
+        throw std::length_error("CompactSet can't hold more than 2^31 nodes");
+      }
+
+      std::uint32_t chunk_size = capacity_ == 0 ? std::uint32_t{1} << Chunks::kFirstChunkShift : capacity_;
+      auto chunk = std::bit_width(capacity_ >> Chunks::kFirstChunkShift);
+      chunks_->chunks[chunk] = std::allocator_traits<allocator_type>::allocate(allocator_, chunk_size);
+      capacity_ += chunk_size;
+    }
+
+    index = used_++;
+  }
+
+  auto& node = NodeAt(index);
+  ::new (static_cast<void*>(&node)) Node();
+  return index;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void CompactSet<Key, Comparator, Alloc>::FreeSlot(std::uint32_t index) {
+  Left(index) = std::exchange(free_, index);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void CompactSet<Key, Comparator, Alloc>::ReleaseChunks() {
+  if (chunks_ == Chunks::Empty()) {
+    return;
+  }
+
+  std::uint32_t chunk_size = std::uint32_t{1} << Chunks::kFirstChunkShift;
+  for (int chunk = 0; chunk < Chunks::kMaxChunks && chunks_->chunks[chunk] != nullptr; ++chunk) {
+    std::allocator_traits<allocator_type>::deallocate(allocator_, chunks_->chunks[chunk], chunk_size);
+    if (chunk > 0) {
+      chunk_size *= 2;
+    }
+  }
+
+  delete chunks_;
+  chunks_ = Chunks::Empty();
+  capacity_ = 0;
+  used_ = 0;
+  free_ = 0;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void CompactSet<Key, Comparator, Alloc>::clear() {
+  if (capacity_ == 0) {
+    return; // nothing was allocated, not even the "end" node
+  }
+
+  // keys of every linked slot get destroyed, free slots hold none
+  for (auto index = Left(0); index != 0;) {
+    if (Left(index) != 0) {
+      index = Left(index);
+      continue;
+    }
+
+    if (Right(index) != 0) {
+      index = Right(index);
+      continue;
+    }
+
+    // leaf: destroy it and cut it off its parent, so the walk doesn't come back here
+    auto parent = Parent(index);
+    if (Left(parent) == index) {
+      Left(parent) = 0;
+    } else {
+      Right(parent) = 0;
+    }
+
+    std::destroy_at(&NodeAt(index).key);
+    index = parent;
+  }
+
+  // everything but the "end" node is free again, never touched slots are reused first
+  used_ = 1;
+  free_ = 0;
+  size_ = 0;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::const_iterator CompactSet<Key, Comparator, Alloc>::begin() const {
+  std::uint32_t index = 0;
+  while (Left(index) != 0) {
+    index = Left(index);
+  }
+
+  return iterator(chunks_, index);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::const_iterator CompactSet<Key, Comparator, Alloc>::end() const {
+  return iterator(chunks_, 0);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::const_iterator CompactSet<Key, Comparator, Alloc>::cbegin() const {
+  return begin();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::const_iterator CompactSet<Key, Comparator, Alloc>::cend() const {
+  return end();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::const_reverse_iterator CompactSet<Key, Comparator, Alloc>::rbegin() const {
+  return const_reverse_iterator(end());
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::const_reverse_iterator CompactSet<Key, Comparator, Alloc>::rend() const {
+  return const_reverse_iterator(begin());
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename... Args>
+std::pair<bool, typename CompactSet<Key, Comparator, Alloc>::iterator> CompactSet<Key, Comparator, Alloc>::emplace(Args&&... args) {
+  // key is searched for before a slot is taken, so duplicates cost nothing but the search
+  return InsertKey(Key{std::forward<Args>(args)...});
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+std::pair<bool, typename CompactSet<Key, Comparator, Alloc>::iterator> CompactSet<Key, Comparator, Alloc>::insert(const Key& key) {
+  return InsertKey(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+std::pair<bool, typename CompactSet<Key, Comparator, Alloc>::iterator> CompactSet<Key, Comparator, Alloc>::insert(Key&& key) {
+  return InsertKey(std::move(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <std::input_iterator It>
+void CompactSet<Key, Comparator, Alloc>::insert(It first, It last) {
+  for (; first != last; ++first) {
+    emplace(*first);
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K>
+std::pair<bool, typename CompactSet<Key, Comparator, Alloc>::iterator> CompactSet<Key, Comparator, Alloc>::InsertKey(K&& key) {
+  std::uint32_t parent = 0;
+  bool is_left = true;
+
+  for (auto index = Left(0); index != 0;) {
+    parent = index;
+
+    if (comparator_(key, NodeAt(index).key)) {
+      is_left = true;
+      index = Left(index);
+    } else if (comparator_(NodeAt(index).key, key)) {
+      is_left = false;
+      index = Right(index);
+    } else {
+      return { false, iterator(chunks_, index) };
+    }
+  }
+
+  if (capacity_ == 0) {
+    AllocateEndNode(); // parent is 0 then, it stays the same slot
+  }
+
+  auto index = AllocateSlot();
+
+  try {
+    std::construct_at(&NodeAt(index).key, std::forward<K>(key));
+  } catch (...) {
+    FreeSlot(index);
+    throw;
+  }
+
+  // fresh slot is red and has no children
+  SetParent(index, parent);
+  if (is_left) {
+    Left(parent) = index;
+  } else {
+    Right(parent) = index;
+  }
+
+  InsertFixup(index);
+  ++size_;
+  return { true, iterator(chunks_, index) };
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void CompactSet<Key, Comparator, Alloc>::RotateLeft(std::uint32_t x) {
+  auto y = Right(x);
+
+  Right(x) = Left(y);
+  if (Left(y) != 0) {
+    SetParent(Left(y), x);
+  }
+
+  auto parent = Parent(x);
+  SetParent(y, parent);
+  // the "end" node is a regular parent here, the root is its left child
+  if (Left(parent) == x) {
+    Left(parent) = y;
+  } else {
+    Right(parent) = y;
+  }
+
+  Left(y) = x;
+  SetParent(x, y);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void CompactSet<Key, Comparator, Alloc>::RotateRight(std::uint32_t x) {
+  auto y = Left(x);
+
+  Left(x) = Right(y);
+  if (Right(y) != 0) {
+    SetParent(Right(y), x);
+  }
+
+  auto parent = Parent(x);
+  SetParent(y, parent);
+  if (Left(parent) == x) {
+    Left(parent) = y;
+  } else {
+    Right(parent) = y;
+  }
+
+  Right(y) = x;
+  SetParent(x, y);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void CompactSet<Key, Comparator, Alloc>::InsertFixup(std::uint32_t node) {
+  // same cases as RedBlack::OnInsert, just on indices
+  while (IsRed(Parent(node))) {
+    auto parent = Parent(node);
+    auto grandparent = Parent(parent);
+
+    if (parent == Left(grandparent)) {
+      auto uncle = Right(grandparent);
+
+      if (IsRed(uncle)) {
+        SetBlack(parent, true);
+        SetBlack(uncle, true);
+        SetBlack(grandparent, false);
+        node = grandparent;
+        continue;
+      }
+
+      if (node == Right(parent)) {
+        node = parent;
+        RotateLeft(node);
+        parent = Parent(node);
+      }
+
+      SetBlack(parent, true);
+      SetBlack(grandparent, false);
+      RotateRight(grandparent);
+    } else {
+      auto uncle = Left(grandparent);
+
+      if (IsRed(uncle)) {
+        SetBlack(parent, true);
+        SetBlack(uncle, true);
+        SetBlack(grandparent, false);
+        node = grandparent;
+        continue;
+      }
+
+      if (node == Left(parent)) {
+        node = parent;
+        RotateRight(node);
+        parent = Parent(node);
+      }
+
+      SetBlack(parent, true);
+      SetBlack(grandparent, false);
+      RotateLeft(grandparent);
+    }
+  }
+
+  SetBlack(Left(0), true);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void CompactSet<Key, Comparator, Alloc>::EraseIndex(std::uint32_t node) {
+  // same relinking as Set::UnlinkNode: a node with two children is replaced by its successor
+  std::uint32_t child;
+  std::uint32_t parent;
+  bool was_left;
+
+  if (Left(node) != 0 && Right(node) != 0) {
+    auto successor = Right(node);
+    while (Left(successor) != 0) {
+      successor = Left(successor);
+    }
+
+    child = Right(successor);
+
+    if (successor == Right(node)) {
+      parent = successor;
+      was_left = false;
+    } else {
+      parent = Parent(successor);
+      was_left = true;
+
+      Left(parent) = child;
+      if (child != 0) {
+        SetParent(child, parent);
+      }
+
+      Right(successor) = Right(node);
+      SetParent(Right(node), successor);
+    }
+
+    Left(successor) = Left(node);
+    SetParent(Left(node), successor);
+
+    auto node_parent = Parent(node);
+    if (Left(node_parent) == node) {
+      Left(node_parent) = successor;
+    } else {
+      Right(node_parent) = successor;
+    }
+    SetParent(successor, node_parent);
+
+    // successor takes node's color, node keeps the color of the slot which disappears
+    bool successor_was_red = IsRed(successor);
+    SetBlack(successor, !IsRed(node));
+    SetBlack(node, !successor_was_red);
+  } else {
+    child = Left(node) != 0 ? Left(node) : Right(node);
+    parent = Parent(node);
+    was_left = Left(parent) == node;
+
+    if (was_left) {
+      Left(parent) = child;
+    } else {
+      Right(parent) = child;
+    }
+
+    if (child != 0) {
+      SetParent(child, parent);
+    }
+  }
+
+  if (!IsRed(node)) {
+    EraseFixup(child, parent, was_left);
+  }
+
+  std::destroy_at(&NodeAt(node).key);
+  FreeSlot(node);
+  --size_;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void CompactSet<Key, Comparator, Alloc>::EraseFixup(std::uint32_t child, std::uint32_t parent, bool was_left) {
+  // same cases as RedBlack::OnErase, child carries an extra black
+  while (child != Left(0) && !IsRed(child)) {
+    if (was_left) {
+      auto sibling = Right(parent);
+
+      if (IsRed(sibling)) {
+        SetBlack(sibling, true);
+        SetBlack(parent, false);
+        RotateLeft(parent);
+        sibling = Right(parent);
+      }
+
+      if (!IsRed(Left(sibling)) && !IsRed(Right(sibling))) {
+        SetBlack(sibling, false);
+        child = parent;
+        parent = Parent(parent);
+        was_left = Left(parent) == child;
+        continue;
+      }
+
+      if (!IsRed(Right(sibling))) {
+        SetBlack(Left(sibling), true);
+        SetBlack(sibling, false);
+        RotateRight(sibling);
+        sibling = Right(parent);
+      }
+
+      SetBlack(sibling, !IsRed(parent));
+      SetBlack(parent, true);
+      SetBlack(Right(sibling), true);
+      RotateLeft(parent);
+      child = Left(0);
+    } else {
+      auto sibling = Left(parent);
+
+      if (IsRed(sibling)) {
+        SetBlack(sibling, true);
+        SetBlack(parent, false);
+        RotateRight(parent);
+        sibling = Left(parent);
+      }
+
+      if (!IsRed(Left(sibling)) && !IsRed(Right(sibling))) {
+        SetBlack(sibling, false);
+        child = parent;
+        parent = Parent(parent);
+        was_left = Left(parent) == child;
+        continue;
+      }
+
+      if (!IsRed(Left(sibling))) {
+        SetBlack(Right(sibling), true);
+        SetBlack(sibling, false);
+        RotateLeft(sibling);
+        sibling = Left(parent);
+      }
+
+      SetBlack(sibling, !IsRed(parent));
+      SetBlack(parent, true);
+      SetBlack(Left(sibling), true);
+      RotateRight(parent);
+      child = Left(0);
+    }
+  }
+
+  if (child != 0) {
+    SetBlack(child, true);
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::size_type CompactSet<Key, Comparator, Alloc>::erase(const Key& key) {
+  auto index = FindIndex(key);
+  if (index == 0) return 0; // key was not found
+
+  EraseIndex(index);
+  return 1;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::const_iterator CompactSet<Key, Comparator, Alloc>::erase(const_iterator it) {
+  auto successor = std::next(it); // stays valid, only the erased node is unlinked
+  EraseIndex(it.index());
+  return successor;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K>
+std::uint32_t CompactSet<Key, Comparator, Alloc>::FindIndex(const K& key) const {
+  auto index = LowerBoundIndex(key);
+
+  if (index == 0 || comparator_(key, NodeAt(index).key)) {
+    return 0;
+  }
+
+  return index;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K>
+std::uint32_t CompactSet<Key, Comparator, Alloc>::LowerBoundIndex(const K& key) const {
+  std::uint32_t result = 0; // "end" node is greater than any key
+
+  for (auto index = Left(0); index != 0;) {
+    if (comparator_(NodeAt(index).key, key)) {
+      index = Right(index);
+    } else {
+      result = index;
+      index = Left(index);
+    }
+  }
+
+  return result;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K>
+std::uint32_t CompactSet<Key, Comparator, Alloc>::UpperBoundIndex(const K& key) const {
+  std::uint32_t result = 0;
+
+  for (auto index = Left(0); index != 0;) {
+    if (comparator_(key, NodeAt(index).key)) {
+      result = index;
+      index = Left(index);
+    } else {
+      index = Right(index);
+    }
+  }
+
+  return result;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::const_iterator CompactSet<Key, Comparator, Alloc>::find(const Key& key) const {
+  return iterator(chunks_, FindIndex(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool CompactSet<Key, Comparator, Alloc>::contains(const Key& key) const {
+  return FindIndex(key) != 0;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::const_iterator CompactSet<Key, Comparator, Alloc>::lower_bound(const Key& key) const {
+  return iterator(chunks_, LowerBoundIndex(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::const_iterator CompactSet<Key, Comparator, Alloc>::upper_bound(const Key& key) const {
+  return iterator(chunks_, UpperBoundIndex(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K> requires TransparentComparator<Comparator>
+typename CompactSet<Key, Comparator, Alloc>::const_iterator CompactSet<Key, Comparator, Alloc>::find(const K& key) const {
+  return iterator(chunks_, FindIndex(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K> requires TransparentComparator<Comparator>
+bool CompactSet<Key, Comparator, Alloc>::contains(const K& key) const {
+  return FindIndex(key) != 0;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K> requires TransparentComparator<Comparator>
+typename CompactSet<Key, Comparator, Alloc>::const_iterator CompactSet<Key, Comparator, Alloc>::lower_bound(const K& key) const {
+  return iterator(chunks_, LowerBoundIndex(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K> requires TransparentComparator<Comparator>
+typename CompactSet<Key, Comparator, Alloc>::const_iterator CompactSet<Key, Comparator, Alloc>::upper_bound(const K& key) const {
+  return iterator(chunks_, UpperBoundIndex(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::size_type CompactSet<Key, Comparator, Alloc>::size() const {
+  return size_;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool CompactSet<Key, Comparator, Alloc>::empty() const {
+  return size_ == 0;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename CompactSet<Key, Comparator, Alloc>::size_type CompactSet<Key, Comparator, Alloc>::height() const {
+  // every leaf reports the depth it was reached at, the walk needs no stack thanks to parent links
+  size_type height = 0;
+  size_type depth = 0;
+  std::uint32_t previous = 0;
+
+  for (auto index = Left(0); index != 0;) {
+    std::uint32_t next;
+
+    if (previous == Parent(index)) {
+      ++depth;
+      height = std::max(height, depth);
+      next = Left(index) != 0 ? Left(index) : (Right(index) != 0 ? Right(index) : Parent(index));
+    } else if (previous == Left(index) && Right(index) != 0) {
+      next = Right(index);
+    } else {
+      next = Parent(index);
+    }
+
+    if (next == Parent(index)) {
+      --depth;
+    }
+
+    previous = std::exchange(index, next);
+  }
+
+  return height;
+}
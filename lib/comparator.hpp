@@ -0,0 +1,6 @@
+#pragma once
+
+// comparator declaring is_transparent can compare keys with any compatible type,
+// so lookups don't have to construct a temporary Key
+template <typename Comparator>
+concept TransparentComparator = requires { typename Comparator::is_transparent; };
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <lib/epoch.hpp>
+#include <lib/persistent_tree.hpp>
+
+/* Set for many reading threads and a few writing ones. Readers take no lock: they pin
+ * the epoch, load the root and walk immutable nodes. Writers are serialized by a mutex,
+ * build the changed path next to the old one, balance it as an AVL tree and publish it
+ * with a single store. Replaced nodes are retired and freed once no pinned reader
+ * can still reach them, see EpochDomain */
+template<
+  typename Key,
+  typename Comparator = std::less<Key>,
+  typename Alloc = std::allocator<Key>
+>
+class ConcurrentSet {
+public:
+  using value_type = Key;
+  using key_type = Key;
+  using key_compare = Comparator;
+  using size_type = std::size_t;
+  using allocator_type = std::allocator_traits<Alloc>::template rebind_alloc<PersistentNode<Key>>;
+  using const_iterator = PersistentIterator<PersistentNode<Key>>;
+
+  // consistent view of the set as of its creation, later writes don't show up in it.
+  // Keeps the calling thread pinned, so it's meant to be short lived and not shared between threads
+  class Snapshot {
+  public:
+    [[nodiscard]] const_iterator begin() const;
+    [[nodiscard]] const_iterator end() const;
+
+    [[nodiscard]] bool contains(const Key& key) const;
+    [[nodiscard]] const_iterator find(const Key& key) const;
+    [[nodiscard]] const_iterator lower_bound(const Key& key) const;
+
+  private:
+    friend class ConcurrentSet;
+
+    Snapshot(EpochDomain::Guard guard, const PersistentNode<Key>* root, const Comparator& comparator);
+
+    EpochDomain::Guard guard_;
+    const PersistentNode<Key>* root_;
+    const Comparator& comparator_;
+  };
+
+  ConcurrentSet() = default;
+  ConcurrentSet(std::initializer_list<Key> keys);
+
+  // no reader may be inside of the set any more
+  ~ConcurrentSet();
+
+  ConcurrentSet(const ConcurrentSet&) = delete;
+  ConcurrentSet& operator=(const ConcurrentSet&) = delete;
+
+  // writers, one at a time
+  bool insert(const Key& key);
+  bool insert(Key&& key);
+  size_type erase(const Key& key);
+  void clear();
+
+  // readers, lock-free
+  [[nodiscard]] bool contains(const Key& key) const;
+  [[nodiscard]] Snapshot snapshot() const;
+  [[nodiscard]] size_type size() const;
+  [[nodiscard]] bool empty() const;
+
+private:
+  using Node = PersistentNode<Key>;
+
+  // retired nodes are freed in batches, a batch scans the slots of all readers once
+  static constexpr std::size_t kReclaimBatch = 256;
+
+  template <typename K>
+  bool InsertKey(K& key);
+
+  // new root becomes visible, replaced nodes wait for reclamation
+  void Publish(const Node* root, std::ptrdiff_t size_change, const std::vector<const Node*>& replaced);
+  void Reclaim(std::uint64_t safe_epoch);
+
+  PathCopyingTree<Node, Comparator, Alloc> tree_;
+
+  std::atomic<const Node*> root_{nullptr};
+  std::atomic<size_type> size_{0};
+
+  std::mutex writer_mutex_;
+  std::deque<std::pair<std::uint64_t, const Node*>> limbo_; // retired nodes with their epochs
+};
+
+template <typename Key, typename Comparator, typename Alloc>
+ConcurrentSet<Key, Comparator, Alloc>::Snapshot::Snapshot(EpochDomain::Guard guard, const PersistentNode<Key>* root, const Comparator& comparator)
+  : guard_{std::move(guard)},
+    root_{root},
+    comparator_{comparator} {
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename ConcurrentSet<Key, Comparator, Alloc>::const_iterator ConcurrentSet<Key, Comparator, Alloc>::Snapshot::begin() const {
+  return const_iterator::Begin(root_);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename ConcurrentSet<Key, Comparator, Alloc>::const_iterator ConcurrentSet<Key, Comparator, Alloc>::Snapshot::end() const {
+  return const_iterator();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool ConcurrentSet<Key, Comparator, Alloc>::Snapshot::contains(const Key& key) const {
+  return find(key) != end();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename ConcurrentSet<Key, Comparator, Alloc>::const_iterator ConcurrentSet<Key, Comparator, Alloc>::Snapshot::find(const Key& key) const {
+  auto it = lower_bound(key);
+  if (it == end() || comparator_(key, *it)) {
+    return end();
+  }
+
+  return it;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename ConcurrentSet<Key, Comparator, Alloc>::const_iterator ConcurrentSet<Key, Comparator, Alloc>::Snapshot::lower_bound(const Key& key) const {
+  return const_iterator::LowerBound(root_, comparator_, key);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+ConcurrentSet<Key, Comparator, Alloc>::ConcurrentSet(std::initializer_list<Key> keys) {
+  for (const auto& key : keys) {
+    insert(key);
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+ConcurrentSet<Key, Comparator, Alloc>::~ConcurrentSet() {
+  tree_.DropTree(root_.load(std::memory_order_relaxed));
+  Reclaim(EpochDomain::kIdle);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool ConcurrentSet<Key, Comparator, Alloc>::insert(const Key& key) {
+  return InsertKey(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool ConcurrentSet<Key, Comparator, Alloc>::insert(Key&& key) {
+  return InsertKey(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K>
+bool ConcurrentSet<Key, Comparator, Alloc>::InsertKey(K& key) {
+  std::lock_guard lock(writer_mutex_);
+  tree_.BeginWrite();
+
+  bool inserted = false;
+  try {
+    auto* root = tree_.Insert(root_.load(std::memory_order_relaxed), key, inserted);
+    if (inserted) {
+      Publish(root, 1, tree_.replaced());
+    }
+  } catch (...) {
+    tree_.Abandon();
+    throw;
+  }
+
+  tree_.EndWrite();
+  return inserted;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename ConcurrentSet<Key, Comparator, Alloc>::size_type ConcurrentSet<Key, Comparator, Alloc>::erase(const Key& key) {
+  std::lock_guard lock(writer_mutex_);
+  tree_.BeginWrite();
+
+  bool erased = false;
+  try {
+    auto* root = tree_.Erase(root_.load(std::memory_order_relaxed), key, erased);
+    if (erased) {
+      Publish(root, -1, tree_.replaced());
+    }
+  } catch (...) {
+    tree_.Abandon();
+    throw;
+  }
+
+  tree_.EndWrite();
+  return erased ? 1 : 0;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void ConcurrentSet<Key, Comparator, Alloc>::clear() {
+  std::lock_guard lock(writer_mutex_);
+
+  // every node is retired, a reader may be anywhere in the tree
+  std::vector<const Node*> replaced;
+  if (auto* root = root_.load(std::memory_order_relaxed); root != nullptr) {
+    replaced.push_back(root);
+  }
+
+  for (std::size_t i = 0; i < replaced.size(); ++i) {
+    for (auto* child : {replaced[i]->left, replaced[i]->right}) {
+      if (child != nullptr) {
+        replaced.push_back(child);
+      }
+    }
+  }
+
+  Publish(nullptr, -static_cast<std::ptrdiff_t>(size_.load(std::memory_order_relaxed)), replaced);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void ConcurrentSet<Key, Comparator, Alloc>::Publish(const Node* root, std::ptrdiff_t size_change, const std::vector<const Node*>& replaced) {
+  auto& domain = EpochDomain::Global();
+  auto limbo_size = limbo_.size();
+
+  // limbo grows before the root is stored: once readers can reach the new nodes the write
+  // can't be abandoned anymore, so nothing after the store may throw
+  try {
+    for (auto* node : replaced) {
+      limbo_.emplace_back(EpochDomain::kIdle, node);
+    }
+  } catch (...) {
+    limbo_.resize(limbo_size); // nothing was published, the caller abandons the write
+    throw;
+  }
+
+  root_.store(root, std::memory_order_seq_cst);
+  size_.fetch_add(static_cast<size_type>(size_change), std::memory_order_relaxed);
+
+  // readers pinned at this epoch or earlier may hold the replaced nodes, later ones can't
+  auto epoch = domain.Current();
+  for (auto it = limbo_.begin() + static_cast<std::ptrdiff_t>(limbo_size); it != limbo_.end(); ++it) {
+    it->first = epoch;
+  }
+  domain.Advance();
+
+  if (limbo_.size() >= kReclaimBatch) {
+    Reclaim(domain.MinPinned());
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void ConcurrentSet<Key, Comparator, Alloc>::Reclaim(std::uint64_t safe_epoch) {
+  // epochs in limbo only grow, so the ones safe to free are at the front
+  while (!limbo_.empty() && limbo_.front().first < safe_epoch) {
+    tree_.DropNode(limbo_.front().second);
+    limbo_.pop_front();
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool ConcurrentSet<Key, Comparator, Alloc>::contains(const Key& key) const {
+  auto guard = EpochDomain::Global().Pin();
+
+  for (auto* node = root_.load(std::memory_order_seq_cst); node != nullptr;) {
+    if (tree_.comparator()(key, node->key)) {
+      node = node->left;
+    } else if (tree_.comparator()(node->key, key)) {
+      node = node->right;
+    } else {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename ConcurrentSet<Key, Comparator, Alloc>::Snapshot ConcurrentSet<Key, Comparator, Alloc>::snapshot() const {
+  auto guard = EpochDomain::Global().Pin();
+  return Snapshot(std::move(guard), root_.load(std::memory_order_seq_cst), tree_.comparator());
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename ConcurrentSet<Key, Comparator, Alloc>::size_type ConcurrentSet<Key, Comparator, Alloc>::size() const {
+  return size_.load(std::memory_order_relaxed);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool ConcurrentSet<Key, Comparator, Alloc>::empty() const {
+  return size() == 0;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+/* Epoch based reclamation for structures read without locks. A reader pins the current epoch
+ * for the duration of its read. A writer which unlinked some memory tags it with the epoch
+ * at the moment it was unlinked, advances the epoch and may free it once every pinned reader
+ * entered at a later epoch: such readers started after the unlink and can't reach the memory.
+ * There is a single domain per process, every thread reading any structure owns one slot in it */
+class EpochDomain {
+public:
+  static constexpr std::size_t kMaxThreads = 256;
+  static constexpr std::uint64_t kIdle = std::numeric_limits<std::uint64_t>::max();
+
+  // pins the calling thread while alive, nested guards share the outermost pin
+  class Guard {
+  public:
+    Guard(Guard&& other) noexcept;
+    Guard& operator=(Guard&&) = delete;
+    ~Guard();
+
+  private:
+    friend class EpochDomain;
+
+    Guard() = default;
+
+    bool active_ = true;
+  };
+
+  static EpochDomain& Global();
+
+  [[nodiscard]] Guard Pin();
+
+  std::uint64_t Current() const;
+  void Advance();
+
+  // lowest epoch a reader is pinned at right now, kIdle if nobody reads
+  std::uint64_t MinPinned() const;
+
+private:
+  EpochDomain() = default;
+
+  // own cache line each, pins of different threads don't share lines
+  struct alignas(64) Slot {
+    std::atomic<std::uint64_t> epoch{kIdle};
+    std::atomic<bool> taken{false};
+  };
+
+  // slot of a thread is taken on its first read and given back when the thread exits
+  struct ThreadState {
+    ~ThreadState();
+
+    Slot* slot = nullptr;
+    std::size_t depth = 0;
+  };
+
+  ThreadState& ThisThread();
+  void Unpin();
+
+  std::atomic<std::uint64_t> epoch_{0};
+  Slot slots_[kMaxThreads];
+};
+
+inline EpochDomain::Guard::Guard(Guard&& other) noexcept
+  : active_{std::exchange(other.active_, false)} {
+}
+
+inline EpochDomain::Guard::~Guard() {
+  if (active_) {
+    Global().Unpin();
+  }
+}
+
+inline EpochDomain& EpochDomain::Global() {
+  static EpochDomain domain;
+  return domain;
+}
+
+inline EpochDomain::ThreadState::~ThreadState() {
+  if (slot != nullptr) {
+    slot->epoch.store(kIdle, std::memory_order_release);
+    slot->taken.store(false, std::memory_order_release);
+  }
+}
+
+inline EpochDomain::ThreadState& EpochDomain::ThisThread() {
+  thread_local ThreadState state;
+
+  if (state.slot == nullptr) {
+    for (auto& slot : slots_) {
+      bool expected = false;
+      if (!slot.taken.load(std::memory_order_relaxed) && slot.taken.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+        state.slot = &slot;
+        break;
+      }
+    }
+
+    if (state.slot == nullptr) {
+      throw std::length_error("EpochDomain can't track more than kMaxThreads reading threads");
+    }
+  }
+
+  return state;
+}
+
+inline EpochDomain::Guard EpochDomain::Pin() {
+  auto& state = ThisThread();
+
+  // seq_cst store: either the writer scanning slots sees this pin,
+  // or the loads of the reader which follow see everything the writer published before the scan
+  if (state.depth++ == 0) {
+    state.slot->epoch.store(epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+  }
+
+  return Guard();
+}
+
+inline void EpochDomain::Unpin() {
+  auto& state = ThisThread();
+
+  if (--state.depth == 0) {
+    state.slot->epoch.store(kIdle, std::memory_order_release);
+  }
+}
+
+inline std::uint64_t EpochDomain::Current() const {
+  return epoch_.load(std::memory_order_seq_cst);
+}
+
+inline void EpochDomain::Advance() {
+  epoch_.fetch_add(1, std::memory_order_seq_cst);
+}
+
+inline std::uint64_t EpochDomain::MinPinned() const {
+  auto result = kIdle;
+  for (const auto& slot : slots_) {
+    result = std::min(result, slot.epoch.load(std::memory_order_seq_cst));
+  }
+
+  return result;
+}
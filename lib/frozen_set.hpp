@@ -0,0 +1,373 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <lib/comparator.hpp>
+
+/* Inorder iterator over keys stored in Eytzinger (BFS) order: node k has children 2k and 2k + 1,
+ * positions are 1-based, 0 is the "end" one. Walks the implicit tree the same way
+ * InOrder walks the pointer one, just with index arithmetics instead of pointers */
+template <typename T>
+struct EytzingerIterator {
+  EytzingerIterator() = default;
+  EytzingerIterator(const T* keys, std::size_t size, std::size_t position)
+    : keys_{keys}, size_{size}, position_{position} {}
+
+  using value_type = T;
+  using difference_type = std::ptrdiff_t;
+  using reference = const T&;
+  using pointer = const T*;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  reference operator*() const;
+  pointer operator->() const;
+
+  EytzingerIterator& operator++();
+  EytzingerIterator& operator--();
+  EytzingerIterator operator++(int);
+  EytzingerIterator operator--(int);
+
+  bool operator==(const EytzingerIterator& other) const;
+
+  std::size_t position() const;
+
+private:
+  const T* keys_ = nullptr; // keys_[k - 1] is the key at position k
+  std::size_t size_ = 0;
+  std::size_t position_ = 0;
+};
+
+template <typename T>
+const T& EytzingerIterator<T>::operator*() const {
+  return keys_[position_ - 1];
+}
+
+template <typename T>
+const T* EytzingerIterator<T>::operator->() const {
+  return keys_ + position_ - 1;
+}
+
+template <typename T>
+EytzingerIterator<T>& EytzingerIterator<T>::operator++() {
+  if (2 * position_ + 1 <= size_) {
+    // leftmost node of the right subtree
+    position_ = 2 * position_ + 1;
+    position_ <<= std::countl_zero(position_) - std::countl_zero(size_);
+    if (position_ > size_) {
+      position_ >>= 1;
+    }
+  } else {
+    // climb while coming from the right, the root climbs to 0 which is the "end"
+    position_ >>= std::countr_one(position_) + 1;
+  }
+
+  return *this;
+}
+
+template <typename T>
+EytzingerIterator<T>& EytzingerIterator<T>::operator--() {
+  // "end" behaves as the parent of the root, which the whole tree is the left subtree of
+  std::size_t left = position_ == 0 ? 1 : 2 * position_;
+
+  if (left <= size_) {
+    // rightmost node of the left subtree
+    position_ = left;
+    while (2 * position_ + 1 <= size_) {
+      position_ = 2 * position_ + 1;
+    }
+  } else {
+    // climb while coming from the left
+    position_ >>= std::countr_zero(position_) + 1;
+  }
+
+  return *this;
+}
+
+template <typename T>
+EytzingerIterator<T> EytzingerIterator<T>::operator++(int) {
+  auto copy = *this;
+  ++*this;
+  return copy;
+}
+
+template <typename T>
+EytzingerIterator<T> EytzingerIterator<T>::operator--(int) {
+  auto copy = *this;
+  --*this;
+  return copy;
+}
+
+template <typename T>
+bool EytzingerIterator<T>::operator==(const EytzingerIterator& other) const {
+  return position_ == other.position_ && keys_ == other.keys_;
+}
+
+template <typename T>
+std::size_t EytzingerIterator<T>::position() const {
+  return position_;
+}
+
+// levels prefetched ahead: descendants that far down are adjacent and fill about one cache line
+template <typename Key>
+inline constexpr int kEytzingerPrefetchLevels = std::max(1, static_cast<int>(std::bit_width(64 / std::max<std::size_t>(sizeof(Key), 1))) - 1);
+
+/* First position among size keys in Eytzinger order whose key isn't less (is_upper: is greater)
+ * than key, 0 if there is none. The search is branchless: every level costs a comparison
+ * and a shift, while descendants a few levels down are prefetched ahead of time */
+template <bool is_upper, typename Key, typename Comparator, typename K>
+std::size_t EytzingerSearch(const Key* data, std::size_t size, const Comparator& comparator, const K& key) {
+  const Key* keys = data - 1; // 1-based
+  std::size_t position = 1;
+
+  while (position <= size) {
+    __builtin_prefetch(keys + std::min(position << kEytzingerPrefetchLevels<Key>, size));
+
+    // go right while the key at position is less (not greater) than the searched one
+    bool go_right;
+    if constexpr (is_upper) {
+      go_right = !comparator(key, keys[position]);
+    } else {
+      go_right = comparator(keys[position], key);
+    }
+
+    position = 2 * position + go_right;
+  }
+
+  // path ends with the last left turn followed by right turns only, the answer is where it turned left
+  return position >> (std::countr_one(position) + 1);
+}
+
+/* Read-only sorted set packed into one contiguous array in Eytzinger order.
+ * First levels of the implicit tree share a few cache lines, so they stay hot,
+ * see EytzingerSearch */
+template<
+  typename Key,
+  typename Comparator = std::less<Key>,
+  typename Alloc = std::allocator<Key>
+>
+class FrozenSet {
+public:
+  using value_type = Key;
+  using key_type = Key;
+  using key_compare = Comparator;
+  using value_compare = Comparator;
+  using reference = const Key&;
+  using const_reference = const Key&;
+  using allocator_type = Alloc;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  using iterator = EytzingerIterator<Key>;
+  using const_iterator = iterator;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = reverse_iterator;
+
+  FrozenSet() = default;
+
+  // sorted unique input is copied as is, anything else gets sorted and deduplicated first
+  template <std::input_iterator It>
+  FrozenSet(It first, It last, const Comparator& comparator = Comparator(), const Alloc& allocator = Alloc());
+  FrozenSet(std::initializer_list<Key> keys, const Comparator& comparator = Comparator());
+
+  [[nodiscard]] const_iterator begin() const;
+  [[nodiscard]] const_iterator end() const;
+  [[nodiscard]] const_iterator cbegin() const;
+  [[nodiscard]] const_iterator cend() const;
+  [[nodiscard]] const_reverse_iterator rbegin() const;
+  [[nodiscard]] const_reverse_iterator rend() const;
+
+  [[nodiscard]] const_iterator find(const Key& key) const;
+  [[nodiscard]] bool contains(const Key& key) const;
+  [[nodiscard]] const_iterator lower_bound(const Key& key) const;
+  [[nodiscard]] const_iterator upper_bound(const Key& key) const;
+
+  // overloads below accept anything comparable with Key, if the comparator is transparent
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] const_iterator find(const K& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] bool contains(const K& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] const_iterator lower_bound(const K& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] const_iterator upper_bound(const K& key) const;
+
+  [[nodiscard]] size_type size() const;
+  [[nodiscard]] bool empty() const;
+
+  // keys in Eytzinger order, the key at position k is data()[k - 1]
+  [[nodiscard]] const Key* data() const;
+
+private:
+  // numbers positions of the subtree rooted at position in inorder starting from next,
+  // returns the next unused number
+  static size_type Layout(std::vector<size_type>& order, size_type next, size_type position);
+
+  // first position whose key isn't less (is_upper: is greater) than key, 0 if there is none
+  template <bool is_upper, typename K>
+  std::size_t Search(const K& key) const;
+
+  template <typename K>
+  const_iterator FindPosition(const K& key) const;
+
+  Comparator comparator_;
+  std::vector<Key, Alloc> keys_;
+};
+
+template <typename Key, typename Comparator, typename Alloc>
+template <std::input_iterator It>
+FrozenSet<Key, Comparator, Alloc>::FrozenSet(It first, It last, const Comparator& comparator, const Alloc& allocator)
+  : comparator_{comparator},
+    keys_(allocator) {
+  std::vector<Key, Alloc> sorted(first, last, allocator);
+
+  auto is_ascending = [this](const Key& lhs, const Key& rhs) { return comparator_(lhs, rhs); };
+  if (std::adjacent_find(sorted.begin(), sorted.end(), std::not_fn(is_ascending)) != sorted.end()) {
+    std::stable_sort(sorted.begin(), sorted.end(), comparator_);
+    auto is_equivalent = [this](const Key& lhs, const Key& rhs) { return !comparator_(lhs, rhs); };
+    sorted.erase(std::unique(sorted.begin(), sorted.end(), is_equivalent), sorted.end());
+  }
+
+  // sorted index of the key at every position, then keys are moved over in position order
+  std::vector<size_type> order(sorted.size());
+  Layout(order, 0, 1);
+
+  keys_.reserve(sorted.size());
+  for (auto index : order) {
+    keys_.push_back(std::move(sorted[index]));
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+FrozenSet<Key, Comparator, Alloc>::FrozenSet(std::initializer_list<Key> keys, const Comparator& comparator)
+  : FrozenSet(keys.begin(), keys.end(), comparator) {
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename FrozenSet<Key, Comparator, Alloc>::size_type FrozenSet<Key, Comparator, Alloc>::Layout(std::vector<size_type>& order, size_type next, size_type position) {
+  // inorder walk of the implicit tree, depth is logarithmic
+  if (position > order.size()) {
+    return next;
+  }
+
+  next = Layout(order, next, 2 * position);
+  order[position - 1] = next++;
+  return Layout(order, next, 2 * position + 1);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <bool is_upper, typename K>
+std::size_t FrozenSet<Key, Comparator, Alloc>::Search(const K& key) const {
+  return EytzingerSearch<is_upper>(keys_.data(), keys_.size(), comparator_, key);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K>
+typename FrozenSet<Key, Comparator, Alloc>::const_iterator FrozenSet<Key, Comparator, Alloc>::FindPosition(const K& key) const {
+  auto position = Search<false>(key);
+
+  if (position == 0 || comparator_(key, keys_[position - 1])) {
+    return end();
+  }
+
+  return const_iterator(keys_.data(), keys_.size(), position);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename FrozenSet<Key, Comparator, Alloc>::const_iterator FrozenSet<Key, Comparator, Alloc>::begin() const {
+  return ++end(); // "end" is the parent of the root
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename FrozenSet<Key, Comparator, Alloc>::const_iterator FrozenSet<Key, Comparator, Alloc>::end() const {
+  return const_iterator(keys_.data(), keys_.size(), 0);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename FrozenSet<Key, Comparator, Alloc>::const_iterator FrozenSet<Key, Comparator, Alloc>::cbegin() const {
+  return begin();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename FrozenSet<Key, Comparator, Alloc>::const_iterator FrozenSet<Key, Comparator, Alloc>::cend() const {
+  return end();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename FrozenSet<Key, Comparator, Alloc>::const_reverse_iterator FrozenSet<Key, Comparator, Alloc>::rbegin() const {
+  return const_reverse_iterator(end());
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename FrozenSet<Key, Comparator, Alloc>::const_reverse_iterator FrozenSet<Key, Comparator, Alloc>::rend() const {
+  return const_reverse_iterator(begin());
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename FrozenSet<Key, Comparator, Alloc>::const_iterator FrozenSet<Key, Comparator, Alloc>::find(const Key& key) const {
+  return FindPosition(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool FrozenSet<Key, Comparator, Alloc>::contains(const Key& key) const {
+  return FindPosition(key) != end();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename FrozenSet<Key, Comparator, Alloc>::const_iterator FrozenSet<Key, Comparator, Alloc>::lower_bound(const Key& key) const {
+  return const_iterator(keys_.data(), keys_.size(), Search<false>(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename FrozenSet<Key, Comparator, Alloc>::const_iterator FrozenSet<Key, Comparator, Alloc>::upper_bound(const Key& key) const {
+  return const_iterator(keys_.data(), keys_.size(), Search<true>(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K> requires TransparentComparator<Comparator>
+typename FrozenSet<Key, Comparator, Alloc>::const_iterator FrozenSet<Key, Comparator, Alloc>::find(const K& key) const {
+  return FindPosition(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K> requires TransparentComparator<Comparator>
+bool FrozenSet<Key, Comparator, Alloc>::contains(const K& key) const {
+  return FindPosition(key) != end();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K> requires TransparentComparator<Comparator>
+typename FrozenSet<Key, Comparator, Alloc>::const_iterator FrozenSet<Key, Comparator, Alloc>::lower_bound(const K& key) const {
+  return const_iterator(keys_.data(), keys_.size(), Search<false>(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K> requires TransparentComparator<Comparator>
+typename FrozenSet<Key, Comparator, Alloc>::const_iterator FrozenSet<Key, Comparator, Alloc>::upper_bound(const K& key) const {
+  return const_iterator(keys_.data(), keys_.size(), Search<true>(key));
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename FrozenSet<Key, Comparator, Alloc>::size_type FrozenSet<Key, Comparator, Alloc>::size() const {
+  return keys_.size();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool FrozenSet<Key, Comparator, Alloc>::empty() const {
+  return keys_.empty();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+const Key* FrozenSet<Key, Comparator, Alloc>::data() const {
+  return keys_.data();
+}
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <compare>
+#include <cstddef>
+#include <iterator>
+
 #include <lib/node.hpp>
 #include <lib/traversals.hpp>
 
 template <typename T, typename Traversal = InOrder<T>>
 struct Iterator {
+  Iterator() = default;
   Iterator(Node<T>* ptr) : ptr_{ptr} {};
 
   static Iterator GetBegin(Node<T>* root_);
@@ -13,12 +18,35 @@ struct Iterator {
   using ref_type = const T&;
   using ptr_type = const T*;
 
-  ptr_type operator->();
-  ref_type operator*();
+  // std::iterator_traits requirements, so std algorithms and ranges accept it
+  using value_type = T;
+  using difference_type = std::ptrdiff_t;
+  using reference = ref_type;
+  using pointer = ptr_type;
+  // ranked traversals add jumps below, but they cost O(height) rather than O(1), so the
+  // iterator doesn't claim random access. Set::nth, rank and distance use them
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  ptr_type operator->() const;
+  ref_type operator*() const;
 
 
   Iterator& operator++();
   Iterator& operator--();
+  Iterator operator++(int);
+  Iterator operator--(int);
+
+  Iterator& operator+=(difference_type n) requires RankedTraversal<Traversal, T>;
+  Iterator& operator-=(difference_type n) requires RankedTraversal<Traversal, T>;
+  Iterator operator+(difference_type n) const requires RankedTraversal<Traversal, T>;
+  Iterator operator-(difference_type n) const requires RankedTraversal<Traversal, T>;
+  difference_type operator-(const Iterator<T, Traversal>& other) const requires RankedTraversal<Traversal, T>;
+  ref_type operator[](difference_type n) const requires RankedTraversal<Traversal, T>;
+  std::strong_ordering operator<=>(const Iterator<T, Traversal>& other) const requires RankedTraversal<Traversal, T>;
+
+  friend Iterator operator+(difference_type n, const Iterator& it) requires RankedTraversal<Traversal, T> {
+    return it + n;
+  }
 
   Node<T>* node_ptr(); // haha
 
@@ -27,7 +55,7 @@ struct Iterator {
 
 private:
   
-  Node<T>* ptr_; 
+  Node<T>* ptr_ = nullptr; 
 };
 
 template <typename T, typename Traversal>
@@ -68,11 +96,64 @@ Iterator<T, Traversal>& Iterator<T, Traversal>::operator--() {
 }
 
 template <typename T, typename Traversal>
-Iterator<T, Traversal>::ref_type Iterator<T, Traversal>::operator*() {
+Iterator<T, Traversal> Iterator<T, Traversal>::operator++(int) {
+  auto copy = *this;
+  ++*this;
+  return copy;
+}
+
+template <typename T, typename Traversal>
+Iterator<T, Traversal> Iterator<T, Traversal>::operator--(int) {
+  auto copy = *this;
+  --*this;
+  return copy;
+}
+
+template <typename T, typename Traversal>
+Iterator<T, Traversal>::ref_type Iterator<T, Traversal>::operator*() const {
   return ptr_->key;
 }
 
 template <typename T, typename Traversal>
-Iterator<T, Traversal>::ptr_type Iterator<T, Traversal>::operator->() {
+Iterator<T, Traversal>::ptr_type Iterator<T, Traversal>::operator->() const {
   return &ptr_->key;
 }
+
+template <typename T, typename Traversal>
+Iterator<T, Traversal>& Iterator<T, Traversal>::operator+=(difference_type n) requires RankedTraversal<Traversal, T> {
+  ptr_ = Traversal::Advance(ptr_, n);
+  return *this;
+}
+
+template <typename T, typename Traversal>
+Iterator<T, Traversal>& Iterator<T, Traversal>::operator-=(difference_type n) requires RankedTraversal<Traversal, T> {
+  ptr_ = Traversal::Advance(ptr_, -n);
+  return *this;
+}
+
+template <typename T, typename Traversal>
+Iterator<T, Traversal> Iterator<T, Traversal>::operator+(difference_type n) const requires RankedTraversal<Traversal, T> {
+  auto copy = *this;
+  return copy += n;
+}
+
+template <typename T, typename Traversal>
+Iterator<T, Traversal> Iterator<T, Traversal>::operator-(difference_type n) const requires RankedTraversal<Traversal, T> {
+  auto copy = *this;
+  return copy -= n;
+}
+
+template <typename T, typename Traversal>
+Iterator<T, Traversal>::difference_type Iterator<T, Traversal>::operator-(const Iterator<T, Traversal>& other) const requires RankedTraversal<Traversal, T> {
+  return Traversal::Rank(ptr_) - Traversal::Rank(other.ptr_);
+}
+
+template <typename T, typename Traversal>
+Iterator<T, Traversal>::ref_type Iterator<T, Traversal>::operator[](difference_type n) const requires RankedTraversal<Traversal, T> {
+  return *(*this + n);
+}
+
+template <typename T, typename Traversal>
+std::strong_ordering Iterator<T, Traversal>::operator<=>(const Iterator<T, Traversal>& other) const requires RankedTraversal<Traversal, T> {
+  return Traversal::Rank(ptr_) <=> Traversal::Rank(other.ptr_);
+}
@@ -0,0 +1,354 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <lib/comparator.hpp>
+#include <lib/frozen_set.hpp>
+
+/* On-disk image of a set: a header followed by the keys in Eytzinger order, the same
+ * layout FrozenSet keeps in memory. It holds offsets only, so it's valid wherever it's
+ * mapped, and is searched right in the mapping. Keys are stored as raw bytes, which makes
+ * the image specific to the key type, its comparator and the byte order of the machine */
+struct SetImageHeader {
+  static constexpr char kMagic[8] = {'S', 'E', 'T', 'I', 'M', 'A', 'G', 'E'};
+  static constexpr std::uint32_t kVersion = 1;
+  static constexpr std::uint32_t kByteOrder = 0x01020304;
+  static constexpr std::uint64_t kKeysOffset = 64; // keys start a cache line in
+
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order; // reads differently on a machine of the other endianness
+  std::uint64_t key_size;
+  std::uint64_t count;
+  std::uint64_t keys_offset;
+  std::uint64_t checksum; // of the key bytes
+};
+
+static_assert(sizeof(SetImageHeader) <= SetImageHeader::kKeysOffset);
+
+// FNV-1a, 8 bytes at a time
+inline std::uint64_t SetImageChecksum(const void* data, std::size_t size) {
+  constexpr std::uint64_t kPrime = 0x100000001b3;
+  std::uint64_t hash = 0xcbf29ce484222325;
+
+  auto* bytes = static_cast<const unsigned char*>(data);
+  std::size_t i = 0;
+  for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    hash = (hash ^ word) * kPrime;
+  }
+  for (; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * kPrime;
+  }
+
+  return hash;
+}
+
+// writes a uniquely named temporary file next to path and renames it over path, so
+// processes that have the old image mapped keep it intact and concurrent saves don't
+// write into each other's file. The data is synced first, so after a crash path holds
+// either the old image or the complete new one
+template <typename Key, typename Comparator, typename Alloc>
+void WriteSetImage(const std::string& path, const FrozenSet<Key, Comparator, Alloc>& frozen) {
+  static_assert(std::is_trivially_copyable_v<Key>, "only trivially copyable keys can be stored as bytes");
+
+  auto bytes = frozen.size() * sizeof(Key);
+  SetImageHeader header{};
+  std::memcpy(header.magic, SetImageHeader::kMagic, sizeof(header.magic));
+  header.version = SetImageHeader::kVersion;
+  header.byte_order = SetImageHeader::kByteOrder;
+  header.key_size = sizeof(Key);
+  header.count = frozen.size();
+  header.keys_offset = SetImageHeader::kKeysOffset;
+  header.checksum = SetImageChecksum(frozen.data(), bytes);
+
+  std::string temporary = path + ".XXXXXX";
+  int fd = ::mkstemp(temporary.data());
+  if (fd == -1) {
+    throw std::system_error(errno, std::generic_category(), "can't create a temporary file for " + path);
+  }
+
+  // mkstemp creates it private to the owner, images are meant to be mapped by others
+  std::FILE* file = ::fchmod(fd, 0644) == 0 ? ::fdopen(fd, "wb") : nullptr;
+  if (file == nullptr) {
+    int error = errno;
+    ::close(fd);
+    std::remove(temporary.c_str());
+    throw std::system_error(error, std::generic_category(), "can't create " + temporary);
+  }
+
+  char padding[SetImageHeader::kKeysOffset - sizeof(SetImageHeader)] = {};
+  bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 std::fwrite(padding, sizeof(padding), 1, file) == 1 &&
+                 (bytes == 0 || std::fwrite(frozen.data(), bytes, 1, file) == 1) &&
+                 std::fflush(file) == 0 &&
+                 ::fsync(fd) == 0;
+  written = std::fclose(file) == 0 && written;
+
+  if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+    int error = errno;
+    std::remove(temporary.c_str());
+    throw std::system_error(error, std::generic_category(), "can't write " + path);
+  }
+}
+
+/* Read-only set served from a memory-mapped image, see SetImageHeader. Opening costs
+ * a header check, plus a pass over the keys if the checksum is verified. Pages are
+ * loaded on first touch and shared between all processes which map the same file */
+template<
+  typename Key,
+  typename Comparator = std::less<Key>
+>
+class MappedSet {
+  static_assert(std::is_trivially_copyable_v<Key>, "only trivially copyable keys can be mapped");
+
+public:
+  using value_type = Key;
+  using key_type = Key;
+  using key_compare = Comparator;
+  using value_compare = Comparator;
+  using reference = const Key&;
+  using const_reference = const Key&;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  using iterator = EytzingerIterator<Key>;
+  using const_iterator = iterator;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = reverse_iterator;
+
+  // throws std::system_error if the file can't be mapped, std::runtime_error if it isn't
+  // an image of this key type
+  explicit MappedSet(const std::string& path, bool verify_checksum = true, const Comparator& comparator = Comparator());
+
+  MappedSet(MappedSet&& other) noexcept;
+  MappedSet& operator=(MappedSet&& other) noexcept;
+  ~MappedSet();
+
+  MappedSet(const MappedSet&) = delete;
+  MappedSet& operator=(const MappedSet&) = delete;
+
+  [[nodiscard]] const_iterator begin() const;
+  [[nodiscard]] const_iterator end() const;
+  [[nodiscard]] const_reverse_iterator rbegin() const;
+  [[nodiscard]] const_reverse_iterator rend() const;
+
+  [[nodiscard]] const_iterator find(const Key& key) const;
+  [[nodiscard]] bool contains(const Key& key) const;
+  [[nodiscard]] const_iterator lower_bound(const Key& key) const;
+  [[nodiscard]] const_iterator upper_bound(const Key& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] const_iterator find(const K& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] bool contains(const K& key) const;
+
+  [[nodiscard]] size_type size() const;
+  [[nodiscard]] bool empty() const;
+
+private:
+  template <typename K>
+  const_iterator FindPosition(const K& key) const;
+
+  void Unmap();
+
+  Comparator comparator_;
+  void* mapping_ = nullptr;
+  std::size_t mapping_size_ = 0;
+  const Key* keys_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+template <typename Key, typename Comparator>
+MappedSet<Key, Comparator>::MappedSet(const std::string& path, bool verify_checksum, const Comparator& comparator)
+  : comparator_{comparator} {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "can't open " + path);
+  }
+
+  struct stat status;
+  if (::fstat(fd, &status) != 0) {
+    int error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::generic_category(), "can't stat " + path);
+  }
+
+  mapping_size_ = static_cast<std::size_t>(status.st_size);
+  if (mapping_size_ < sizeof(SetImageHeader)) {
+    ::close(fd);
+    throw std::runtime_error(path + " is too short to be a set image");
+  }
+
+  // the mapping outlives the descriptor
+  mapping_ = ::mmap(nullptr, mapping_size_, PROT_READ, MAP_SHARED, fd, 0);
+  int error = errno;
+  ::close(fd);
+  if (mapping_ == MAP_FAILED) {
+    mapping_ = nullptr;
+    throw std::system_error(error, std::generic_category(), "can't map " + path);
+  }
+
+  SetImageHeader header;
+  std::memcpy(&header, mapping_, sizeof(header));
+
+  const char* problem = nullptr;
+  if (std::memcmp(header.magic, SetImageHeader::kMagic, sizeof(header.magic)) != 0) {
+    problem = " is not a set image";
+  } else if (header.version != SetImageHeader::kVersion) {
+    problem = " has an unsupported version";
+  } else if (header.byte_order != SetImageHeader::kByteOrder) {
+    problem = " was written with a different byte order";
+  } else if (header.key_size != sizeof(Key)) {
+    problem = " holds keys of a different size";
+  } else if (header.keys_offset % alignof(Key) != 0 || header.keys_offset > mapping_size_ ||
+             header.count > (mapping_size_ - header.keys_offset) / sizeof(Key)) {
+    problem = " is truncated";
+  }
+
+  if (problem == nullptr) {
+    keys_ = reinterpret_cast<const Key*>(static_cast<const char*>(mapping_) + header.keys_offset);
+    size_ = header.count;
+
+    if (verify_checksum && SetImageChecksum(keys_, size_ * sizeof(Key)) != header.checksum) {
+      problem = " is corrupted";
+    }
+  }
+
+  if (problem != nullptr) {
+    Unmap();
+    throw std::runtime_error(path + problem);
+  }
+}
+
+template <typename Key, typename Comparator>
+MappedSet<Key, Comparator>::MappedSet(MappedSet&& other) noexcept
+  : comparator_{std::move(other.comparator_)},
+    mapping_{std::exchange(other.mapping_, nullptr)},
+    mapping_size_{std::exchange(other.mapping_size_, 0)},
+    keys_{std::exchange(other.keys_, nullptr)},
+    size_{std::exchange(other.size_, 0)} {
+}
+
+template <typename Key, typename Comparator>
+MappedSet<Key, Comparator>& MappedSet<Key, Comparator>::operator=(MappedSet&& other) noexcept {
+  if (this != &other) {
+    Unmap();
+    comparator_ = std::move(other.comparator_);
+    mapping_ = std::exchange(other.mapping_, nullptr);
+    mapping_size_ = std::exchange(other.mapping_size_, 0);
+    keys_ = std::exchange(other.keys_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+
+  return *this;
+}
+
+template <typename Key, typename Comparator>
+MappedSet<Key, Comparator>::~MappedSet() {
+  Unmap();
+}
+
+template <typename Key, typename Comparator>
+void MappedSet<Key, Comparator>::Unmap() {
+  if (mapping_ != nullptr) {
+    ::munmap(mapping_, mapping_size_);
+  }
+
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  keys_ = nullptr;
+  size_ = 0;
+}
+
+template <typename Key, typename Comparator>
+template <typename K>
+typename MappedSet<Key, Comparator>::const_iterator MappedSet<Key, Comparator>::FindPosition(const K& key) const {
+  auto position = EytzingerSearch<false>(keys_, size_, comparator_, key);
+
+  if (position == 0 || comparator_(key, keys_[position - 1])) {
+    return end();
+  }
+
+  return const_iterator(keys_, size_, position);
+}
+
+template <typename Key, typename Comparator>
+typename MappedSet<Key, Comparator>::const_iterator MappedSet<Key, Comparator>::begin() const {
+  return ++end(); // "end" is the parent of the root
+}
+
+template <typename Key, typename Comparator>
+typename MappedSet<Key, Comparator>::const_iterator MappedSet<Key, Comparator>::end() const {
+  return const_iterator(keys_, size_, 0);
+}
+
+template <typename Key, typename Comparator>
+typename MappedSet<Key, Comparator>::const_reverse_iterator MappedSet<Key, Comparator>::rbegin() const {
+  return const_reverse_iterator(end());
+}
+
+template <typename Key, typename Comparator>
+typename MappedSet<Key, Comparator>::const_reverse_iterator MappedSet<Key, Comparator>::rend() const {
+  return const_reverse_iterator(begin());
+}
+
+template <typename Key, typename Comparator>
+typename MappedSet<Key, Comparator>::const_iterator MappedSet<Key, Comparator>::find(const Key& key) const {
+  return FindPosition(key);
+}
+
+template <typename Key, typename Comparator>
+bool MappedSet<Key, Comparator>::contains(const Key& key) const {
+  return FindPosition(key) != end();
+}
+
+template <typename Key, typename Comparator>
+typename MappedSet<Key, Comparator>::const_iterator MappedSet<Key, Comparator>::lower_bound(const Key& key) const {
+  return const_iterator(keys_, size_, EytzingerSearch<false>(keys_, size_, comparator_, key));
+}
+
+template <typename Key, typename Comparator>
+typename MappedSet<Key, Comparator>::const_iterator MappedSet<Key, Comparator>::upper_bound(const Key& key) const {
+  return const_iterator(keys_, size_, EytzingerSearch<true>(keys_, size_, comparator_, key));
+}
+
+template <typename Key, typename Comparator>
+template <typename K> requires TransparentComparator<Comparator>
+typename MappedSet<Key, Comparator>::const_iterator MappedSet<Key, Comparator>::find(const K& key) const {
+  return FindPosition(key);
+}
+
+template <typename Key, typename Comparator>
+template <typename K> requires TransparentComparator<Comparator>
+bool MappedSet<Key, Comparator>::contains(const K& key) const {
+  return FindPosition(key) != end();
+}
+
+template <typename Key, typename Comparator>
+typename MappedSet<Key, Comparator>::size_type MappedSet<Key, Comparator>::size() const {
+  return size_;
+}
+
+template <typename Key, typename Comparator>
+bool MappedSet<Key, Comparator>::empty() const {
+  return size_ == 0;
+}
@@ -13,5 +13,8 @@ struct Node {
   Node* right = nullptr;
   Node* parent = nullptr;
 
+  // bookkeeping of the balancing policy (color or balance factor)
+  signed char balance = 0;
+
   Key key;
 };
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include <lib/node.hpp>
+
+/* Owner of a node extracted from a Set, the key lives in the same allocation
+ * it had inside of the tree, so moving it between sets never copies the key.
+ * Alloc is the node allocator of the set, it's kept to free the node if nobody takes it */
+template <typename Key, typename Alloc>
+class NodeHandle {
+public:
+  using value_type = Key;
+  using allocator_type = Alloc;
+
+  NodeHandle() noexcept = default;
+  NodeHandle(NodeHandle&& other) noexcept;
+  NodeHandle& operator=(NodeHandle&& other) noexcept;
+  ~NodeHandle();
+
+  [[nodiscard]] bool empty() const noexcept;
+  explicit operator bool() const noexcept;
+
+  // key can be modified while it's out of the tree
+  value_type& value() const;
+  allocator_type get_allocator() const;
+
+  void swap(NodeHandle& other) noexcept;
+
+private:
+  template <typename, typename, typename, typename>
+  friend class Set;
+
+  NodeHandle(Node<Key>* node, const allocator_type& allocator);
+
+  // gives up ownership, so the node can be linked into a tree
+  Node<Key>* release() noexcept;
+  void reset() noexcept;
+
+  Node<Key>* node_ = nullptr;
+  std::optional<allocator_type> allocator_; // allocators aren't required to be default constructible
+};
+
+template <typename Key, typename Alloc>
+NodeHandle<Key, Alloc>::NodeHandle(Node<Key>* node, const allocator_type& allocator)
+  : node_{node},
+    allocator_{allocator} {
+}
+
+template <typename Key, typename Alloc>
+NodeHandle<Key, Alloc>::NodeHandle(NodeHandle&& other) noexcept
+  : node_{std::exchange(other.node_, nullptr)},
+    allocator_{std::move(other.allocator_)} {
+  other.allocator_.reset();
+}
+
+template <typename Key, typename Alloc>
+NodeHandle<Key, Alloc>& NodeHandle<Key, Alloc>::operator=(NodeHandle&& other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+
+  // node has to go back to the allocator it came from, so the allocator always follows the node
+  reset();
+  node_ = std::exchange(other.node_, nullptr);
+  allocator_ = std::move(other.allocator_);
+  other.allocator_.reset();
+
+  return *this;
+}
+
+template <typename Key, typename Alloc>
+NodeHandle<Key, Alloc>::~NodeHandle() {
+  reset();
+}
+
+template <typename Key, typename Alloc>
+void NodeHandle<Key, Alloc>::reset() noexcept {
+  if (node_ == nullptr) {
+    return;
+  }
+
+  // allocator may hand out a type derived from Node, depending on the augmentation of the set
+  auto* ptr = static_cast<typename std::allocator_traits<allocator_type>::value_type*>(node_);
+  std::allocator_traits<allocator_type>::destroy(*allocator_, ptr);
+  allocator_->deallocate(ptr, 1);
+  node_ = nullptr;
+  allocator_.reset(); // empty handles have no allocator
+}
+
+template <typename Key, typename Alloc>
+bool NodeHandle<Key, Alloc>::empty() const noexcept {
+  return node_ == nullptr;
+}
+
+template <typename Key, typename Alloc>
+NodeHandle<Key, Alloc>::operator bool() const noexcept {
+  return node_ != nullptr;
+}
+
+template <typename Key, typename Alloc>
+NodeHandle<Key, Alloc>::value_type& NodeHandle<Key, Alloc>::value() const {
+  assert(node_ != nullptr);
+  return node_->key;
+}
+
+template <typename Key, typename Alloc>
+NodeHandle<Key, Alloc>::allocator_type NodeHandle<Key, Alloc>::get_allocator() const {
+  assert(allocator_.has_value());
+  return *allocator_;
+}
+
+template <typename Key, typename Alloc>
+void NodeHandle<Key, Alloc>::swap(NodeHandle& other) noexcept {
+  std::swap(node_, other.node_);
+  std::swap(allocator_, other.allocator_);
+}
+
+template <typename Key, typename Alloc>
+Node<Key>* NodeHandle<Key, Alloc>::release() noexcept {
+  allocator_.reset();
+  return std::exchange(node_, nullptr);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+#include <lib/balancing.hpp>
+#include <lib/node.hpp>
+#include <lib/traversals.hpp>
+
+/* Order statistic mode: every node knows the size of its subtree, so positions of keys
+ * are found in O(height). Enabled by wrapping a balancing policy in OrderStatistic,
+ * sets with plain policies allocate plain nodes and don't pay for it */
+
+template <typename Key>
+struct SizedNode : Node<Key> {
+  using Node<Key>::Node;
+
+  std::size_t size = 1; // nodes in the subtree rooted here, including this one
+};
+
+// inorder traversal that can find nodes by their position
+template <typename T>
+struct RankedInOrder : InOrder<T> {
+  static std::size_t Size(const Node<T>* node) {
+    return node == nullptr ? 0 : static_cast<const SizedNode<T>*>(node)->size;
+  }
+
+  // number of nodes before node, size of the whole tree for the "end" node
+  static std::ptrdiff_t Rank(Node<T>* node) {
+    return Locate(node).first;
+  }
+
+  // node at position k, "end" node if there is no such one
+  static Node<T>* Select(Node<T>* header, std::size_t k) {
+    if (k >= Size(header->left)) {
+      return header;
+    }
+
+    auto* it = header->left;
+    while (true) {
+      auto left = Size(it->left);
+
+      if (k < left) {
+        it = it->left;
+      } else if (k == left) {
+        return it;
+      } else {
+        k -= left + 1;
+        it = it->right;
+      }
+    }
+  }
+
+  // node n positions away, the position must exist or be the "end" one
+  static Node<T>* Advance(Node<T>* node, std::ptrdiff_t n) {
+    auto [rank, header] = Locate(node);
+    assert(rank + n >= 0);
+
+    return Select(header, static_cast<std::size_t>(rank + n));
+  }
+
+private:
+  // rank of node and the "end" node of its tree, both found by a single climb
+  static std::pair<std::ptrdiff_t, Node<T>*> Locate(Node<T>* node) {
+    auto rank = static_cast<std::ptrdiff_t>(Size(node->left));
+
+    while (node->parent != nullptr) {
+      if (node->parent->right == node) {
+        rank += static_cast<std::ptrdiff_t>(Size(node->parent->left)) + 1;
+      }
+
+      node = node->parent;
+    }
+
+    return { rank, node };
+  }
+};
+
+struct SubtreeSize {
+  template <typename T>
+  using node = SizedNode<T>;
+
+  template <typename T>
+  using inorder = RankedInOrder<T>;
+
+  template <typename T>
+  static void Update(Node<T>* node) {
+    static_cast<SizedNode<T>*>(node)->size = RankedInOrder<T>::Size(node->left) + RankedInOrder<T>::Size(node->right) + 1;
+  }
+
+  template <typename T>
+  static void Copy(Node<T>* to, const Node<T>* from) {
+    static_cast<SizedNode<T>*>(to)->size = static_cast<const SizedNode<T>*>(from)->size;
+  }
+};
+
+// balancing policy Base which additionally keeps subtree sizes up to date
+template <typename Base = RedBlack>
+struct OrderStatistic : Base {
+  using augment = SubtreeSize;
+
+  // Augment is SubtreeSize, or a wrapper of it
+  template <typename Augment = SubtreeSize, typename T>
+  static void OnInsert(Node<T>* node, Node<T>* header) {
+    for (auto* it = node->parent; it != header; it = it->parent) {
+      ++static_cast<SizedNode<T>*>(it)->size;
+    }
+
+    Base::template OnInsert<Augment>(node, header);
+  }
+
+  template <typename Augment = SubtreeSize, typename T>
+  static void OnErase(Node<T>* removed, Node<T>* child, Node<T>* parent, bool was_left, Node<T>* header) {
+    // recounted rather than decremented, the node replacing the removed one is on this path too
+    for (auto* it = parent; it != header; it = it->parent) {
+      SubtreeSize::Update(it);
+    }
+
+    Base::template OnErase<Augment>(removed, child, parent, was_left, header);
+  }
+
+  template <typename T>
+  static void OnBuild(Node<T>* node, std::size_t left_size, std::size_t right_size, int depth, int max_depth) {
+    static_cast<SizedNode<T>*>(node)->size = left_size + right_size + 1;
+    Base::OnBuild(node, left_size, right_size, depth, max_depth);
+  }
+};
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <lib/persistent_tree.hpp>
+
+// node of PersistentSet, refs counts the parents and sets pointing at it
+template <typename Key>
+struct SharedNode {
+  using key_type = Key;
+
+  const SharedNode* left = nullptr;
+  const SharedNode* right = nullptr;
+  std::uint64_t generation = 0;
+  int height = 1;
+  Key key;
+  mutable std::atomic<std::uint32_t> refs{1};
+};
+
+/* Set with O(1) copies. Copies share all of their nodes, a write copies the O(log n)
+ * nodes on the path it changes and leaves the rest shared, so n snapshots taken between
+ * k writes cost O(k log n) nodes. A node is freed with the last tree that reaches it.
+ * Copies may be read and written from different threads, a single object may not be
+ * written concurrently. Allocators of the copies must be able to free each other's nodes */
+template<
+  typename Key,
+  typename Comparator = std::less<Key>,
+  typename Alloc = std::allocator<Key>
+>
+class PersistentSet {
+public:
+  using value_type = Key;
+  using key_type = Key;
+  using key_compare = Comparator;
+  using size_type = std::size_t;
+  using allocator_type = std::allocator_traits<Alloc>::template rebind_alloc<SharedNode<Key>>;
+  using const_iterator = PersistentIterator<SharedNode<Key>>;
+  using iterator = const_iterator;
+
+  PersistentSet() = default;
+  explicit PersistentSet(const Comparator& comparator, const allocator_type& allocator = allocator_type());
+
+  template <std::forward_iterator It>
+  PersistentSet(It first, It last, const Comparator& comparator = Comparator(), const allocator_type& allocator = allocator_type());
+  PersistentSet(std::initializer_list<Key> keys, const Comparator& comparator = Comparator());
+
+  PersistentSet(const PersistentSet& other);
+  PersistentSet(PersistentSet&& other) noexcept;
+  PersistentSet& operator=(const PersistentSet& other);
+  PersistentSet& operator=(PersistentSet&& other) noexcept;
+  ~PersistentSet();
+
+  // same as a copy, spelled out for the readers
+  [[nodiscard]] PersistentSet snapshot() const;
+
+  bool insert(const Key& key);
+  bool insert(Key&& key);
+  size_type erase(const Key& key);
+  void clear();
+  void swap(PersistentSet& other) noexcept;
+
+  [[nodiscard]] const_iterator begin() const;
+  [[nodiscard]] const_iterator end() const;
+
+  [[nodiscard]] bool contains(const Key& key) const;
+  [[nodiscard]] const_iterator find(const Key& key) const;
+  [[nodiscard]] const_iterator lower_bound(const Key& key) const;
+
+  [[nodiscard]] size_type size() const;
+  [[nodiscard]] bool empty() const;
+
+private:
+  using Node = SharedNode<Key>;
+
+  template <typename K>
+  bool InsertKey(K& key);
+
+  // root becomes the tree of the set, nodes of the running write take their children
+  void Commit(const Node* root);
+
+  static void Retain(const Node* node);
+  void Release(const Node* node);
+
+  PathCopyingTree<Node, Comparator, Alloc> tree_;
+  const Node* root_ = nullptr;
+  size_type size_ = 0;
+};
+
+template <typename Key, typename Comparator, typename Alloc>
+PersistentSet<Key, Comparator, Alloc>::PersistentSet(const Comparator& comparator, const allocator_type& allocator)
+  : tree_{comparator, allocator} {
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <std::forward_iterator It>
+PersistentSet<Key, Comparator, Alloc>::PersistentSet(It first, It last, const Comparator& comparator, const allocator_type& allocator)
+  : tree_{comparator, allocator} {
+  std::vector<Key> sorted(first, last);
+  auto is_equivalent = [&](const Key& lhs, const Key& rhs) {
+    return !comparator(lhs, rhs) && !comparator(rhs, lhs);
+  };
+  std::stable_sort(sorted.begin(), sorted.end(), comparator);
+  sorted.erase(std::unique(sorted.begin(), sorted.end(), is_equivalent), sorted.end());
+
+  tree_.BeginWrite();
+  try {
+    root_ = tree_.Build(sorted.begin(), sorted.size());
+  } catch (...) {
+    tree_.Abandon();
+    throw;
+  }
+
+  tree_.EndWrite();
+  size_ = sorted.size();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+PersistentSet<Key, Comparator, Alloc>::PersistentSet(std::initializer_list<Key> keys, const Comparator& comparator)
+  : PersistentSet(keys.begin(), keys.end(), comparator) {
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+PersistentSet<Key, Comparator, Alloc>::PersistentSet(const PersistentSet& other)
+  : tree_{other.tree_.comparator(), std::allocator_traits<allocator_type>::select_on_container_copy_construction(other.tree_.allocator())},
+    root_{other.root_},
+    size_{other.size_} {
+  Retain(root_);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+PersistentSet<Key, Comparator, Alloc>::PersistentSet(PersistentSet&& other) noexcept
+  : tree_{other.tree_.comparator(), other.tree_.allocator()},
+    root_{std::exchange(other.root_, nullptr)},
+    size_{std::exchange(other.size_, 0)} {
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+PersistentSet<Key, Comparator, Alloc>& PersistentSet<Key, Comparator, Alloc>::operator=(const PersistentSet& other) {
+  // retained first, other may share the root with this set. The old nodes are released
+  // before the allocator may change
+  Retain(other.root_);
+  Release(root_);
+  tree_.CopyAssign(other.tree_);
+  root_ = other.root_;
+  size_ = other.size_;
+  return *this;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+PersistentSet<Key, Comparator, Alloc>& PersistentSet<Key, Comparator, Alloc>::operator=(PersistentSet&& other) noexcept {
+  if (this != &other) {
+    clear();
+    tree_.MoveAssign(other.tree_);
+    root_ = std::exchange(other.root_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+
+  return *this;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+PersistentSet<Key, Comparator, Alloc>::~PersistentSet() {
+  Release(root_);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+PersistentSet<Key, Comparator, Alloc> PersistentSet<Key, Comparator, Alloc>::snapshot() const {
+  return *this;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool PersistentSet<Key, Comparator, Alloc>::insert(const Key& key) {
+  return InsertKey(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool PersistentSet<Key, Comparator, Alloc>::insert(Key&& key) {
+  return InsertKey(key);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+template <typename K>
+bool PersistentSet<Key, Comparator, Alloc>::InsertKey(K& key) {
+  tree_.BeginWrite();
+
+  bool inserted = false;
+  try {
+    auto* root = tree_.Insert(root_, key, inserted);
+    if (inserted) {
+      Commit(root);
+      ++size_;
+    }
+  } catch (...) {
+    // the old tree was only read, the set stays as it was
+    tree_.Abandon();
+    throw;
+  }
+
+  tree_.EndWrite();
+  return inserted;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename PersistentSet<Key, Comparator, Alloc>::size_type PersistentSet<Key, Comparator, Alloc>::erase(const Key& key) {
+  tree_.BeginWrite();
+
+  bool erased = false;
+  try {
+    auto* root = tree_.Erase(root_, key, erased);
+    if (erased) {
+      Commit(root);
+      --size_;
+    }
+  } catch (...) {
+    tree_.Abandon();
+    throw;
+  }
+
+  tree_.EndWrite();
+  return erased ? 1 : 0;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void PersistentSet<Key, Comparator, Alloc>::Commit(const Node* root) {
+  // a new node holds its fresh children from the start, the old ones gain a parent
+  for (auto* node : tree_.created()) {
+    for (auto* child : {node->left, node->right}) {
+      if (child != nullptr && !tree_.IsFresh(child)) {
+        Retain(child);
+      }
+    }
+  }
+
+  if (root != nullptr && !tree_.IsFresh(root)) {
+    Retain(root);
+  }
+
+  // path nodes of the old tree go unless a snapshot still holds them
+  Release(std::exchange(root_, root));
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void PersistentSet<Key, Comparator, Alloc>::clear() {
+  Release(std::exchange(root_, nullptr));
+  size_ = 0;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void PersistentSet<Key, Comparator, Alloc>::swap(PersistentSet& other) noexcept {
+  tree_.swap(other.tree_);
+  std::swap(root_, other.root_);
+  std::swap(size_, other.size_);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void PersistentSet<Key, Comparator, Alloc>::Retain(const Node* node) {
+  if (node != nullptr) {
+    node->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+void PersistentSet<Key, Comparator, Alloc>::Release(const Node* node) {
+  // the last reference frees the node, its children lose a parent. Released nodes
+  // form a subtree, so the recursion is bounded by the height
+  if (node == nullptr || node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+
+  Release(node->left);
+  Release(node->right);
+  tree_.DropNode(node);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename PersistentSet<Key, Comparator, Alloc>::const_iterator PersistentSet<Key, Comparator, Alloc>::begin() const {
+  return const_iterator::Begin(root_);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename PersistentSet<Key, Comparator, Alloc>::const_iterator PersistentSet<Key, Comparator, Alloc>::end() const {
+  return const_iterator();
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool PersistentSet<Key, Comparator, Alloc>::contains(const Key& key) const {
+  for (auto* node = root_; node != nullptr;) {
+    if (tree_.comparator()(key, node->key)) {
+      node = node->left;
+    } else if (tree_.comparator()(node->key, key)) {
+      node = node->right;
+    } else {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename PersistentSet<Key, Comparator, Alloc>::const_iterator PersistentSet<Key, Comparator, Alloc>::find(const Key& key) const {
+  auto it = lower_bound(key);
+  if (it == end() || tree_.comparator()(key, *it)) {
+    return end();
+  }
+
+  return it;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename PersistentSet<Key, Comparator, Alloc>::const_iterator PersistentSet<Key, Comparator, Alloc>::lower_bound(const Key& key) const {
+  return const_iterator::LowerBound(root_, tree_.comparator(), key);
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+typename PersistentSet<Key, Comparator, Alloc>::size_type PersistentSet<Key, Comparator, Alloc>::size() const {
+  return size_;
+}
+
+template <typename Key, typename Comparator, typename Alloc>
+bool PersistentSet<Key, Comparator, Alloc>::empty() const {
+  return size() == 0;
+}
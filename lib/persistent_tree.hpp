@@ -0,0 +1,459 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/* Building blocks of the sets whose nodes are shared: by readers of other threads in
+ * ConcurrentSet, by snapshots in PersistentSet. A node never changes once it's shared.
+ * A write copies the path it changes, balances it as an AVL tree and yields a new root,
+ * the old root keeps describing the old tree. There are no parent links to keep */
+
+// node of ConcurrentSet, nodes of other sets carry the same fields first
+template <typename Key>
+struct PersistentNode {
+  using key_type = Key;
+
+  const PersistentNode* left = nullptr;
+  const PersistentNode* right = nullptr;
+  std::uint64_t generation = 0; // write operation which created the node
+  int height = 1;
+  Key key;
+};
+
+// inorder walk with an explicit stack, height of an AVL tree with 2^44 keys fits
+template <typename Node>
+class PersistentIterator {
+public:
+  using value_type = typename Node::key_type;
+  using difference_type = std::ptrdiff_t;
+  using reference = const value_type&;
+  using pointer = const value_type*;
+  using iterator_category = std::forward_iterator_tag;
+
+  PersistentIterator() = default;
+
+  reference operator*() const;
+  pointer operator->() const;
+
+  PersistentIterator& operator++();
+  PersistentIterator operator++(int);
+
+  bool operator==(const PersistentIterator& other) const;
+
+  static PersistentIterator Begin(const Node* root);
+
+  // position of the first key not less than key under comparator, the stack holds
+  // every ancestor whose key is still to come
+  template <typename Comparator, typename K>
+  static PersistentIterator LowerBound(const Node* root, const Comparator& comparator, const K& key);
+
+private:
+  static constexpr std::size_t kMaxDepth = 64;
+
+  void PushLeftSpine(const Node* node);
+
+  std::array<const Node*, kMaxDepth> stack_;
+  std::size_t depth_ = 0; // end is the empty stack
+};
+
+template <typename Node>
+typename PersistentIterator<Node>::reference PersistentIterator<Node>::operator*() const {
+  return stack_[depth_ - 1]->key;
+}
+
+template <typename Node>
+typename PersistentIterator<Node>::pointer PersistentIterator<Node>::operator->() const {
+  return &stack_[depth_ - 1]->key;
+}
+
+template <typename Node>
+PersistentIterator<Node>& PersistentIterator<Node>::operator++() {
+  auto* node = stack_[--depth_];
+  PushLeftSpine(node->right);
+  return *this;
+}
+
+template <typename Node>
+PersistentIterator<Node> PersistentIterator<Node>::operator++(int) {
+  auto copy = *this;
+  ++*this;
+  return copy;
+}
+
+template <typename Node>
+bool PersistentIterator<Node>::operator==(const PersistentIterator& other) const {
+  if (depth_ != other.depth_) {
+    return false;
+  }
+
+  return depth_ == 0 || stack_[depth_ - 1] == other.stack_[depth_ - 1];
+}
+
+template <typename Node>
+void PersistentIterator<Node>::PushLeftSpine(const Node* node) {
+  for (; node != nullptr; node = node->left) {
+    stack_[depth_++] = node;
+  }
+}
+
+template <typename Node>
+PersistentIterator<Node> PersistentIterator<Node>::Begin(const Node* root) {
+  PersistentIterator it;
+  it.PushLeftSpine(root);
+  return it;
+}
+
+template <typename Node>
+template <typename Comparator, typename K>
+PersistentIterator<Node> PersistentIterator<Node>::LowerBound(const Node* root, const Comparator& comparator, const K& key) {
+  PersistentIterator it;
+
+  for (auto* node = root; node != nullptr;) {
+    if (comparator(node->key, key)) {
+      node = node->right;
+    } else {
+      it.stack_[it.depth_++] = node;
+      node = node->left;
+    }
+  }
+
+  return it;
+}
+
+/* Writes of the path copying sets. A write starts with BeginWrite, builds the new tree
+ * with Insert, Erase or Build and ends with the owner publishing the new root and calling
+ * EndWrite, or with Abandon if it threw half way. Nodes created by the running write
+ * can't be seen by anyone yet and are changed in place, older ones are copied.
+ * The owner decides when the replaced ones are freed */
+template <typename Node, typename Comparator, typename Alloc>
+class PathCopyingTree {
+public:
+  using Key = typename Node::key_type;
+  using allocator_type = std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+
+  PathCopyingTree() = default;
+  PathCopyingTree(const Comparator& comparator, const allocator_type& allocator);
+
+  void BeginWrite();
+  void EndWrite();
+  void Abandon();
+
+  // new root, root itself if nothing changed
+  template <typename K>
+  const Node* Insert(const Node* root, K& key, bool& inserted);
+  const Node* Erase(const Node* root, const Key& key, bool& erased);
+
+  // balanced tree of count sorted and unique keys
+  template <typename It>
+  const Node* Build(It first, std::size_t count);
+
+  bool IsFresh(const Node* node) const;
+
+  // nodes allocated and replaced by the running write
+  [[nodiscard]] const std::vector<const Node*>& created() const;
+  [[nodiscard]] const std::vector<const Node*>& replaced() const;
+
+  void DropNode(const Node* node);
+  void DropTree(const Node* node);
+
+  [[nodiscard]] const Comparator& comparator() const;
+  [[nodiscard]] const allocator_type& allocator() const;
+
+  // comparator and allocator of another tree are taken over between writes,
+  // the allocator only if the traits let it propagate on that operation
+  void CopyAssign(const PathCopyingTree& other);
+  void MoveAssign(const PathCopyingTree& other);
+  void swap(PathCopyingTree& other) noexcept;
+
+private:
+  static int Height(const Node* node);
+
+  const Node* Rebuild(const Node* node, const Node* left, const Node* right);
+  const Node* Balance(const Node* node, const Node* left, const Node* right);
+  const Node* EraseMin(const Node* node, const Node*& min);
+
+  template <typename K>
+  const Node* MakeNode(K&& key);
+
+  // generations are unique across trees, nodes may be shared between them
+  static inline std::atomic<std::uint64_t> generations_{0};
+
+  Comparator comparator_;
+  allocator_type allocator_;
+
+  std::uint64_t generation_ = 0;
+  std::vector<const Node*> created_;
+  std::vector<const Node*> replaced_;
+};
+
+template <typename Node, typename Comparator, typename Alloc>
+PathCopyingTree<Node, Comparator, Alloc>::PathCopyingTree(const Comparator& comparator, const allocator_type& allocator)
+  : comparator_{comparator},
+    allocator_{allocator} {
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+void PathCopyingTree<Node, Comparator, Alloc>::BeginWrite() {
+  generation_ = generations_.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+void PathCopyingTree<Node, Comparator, Alloc>::EndWrite() {
+  created_.clear();
+  replaced_.clear();
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+void PathCopyingTree<Node, Comparator, Alloc>::Abandon() {
+  // the old tree was never touched, everything new goes
+  for (auto* node : created_) {
+    DropNode(node);
+  }
+
+  EndWrite();
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+bool PathCopyingTree<Node, Comparator, Alloc>::IsFresh(const Node* node) const {
+  return node->generation == generation_;
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+const std::vector<const Node*>& PathCopyingTree<Node, Comparator, Alloc>::created() const {
+  return created_;
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+const std::vector<const Node*>& PathCopyingTree<Node, Comparator, Alloc>::replaced() const {
+  return replaced_;
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+const Comparator& PathCopyingTree<Node, Comparator, Alloc>::comparator() const {
+  return comparator_;
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+const typename PathCopyingTree<Node, Comparator, Alloc>::allocator_type& PathCopyingTree<Node, Comparator, Alloc>::allocator() const {
+  return allocator_;
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+void PathCopyingTree<Node, Comparator, Alloc>::CopyAssign(const PathCopyingTree& other) {
+  comparator_ = other.comparator_;
+  if constexpr (std::allocator_traits<allocator_type>::propagate_on_container_copy_assignment::value) {
+    allocator_ = other.allocator_;
+  }
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+void PathCopyingTree<Node, Comparator, Alloc>::MoveAssign(const PathCopyingTree& other) {
+  // copied, so the moved-from owner keeps ordering by it
+  comparator_ = other.comparator_;
+  if constexpr (std::allocator_traits<allocator_type>::propagate_on_container_move_assignment::value) {
+    allocator_ = other.allocator_;
+  }
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+void PathCopyingTree<Node, Comparator, Alloc>::swap(PathCopyingTree& other) noexcept {
+  using std::swap;
+  swap(comparator_, other.comparator_);
+  if constexpr (std::allocator_traits<allocator_type>::propagate_on_container_swap::value) {
+    swap(allocator_, other.allocator_);
+  }
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+int PathCopyingTree<Node, Comparator, Alloc>::Height(const Node* node) {
+  return node == nullptr ? 0 : node->height;
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+template <typename K>
+const Node* PathCopyingTree<Node, Comparator, Alloc>::MakeNode(K&& key) {
+  auto* node = allocator_.allocate(1);
+
+  try {
+    std::allocator_traits<allocator_type>::construct(allocator_, node, nullptr, nullptr, generation_, 1, std::forward<K>(key));
+  } catch (...) {
+    allocator_.deallocate(node, 1);
+    throw;
+  }
+
+  try {
+    created_.push_back(node);
+  } catch (...) {
+    DropNode(node);
+    throw;
+  }
+
+  return node;
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+const Node* PathCopyingTree<Node, Comparator, Alloc>::Rebuild(const Node* node, const Node* left, const Node* right) {
+  Node* result;
+
+  if (IsFresh(node)) {
+    result = const_cast<Node*>(node);
+  } else {
+    // key is copied, someone may still be looking at the old node
+    result = const_cast<Node*>(MakeNode(node->key));
+    replaced_.push_back(node);
+  }
+
+  result->left = left;
+  result->right = right;
+  result->height = std::max(Height(left), Height(right)) + 1;
+  return result;
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+const Node* PathCopyingTree<Node, Comparator, Alloc>::Balance(const Node* node, const Node* left, const Node* right) {
+  // node gives its key, heights of left and right differ by two at most
+  if (Height(left) > Height(right) + 1) {
+    auto* left_left = left->left;
+    auto* left_right = left->right;
+
+    if (Height(left_left) >= Height(left_right)) {
+      auto* lowered = Rebuild(node, left_right, right);
+      return Rebuild(left, left_left, lowered);
+    }
+
+    auto* middle_left = left_right->left;
+    auto* middle_right = left_right->right;
+    auto* new_left = Rebuild(left, left_left, middle_left);
+    auto* new_right = Rebuild(node, middle_right, right);
+    return Rebuild(left_right, new_left, new_right);
+  }
+
+  if (Height(right) > Height(left) + 1) {
+    auto* right_left = right->left;
+    auto* right_right = right->right;
+
+    if (Height(right_right) >= Height(right_left)) {
+      auto* lowered = Rebuild(node, left, right_left);
+      return Rebuild(right, lowered, right_right);
+    }
+
+    auto* middle_left = right_left->left;
+    auto* middle_right = right_left->right;
+    auto* new_left = Rebuild(node, left, middle_left);
+    auto* new_right = Rebuild(right, middle_right, right_right);
+    return Rebuild(right_left, new_left, new_right);
+  }
+
+  return Rebuild(node, left, right);
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+template <typename K>
+const Node* PathCopyingTree<Node, Comparator, Alloc>::Insert(const Node* node, K& key, bool& inserted) {
+  if (node == nullptr) {
+    inserted = true;
+    return MakeNode(std::forward<K>(key));
+  }
+
+  // nothing is copied unless the key really goes in
+  if (comparator_(key, node->key)) {
+    auto* left = Insert(node->left, key, inserted);
+    return inserted ? Balance(node, left, node->right) : node;
+  }
+
+  if (comparator_(node->key, key)) {
+    auto* right = Insert(node->right, key, inserted);
+    return inserted ? Balance(node, node->left, right) : node;
+  }
+
+  return node;
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+const Node* PathCopyingTree<Node, Comparator, Alloc>::EraseMin(const Node* node, const Node*& min) {
+  if (node->left == nullptr) {
+    min = node;
+    return node->right;
+  }
+
+  auto* left = EraseMin(node->left, min);
+  return Balance(node, left, node->right);
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+const Node* PathCopyingTree<Node, Comparator, Alloc>::Erase(const Node* node, const Key& key, bool& erased) {
+  if (node == nullptr) {
+    return nullptr;
+  }
+
+  if (comparator_(key, node->key)) {
+    auto* left = Erase(node->left, key, erased);
+    return erased ? Balance(node, left, node->right) : node;
+  }
+
+  if (comparator_(node->key, key)) {
+    auto* right = Erase(node->right, key, erased);
+    return erased ? Balance(node, node->left, right) : node;
+  }
+
+  erased = true;
+  replaced_.push_back(node);
+
+  if (node->left == nullptr) {
+    return node->right;
+  }
+
+  if (node->right == nullptr) {
+    return node->left;
+  }
+
+  // successor takes the place of the erased node, a copy of it that is
+  const Node* min = nullptr;
+  auto* right = EraseMin(node->right, min);
+  return Balance(min, node->left, right);
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+template <typename It>
+const Node* PathCopyingTree<Node, Comparator, Alloc>::Build(It first, std::size_t count) {
+  // middle key becomes the root, so heights of sibling subtrees differ by at most one
+  if (count == 0) {
+    return nullptr;
+  }
+
+  auto left_size = (count - 1) / 2;
+  auto* left = Build(first, left_size);
+
+  auto middle = std::next(first, static_cast<std::ptrdiff_t>(left_size));
+  auto* node = const_cast<Node*>(MakeNode(*middle));
+  node->left = left;
+  node->right = Build(std::next(middle), count - 1 - left_size);
+  node->height = std::max(Height(node->left), Height(node->right)) + 1;
+  return node;
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+void PathCopyingTree<Node, Comparator, Alloc>::DropNode(const Node* node) {
+  auto* ptr = const_cast<Node*>(node);
+  std::allocator_traits<allocator_type>::destroy(allocator_, ptr);
+  allocator_.deallocate(ptr, 1);
+}
+
+template <typename Node, typename Comparator, typename Alloc>
+void PathCopyingTree<Node, Comparator, Alloc>::DropTree(const Node* node) {
+  // AVL trees are shallow, the recursion is bounded by their height
+  if (node == nullptr) {
+    return;
+  }
+
+  DropTree(node->left);
+  DropTree(node->right);
+  DropNode(node);
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/* Allocator handing out single objects from contiguous chunks of ChunkSize slots,
+ * freed slots are reused through an intrusive free list.
+ * Copies share the pool, rebinds and container copies get a fresh one,
+ * so every Set built on top of it owns its pool exclusively unless the allocator is shared explicitly */
+template <typename T, std::size_t ChunkSize = 256>
+class PoolAllocator {
+public:
+  using value_type = T;
+
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  using is_always_equal = std::false_type;
+
+  template <typename U>
+  struct rebind {
+    using other = PoolAllocator<U, ChunkSize>;
+  };
+
+  PoolAllocator() = default;
+  PoolAllocator(const PoolAllocator&) = default;
+  PoolAllocator(PoolAllocator&&) noexcept = default;
+  PoolAllocator& operator=(const PoolAllocator&) = default;
+  PoolAllocator& operator=(PoolAllocator&&) noexcept = default;
+
+  // pool is typed by slot size, so a rebind can't share it
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U, ChunkSize>&) noexcept {}
+
+  T* allocate(std::size_t n);
+  void deallocate(T* ptr, std::size_t n) noexcept;
+
+  PoolAllocator select_on_container_copy_construction() const;
+
+  // frees all chunks at once without looking at the objects inside of them,
+  // refuses (returns false) if the pool is shared with another allocator
+  bool release() noexcept;
+
+  bool operator==(const PoolAllocator& other) const;
+  bool operator!=(const PoolAllocator& other) const;
+
+private:
+  union Slot {
+    Slot* next;
+    alignas(T) std::byte storage[sizeof(T)];
+  };
+
+  struct Pool {
+    ~Pool();
+
+    std::vector<Slot*> chunks;
+    Slot* free_list = nullptr;
+    Slot* bump = nullptr; // untouched part of the last chunk
+    Slot* bump_end = nullptr;
+  };
+
+  std::shared_ptr<Pool> pool_; // created lazily, so default construction never allocates
+};
+
+template <typename T, std::size_t ChunkSize>
+PoolAllocator<T, ChunkSize>::Pool::~Pool() {
+  for (auto* chunk : chunks) {
+    std::allocator<Slot>().deallocate(chunk, ChunkSize);
+  }
+}
+
+template <typename T, std::size_t ChunkSize>
+T* PoolAllocator<T, ChunkSize>::allocate(std::size_t n) {
+  if (n != 1) {
+    return std::allocator<T>().allocate(n);
+  }
+
+  if (pool_ == nullptr) {
+    pool_ = std::make_shared<Pool>();
+  }
+
+  Slot* slot;
+  if (pool_->free_list != nullptr) {
+    slot = pool_->free_list;
+    pool_->free_list = slot->next;
+  } else {
+    if (pool_->bump == pool_->bump_end) {
+      auto* chunk = std::allocator<Slot>().allocate(ChunkSize);
+
+      try {
+        pool_->chunks.push_back(chunk);
+      } catch (...) {
+        std::allocator<Slot>().deallocate(chunk, ChunkSize);
+        throw;
+      }
+
+      pool_->bump = chunk;
+      pool_->bump_end = chunk + ChunkSize;
+    }
+
+    slot = pool_->bump++;
+  }
+
+  return reinterpret_cast<T*>(slot->storage);
+}
+
+template <typename T, std::size_t ChunkSize>
+void PoolAllocator<T, ChunkSize>::deallocate(T* ptr, std::size_t n) noexcept {
+  if (n != 1) {
+    std::allocator<T>().deallocate(ptr, n);
+    return;
+  }
+
+  auto* slot = reinterpret_cast<Slot*>(ptr);
+  slot->next = pool_->free_list;
+  pool_->free_list = slot;
+}
+
+template <typename T, std::size_t ChunkSize>
+PoolAllocator<T, ChunkSize> PoolAllocator<T, ChunkSize>::select_on_container_copy_construction() const {
+  return PoolAllocator();
+}
+
+template <typename T, std::size_t ChunkSize>
+bool PoolAllocator<T, ChunkSize>::release() noexcept {
+  if (pool_ == nullptr) {
+    return true;
+  }
+
+  if (pool_.use_count() != 1) {
+    return false;
+  }
+
+  pool_.reset();
+  return true;
+}
+
+template <typename T, std::size_t ChunkSize>
+bool PoolAllocator<T, ChunkSize>::operator==(const PoolAllocator& other) const {
+  return pool_ == other.pool_;
+}
+
+template <typename T, std::size_t ChunkSize>
+bool PoolAllocator<T, ChunkSize>::operator!=(const PoolAllocator& other) const {
+  return pool_ != other.pool_;
+}
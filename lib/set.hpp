@@ -1,25 +1,55 @@
 #pragma once
 
-#include <memory>
+#include <algorithm>
+#include <bit>
+#include <cassert>
 #include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
+#include <lib/balancing.hpp>
+#include <lib/btree_set.hpp>
+#include <lib/comparator.hpp>
+#include <lib/frozen_set.hpp>
 #include <lib/node.hpp>
+#include <lib/node_handle.hpp>
 #include <lib/iterator.hpp>
+#include <lib/order_statistic.hpp>
 #include <lib/reverse_iterator.hpp>
+#include <lib/stats.hpp>
+#include <lib/threaded.hpp>
 #include <lib/traversals.hpp>
 
+// images are written and mapped with POSIX calls, which only the callers of Set::save
+// and Set::open_mapped get, by including lib/mapped_set.hpp
+template <typename Key, typename Comparator>
+class MappedSet;
+
+template <typename Key, typename Comparator, typename Alloc>
+void WriteSetImage(const std::string& path, const FrozenSet<Key, Comparator, Alloc>& frozen);
+
 template<
   typename Key,
   typename Comparator = std::less<Key>,
-  typename Alloc = std::allocator<Key>
+  typename Alloc = std::allocator<Key>,
+  typename Balancing = RedBlack
 >
 
 class Set {
 public:
   // tree-specific aliases's
+  using balancing = Balancing;
+  using augment = typename AugmentOf<Balancing>::type;
+  using stats_type = typename StatsOf<Balancing>::type;
   using preorder = PreOrder<Key>;
-  using inorder = InOrder<Key>;
+  using inorder = typename augment::template inorder<Key>;
   using postorder = PostOrder<Key>;
 
   // named requirements tags (Container)
@@ -28,10 +58,11 @@ public:
   using const_reference = const Key&;
 
   // allocator aware container requirments
-  using allocator_type = std::allocator_traits<Alloc>::template rebind_alloc<Node<Key>>;
+  // nodes are handled as Node<Key> everywhere, the augmentation may allocate a larger type
+  using allocator_type = std::allocator_traits<Alloc>::template rebind_alloc<typename augment::template node<Key>>;
 
   // regular iterators
-  using iterator = Iterator<Key>; 
+  using iterator = Iterator<Key, inorder>;
   using const_iterator = iterator;
   using preorder_iterator = Iterator<Key, preorder>; 
   using preorder_const_iterator = Iterator<Key, preorder>;
@@ -39,7 +70,7 @@ public:
   using postorder_const_iterator = Iterator<Key, postorder>;
 
   // reverse iterators
-  using reverse_iterator = ReverseIterator<Key>; 
+  using reverse_iterator = ReverseIterator<Key, inorder>;
   using const_reverse_iterator = iterator;
   using preorder_reverse_iterator = ReverseIterator<Key, preorder>; 
   using preorder_const_reverse_iterator = ReverseIterator<Key, preorder>;
@@ -54,7 +85,14 @@ public:
   using key_type = Key;
   using key_compare = Comparator;
   using value_compare = Comparator;
-  using node_type = Node<Key>;
+  using node_type = NodeHandle<Key, allocator_type>;
+
+  // result of inserting a node handle, the node is given back if its key was already present
+  struct insert_return_type {
+    iterator position;
+    bool inserted;
+    node_type node;
+  };
 
   // destructor
   ~Set();
@@ -62,11 +100,22 @@ public:
   // constructors
   Set();
 
-  Set(const Set<Key, Comparator, Alloc>& other);
-  Set(Set<Key, Comparator, Alloc>&& other) noexcept;
+  Set(const Set<Key, Comparator, Alloc, Balancing>& other);
+  Set(Set<Key, Comparator, Alloc, Balancing>&& other) noexcept;
+
+  // linear time for sorted input, unsorted one gets sorted first
+  template <std::input_iterator It>
+  Set(It first, It last);
+  Set(std::initializer_list<Key> keys);
+
+  Set& operator=(const Set<Key, Comparator, Alloc, Balancing>& other);
+  // trees are exchanged, unless the allocators differ and don't propagate: then keys are moved one by one
+  static constexpr bool kNothrowMoveAssign = std::allocator_traits<allocator_type>::propagate_on_container_move_assignment::value ||
+                                             std::allocator_traits<allocator_type>::is_always_equal::value;
+  Set& operator=(Set<Key, Comparator, Alloc, Balancing>&& other) noexcept(kNothrowMoveAssign);
 
-  Set& operator=(const Set<Key, Comparator, Alloc>& other);
-  Set& operator=(Set<Key, Comparator, Alloc>&& other) noexcept;
+  // moves and swaps relink a few pointers, nothing is allocated
+  void swap(Set<Key, Comparator, Alloc, Balancing>& other) noexcept;
 
   // iterator access
   [[nodiscard]] const_iterator cbegin() const;
@@ -89,317 +138,1680 @@ public:
   [[nodiscard]] ReverseIterator<Key, Traversal> rend();
 
   // comparison
-  bool operator==(const Set<Key, Comparator, Alloc>& other) const;
-  bool operator!=(const Set<Key, Comparator, Alloc>& other) const;
+  bool operator==(const Set<Key, Comparator, Alloc, Balancing>& other) const;
+  bool operator!=(const Set<Key, Comparator, Alloc, Balancing>& other) const;
 
   // business methods
   template <typename... Args>
   std::pair<bool, iterator> emplace(Args&&... args);
 
-  std::pair<bool, iterator> insert(Key key); 
+  // searches for key first and constructs a node from args only if key is absent,
+  // args must produce a key equivalent to the given one
+  template <typename... Args>
+  std::pair<bool, iterator> try_emplace(const Key& key, Args&&... args);
+
+  template <typename K, typename... Args> requires TransparentComparator<Comparator>
+  std::pair<bool, iterator> try_emplace(const K& key, Args&&... args);
+
+  // key is linked right next to hint without a descent from the root, if it belongs there.
+  // The largest key is cached, so feeding ascending keys with end() as the hint
+  // costs one comparison and amortized O(1) rebalancing per key
+  template <typename... Args>
+  iterator emplace_hint(const_iterator hint, Args&&... args);
+
+  std::pair<bool, iterator> insert(const Key& key);
+  std::pair<bool, iterator> insert(Key&& key);
+  iterator insert(const_iterator hint, const Key& key);
+  iterator insert(const_iterator hint, Key&& key);
+
+  // large batches are merged with the tree and the result is rebuilt in linear time,
+  // small ones are inserted key by key
+  template <std::input_iterator It>
+  void insert(It first, It last);
+  void insert(std::initializer_list<Key> keys);
   size_type erase(const Key& key);
   const_iterator erase(iterator it);
-  const_iterator find(const Key& key);
+  const_iterator find(const Key& key) const;
   void clear();
 
+  // overloads below accept anything comparable with Key, if the comparator is transparent
+  template <typename K> requires TransparentComparator<Comparator> && (!std::is_convertible_v<K, iterator>)
+  size_type erase(K&& key);
+
+  // node handles move keys between sets without allocating, copying or moving them
+  node_type extract(const_iterator position);
+  node_type extract(const Key& key); // empty handle if the key is missing
+
+  template <typename K> requires TransparentComparator<Comparator> && (!std::is_convertible_v<K, iterator>)
+  node_type extract(K&& key);
+
+  insert_return_type insert(node_type&& node);
+  iterator insert(const_iterator hint, node_type&& node);
+
+  // takes every key missing here out of source, keys already present stay in source.
+  // Sets of comparable size are zipped in linear time, with equal allocators
+  // nodes are relinked and no key is copied or moved
+  template <typename C2, typename B2>
+  void merge(Set<Key, C2, Alloc, B2>& source);
+
+  template <typename C2, typename B2>
+  void merge(Set<Key, C2, Alloc, B2>&& source);
+
+  template <typename K> requires TransparentComparator<Comparator>
+  const_iterator find(const K& key) const;
+
+  // ordered lookup, each one is a single descent from the root
+  [[nodiscard]] const_iterator lower_bound(const Key& key) const; // first key not less than key
+  [[nodiscard]] const_iterator upper_bound(const Key& key) const; // first key greater than key
+  [[nodiscard]] std::pair<const_iterator, const_iterator> equal_range(const Key& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] const_iterator lower_bound(const K& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] const_iterator upper_bound(const K& key) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] std::pair<const_iterator, const_iterator> equal_range(const K& key) const;
+
+  // keys in [low, high), borrowed from the set and usable with std::ranges
+  [[nodiscard]] std::ranges::subrange<const_iterator> range(const Key& low, const Key& high) const;
+
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] std::ranges::subrange<const_iterator> range(const K& low, const K& high) const;
+
+  // order statistics, O(height) with an OrderStatistic balancing policy
+  [[nodiscard]] const_iterator nth(size_type k) const requires RankedTraversal<inorder, Key>; // end() if k >= size()
+  [[nodiscard]] size_type rank(const Key& key) const requires RankedTraversal<inorder, Key>; // number of keys less than key
+
+  template <typename K> requires TransparentComparator<Comparator> && RankedTraversal<inorder, Key>
+  [[nodiscard]] size_type rank(const K& key) const;
+
+  // std::distance walks, since iterators are bidirectional only
+  [[nodiscard]] difference_type distance(const_iterator first, const_iterator last) const requires RankedTraversal<inorder, Key>;
+
+  // read-only copy packed into a contiguous array, much faster to search
+  [[nodiscard]] FrozenSet<Key, Comparator, Alloc> freeze() const;
+
+  // frozen copy written to disk and mapped back without reading it key by key, see SetImageHeader.
+  // Defined in lib/mapped_set.hpp, which callers include
+  void save(const std::string& path) const requires std::is_trivially_copyable_v<Key>;
+  [[nodiscard]] static MappedSet<Key, Comparator> open_mapped(const std::string& path, bool verify_checksum = true) requires std::is_trivially_copyable_v<Key>;
+
+  // smallest and largest keys are cached, the set must not be empty
+  [[nodiscard]] const Key& min() const;
+  [[nodiscard]] const Key& max() const;
+  void pop_front();
+
+  // shape of the tree, walks all of it. Levels, and nodes at every depth with the root at 0
+  [[nodiscard]] size_type height() const;
+  [[nodiscard]] std::vector<size_type> depth_histogram() const;
+
+  // counters of an Instrumented balancing policy together with the shape of the tree,
+  // iterator steps are counted per thread in SuccessorCounters
+  [[nodiscard]] SetStats stats() const requires (!std::is_same_v<stats_type, NoStats>);
+  void reset_stats() requires (!std::is_same_v<stats_type, NoStats>);
+
   // size & utility
   [[nodiscard]] size_type size() const;
   [[nodiscard]] bool empty() const;
   [[nodiscard]] bool contains(const Key& key) const;
 
+  template <typename K> requires TransparentComparator<Comparator>
+  [[nodiscard]] bool contains(const K& key) const;
+
+  // batched lookups, results[i] is the answer for keys[i] and results must be at least as long as keys.
+  // Descents of kBatchWidth keys advance together a level at a time with the next nodes prefetched,
+  // so their cache misses overlap instead of following each other
+  void find_many(std::span<const Key> keys, std::span<const_iterator> results) const;
+  void contains_many(std::span<const Key> keys, std::span<bool> results) const;
+
+  static constexpr size_type kBatchWidth = 16;
+
 private:
-  Node<Key>* ConstructEmptyNode();
+  // merge takes nodes out of sets with other comparators and balancing policies
+  template <typename, typename, typename, typename>
+  friend class Set;
 
   template<typename... Args>
   Node<Key>* ConstructNodeWithKey(Args&&... args);
   void DropTree();
+  void DropSubtree(Node<Key>* node);
   void DropNode(Node<Key>* ptr);
 
+  // unlinks every node of the tree into a list chained through right pointers
+  Node<Key>* FlattenTree();
+  void DropList(Node<Key>* list);
+
+  // copies the subtree, taking nodes from the reusable list before allocating new ones
+  Node<Key>* CloneTree(const Node<Key>* source, Node<Key>*& reusable);
+
+  template<typename... Args>
+  Node<Key>* ReuseOrConstructNode(Node<Key>*& reusable, Args&&... args);
+
   void EraseNodeByPointer(Node<Key>* ptr);
 
-  Node<Key>* root_ = nullptr;
-  size_type size_ = 0;
+  // every comparison of keys goes through here, so instrumented sets can count them
+  template <typename A, typename B>
+  bool Compare(const A& lhs, const B& rhs) const;
+
+  // exchanges the trees only, "end" nodes stay where they are
+  void SwapTrees(Set<Key, Comparator, Alloc, Balancing>& other) noexcept;
+
+  // takes node out of the tree by relinking, so the node keeps its key and may be linked again.
+  // Iterators to all the other nodes stay valid
+  void UnlinkNode(Node<Key>* node);
+
+  struct InsertPosition {
+    Node<Key>* parent;
+    bool is_left;
+    Node<Key>* existing; // equivalent key, if it's already present
+  };
+
+  // lookup helpers shared by the Key and the heterogeneous overloads,
+  // "end" node is returned for missing keys
+  // counted_search is false when the caller already counted this search
+  template <typename K>
+  InsertPosition FindInsertPosition(const K& key, bool counted_search = false) const;
+
+  // checks the neighbours of hint first, falls back to the full descent
+  template <typename K>
+  InsertPosition FindHintPosition(Node<Key>* hint, const K& key) const;
+
+  template <typename K>
+  Node<Key>* FindNode(const K& key) const;
+
+  template <typename K>
+  Node<Key>* LowerBoundNode(const K& key) const;
+
+  template <typename K>
+  Node<Key>* UpperBoundNode(const K& key) const;
+
+  template <typename K>
+  std::pair<const_iterator, const_iterator> EqualRange(const K& key) const;
+
+  // calls visit(i, node) for every keys[i], with the "end" node for missing keys
+  template <typename Visit>
+  void FindMany(std::span<const Key> keys, Visit visit) const;
+
+  static constexpr size_type kCacheResidentBytes = 256 * 1024;
+
+  template <typename K>
+  std::ranges::subrange<const_iterator> Range(const K& low, const K& high) const;
+
+  template <typename K>
+  size_type EraseKey(const K& key);
+
+  template <typename K>
+  size_type Rank(const K& key) const;
+
+  template <typename K>
+  node_type ExtractKey(const K& key);
+  iterator LinkNode(Node<Key>* node, const InsertPosition& position);
+  Node<Key>* FindRightmost() const;
+
+  // shared by emplace and emplace_hint, find_position tells where a key belongs
+  template <typename FindPosition, typename... Args>
+  std::pair<bool, iterator> EmplaceWith(FindPosition find_position, Args&&... args);
+
+  template <typename K, typename... Args>
+  std::pair<bool, iterator> EmplaceAt(const InsertPosition& position, const K& key, Args&&... args);
+
+  // bulk construction, keys are expected to be sorted and unique. BulkInsert merges the count
+  // keys with the tree and allocates nodes only for the ones which are missing
+  template <typename It>
+  std::vector<Node<Key>*> ConstructNodes(It first, It last);
+  template <typename It>
+  void BulkInsert(It first, It last, size_type count);
+
+  // merges the sorted nodes with the tree into merged, without touching any links.
+  // Nodes equivalent to the existing ones go to on_duplicate instead
+  template <typename OnDuplicate>
+  void ZipNodes(const std::vector<Node<Key>*>& incoming, std::vector<Node<Key>*>& merged, OnDuplicate on_duplicate) const;
+
+  // links the sorted nodes into a balanced tree, replacing the current one
+  void Rebuild(const std::vector<Node<Key>*>& nodes);
+  // augmentations linking nodes across subtrees are told the whole tree was replaced
+  void RelinkAugment();
+  Node<Key>* BuildBalanced(Node<Key>* const* first, size_type count, int depth, int max_depth);
+
+  using stored_node = typename augment::template node<Key>;
 
   Comparator comparator_;
   allocator_type allocator_;
+
+  // "end" node lives in the set itself, so empty sets and moves never allocate.
+  // root_ always points to it, the tree code reaches the header through root_
+  stored_node header_;
+  Node<Key>* root_ = &header_;
+  Node<Key>* leftmost_ = nullptr;  // smallest key, or "end" node for an empty tree
+  Node<Key>* rightmost_ = nullptr; // largest key, or "end" node for an empty tree
+  size_type size_ = 0;
+
+  // counters are bumped by const lookups too, NoStats takes no space
+  [[no_unique_address]] mutable stats_type stats_;
 };
 
 
-template<typename Key, typename Comparator, typename Alloc>
-Set<Key, Comparator, Alloc>::Set()
-  : root_{ConstructEmptyNode()},
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Set<Key, Comparator, Alloc, Balancing>::Set()
+  : leftmost_{root_},
+    rightmost_{root_},
     size_{0} {
 }
 
-template<typename Key, typename Comparator, typename Alloc>
-Set<Key, Comparator, Alloc>::~Set() {
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Set<Key, Comparator, Alloc, Balancing>::~Set() {
   DropTree();
 }
 
-template<typename Key, typename Comparator, typename Alloc>
-void Set<Key, Comparator, Alloc>::DropTree() {
-  auto postorder = [this](Node<Key>* node, auto& this_closure) { 
-    if (node == nullptr) return;
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::DropTree() {
+  if constexpr (std::is_trivially_destructible_v<Node<Key>> && requires { allocator_.release(); }) {
+    // nothing to destroy, so pooling allocators can drop whole chunks instead of walking the tree
+    if (allocator_.release()) {
+      root_->left = nullptr;
+      stats_.OnFree(size_);
+      return;
+    }
+  }
+
+  DropSubtree(std::exchange(root_->left, nullptr));
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::DropSubtree(Node<Key>* node) {
+  // same right rotations as in FlattenTree, nodes are dropped instead of being collected,
+  // so neither stack nor heap usage depends on the shape of the tree
+  while (node != nullptr) {
+    if (node->left != nullptr) {
+      auto* left = node->left;
+      node->left = left->right;
+      left->right = node;
+      node = left;
+    } else {
+      auto* next = node->right;
+      DropNode(node);
+      node = next;
+    }
+  }
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Node<Key>* Set<Key, Comparator, Alloc, Balancing>::FlattenTree() {
+  // right rotations turn the tree into a list, every node is visited a constant number of times
+  Node<Key>* list = nullptr;
+  auto* node = std::exchange(root_->left, nullptr);
+
+  while (node != nullptr) {
+    if (node->left != nullptr) {
+      auto* left = node->left;
+      node->left = left->right;
+      left->right = node;
+      node = left;
+    } else {
+      auto* next = node->right;
+      node->right = list;
+      list = node;
+      node = next;
+    }
+  }
+
+  size_ = 0;
+  leftmost_ = root_;
+  rightmost_ = root_;
+  return list;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::DropList(Node<Key>* list) {
+  while (list != nullptr) {
+    DropNode(std::exchange(list, list->right));
+  }
+}
 
-    this_closure(node->left, this_closure);
-    this_closure(node->right, this_closure);
-    DropNode(node);
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Node<Key>* Set<Key, Comparator, Alloc, Balancing>::CloneTree(const Node<Key>* source, Node<Key>*& reusable) {
+  // copies the shape and balancing state as is, so no key is ever compared.
+  // Both trees are walked in preorder through parent pointers, a child is pending
+  // while it's present in the source and still missing in the copy
+  if (source == nullptr) {
+    return nullptr;
+  }
+
+  auto clone_node = [this, &reusable](const Node<Key>* node, Node<Key>* parent) {
+    auto* copy = ReuseOrConstructNode(reusable, node->key);
+    copy->balance = node->balance;
+    augment::Copy(copy, node);
+    copy->parent = parent;
+    return copy;
   };
 
-  // TODO: probably get rid of recursion
+  auto* root = clone_node(source, nullptr);
+  auto* from = source;
+  auto* to = root;
+
+  try {
+    while (true) {
+      if (from->left != nullptr && to->left == nullptr) {
+        to->left = clone_node(from->left, to);
+        from = from->left;
+        to = to->left;
+      } else if (from->right != nullptr && to->right == nullptr) {
+        to->right = clone_node(from->right, to);
+        from = from->right;
+        to = to->right;
+      } else if (from != source) {
+        from = from->parent;
+        to = to->parent;
+      } else {
+        break;
+      }
+    }
+  } catch (...) {
+    DropSubtree(root); // partial copy is a well formed tree
+    throw;
+  }
 
-  postorder(root_, postorder);
+  return root;
 }
 
-template<typename Key, typename Comparator, typename Alloc>
-void Set<Key, Comparator, Alloc>::DropNode(Node<Key>* ptr) {
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename... Args>
+Node<Key>* Set<Key, Comparator, Alloc, Balancing>::ReuseOrConstructNode(Node<Key>*& reusable, Args&&... args) {
+  if (reusable == nullptr) {
+    return ConstructNodeWithKey(std::forward<Args>(args)...);
+  }
+
+  auto* ptr = static_cast<stored_node*>(std::exchange(reusable, reusable->right));
   std::allocator_traits<allocator_type>::destroy(allocator_, ptr);
-  allocator_.deallocate(ptr, 1);
-};
 
-template<typename Key, typename Comparator, typename Alloc>
-Node<Key>* Set<Key, Comparator, Alloc>::ConstructEmptyNode() {
-  auto* ptr = allocator_.allocate(1);
-  std::allocator_traits<allocator_type>::construct(allocator_, ptr);
+  try {
+    std::allocator_traits<allocator_type>::construct(allocator_, ptr, std::forward<Args>(args)...);
+  } catch (...) {
+    allocator_.deallocate(ptr, 1);
+    stats_.OnFree();
+    throw;
+  }
+
   return ptr;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::DropNode(Node<Key>* node) {
+  auto* ptr = static_cast<stored_node*>(node);
+  std::allocator_traits<allocator_type>::destroy(allocator_, ptr);
+  allocator_.deallocate(ptr, 1);
+  stats_.OnFree();
 };
 
-template<typename Key, typename Comparator, typename Alloc>
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
 template<typename... Args>
-Node<Key>* Set<Key, Comparator, Alloc>::ConstructNodeWithKey(Args&&... args) {
+Node<Key>* Set<Key, Comparator, Alloc, Balancing>::ConstructNodeWithKey(Args&&... args) {
   auto* ptr = allocator_.allocate(1);
-  std::allocator_traits<allocator_type>::construct(allocator_, ptr, std::forward<Args>(args)...);
+
+  try {
+    std::allocator_traits<allocator_type>::construct(allocator_, ptr, std::forward<Args>(args)...);
+  } catch (...) {
+    allocator_.deallocate(ptr, 1);
+    throw;
+  }
+
+  stats_.OnAllocate();
   return ptr;
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-template<typename... Args>
-std::pair<bool, typename Set<Key, Comparator, Alloc>::iterator> Set<Key, Comparator, Alloc>::emplace(Args&&... args) {
-  using namespace std::placeholders;
-  auto deleter = std::bind(&Set::DropNode, this, _1);
-  auto new_node = std::unique_ptr<Node<Key>, decltype(deleter)>(ConstructNodeWithKey(std::forward<Args>(args)...), deleter);
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K>
+typename Set<Key, Comparator, Alloc, Balancing>::InsertPosition Set<Key, Comparator, Alloc, Balancing>::FindInsertPosition(const K& key, bool counted_search) const {
+  if (!counted_search) {
+    stats_.OnSearch();
+  }
+
   auto* it = root_->left;
-  auto* parent = root_;
-  bool is_last_move_left = true;
+  InsertPosition position{root_, true, nullptr};
 
   while (it != nullptr) {
-    parent = it;
+    position.parent = it;
 
-    if (std::equal_to<Key>{}(it->key, new_node->key)) {
-      return { false, Iterator<Key>(it) }; // key already exists 
-    } else if (comparator_(new_node->key, it->key)) {
-      is_last_move_left = true;
+    if (Compare(key, it->key)) {
+      position.is_left = true;
+      it = it->left;
+    } else if (Compare(it->key, key)) {
+      position.is_left = false;
+      it = it->right;
+    } else {
+      position.existing = it; // key already exists
+      return position;
+    }
+  }
+
+  return position;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K>
+typename Set<Key, Comparator, Alloc, Balancing>::InsertPosition Set<Key, Comparator, Alloc, Balancing>::FindHintPosition(Node<Key>* hint, const K& key) const {
+  if (root_->left == nullptr) {
+    return { root_, true, nullptr };
+  }
+
+  stats_.OnSearch();
+
+  // adjacent nodes always have a free slot between them: either the right one has no left child,
+  // or the left one is the rightmost node of that child and has no right one
+  if (hint == root_ || Compare(key, hint->key)) {
+    // "end" node, if hint is the leftmost one
+    auto* before = hint == root_ ? rightmost_ : hint == leftmost_ ? root_ : inorder::Predecessor(hint);
+
+    if (before == root_ || Compare(before->key, key)) {
+      if (hint->left == nullptr) {
+        return { hint, true, nullptr };
+      }
+
+      return { before, false, nullptr };
+    }
+  } else if (Compare(hint->key, key)) {
+    auto* after = hint == rightmost_ ? root_ : inorder::Successor(hint);
+
+    if (after == root_ || Compare(key, after->key)) {
+      if (hint->right == nullptr) {
+        return { hint, false, nullptr };
+      }
+
+      return { after, true, nullptr };
+    }
+  } else {
+    return { hint, false, hint }; // key already exists
+  }
+
+  return FindInsertPosition(key, true); // hint is useless
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K>
+Node<Key>* Set<Key, Comparator, Alloc, Balancing>::FindNode(const K& key) const {
+  stats_.OnSearch();
+  auto* it = root_->left;
+
+  while (it != nullptr) {
+    if (Compare(it->key, key)) {
+      it = it->right;
+    } else if (Compare(key, it->key)) {
+      it = it->left;
+    } else {
+      return it;
+    }
+  }
+
+  return root_;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K>
+Node<Key>* Set<Key, Comparator, Alloc, Balancing>::LowerBoundNode(const K& key) const {
+  stats_.OnSearch();
+  auto* result = root_; // "end" node is greater than any key
+  auto* it = root_->left;
+
+  while (it != nullptr) {
+    if (Compare(it->key, key)) {
+      it = it->right;
+    } else {
+      result = it;
+      it = it->left;
+    }
+  }
+
+  return result;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K>
+Node<Key>* Set<Key, Comparator, Alloc, Balancing>::UpperBoundNode(const K& key) const {
+  stats_.OnSearch();
+  auto* result = root_;
+  auto* it = root_->left;
+
+  while (it != nullptr) {
+    if (Compare(key, it->key)) {
+      result = it;
       it = it->left;
     } else {
-      is_last_move_left = false;
       it = it->right;
-    } 
+    }
+  }
+
+  return result;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K>
+std::pair<typename Set<Key, Comparator, Alloc, Balancing>::const_iterator, typename Set<Key, Comparator, Alloc, Balancing>::const_iterator>
+Set<Key, Comparator, Alloc, Balancing>::EqualRange(const K& key) const {
+  auto lower = iterator(LowerBoundNode(key));
+
+  // keys are unique, so the range holds at most one element
+  if (lower != end() && !Compare(key, *lower)) {
+    return { lower, std::next(lower) };
+  }
+
+  return { lower, lower };
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K>
+std::ranges::subrange<typename Set<Key, Comparator, Alloc, Balancing>::const_iterator> Set<Key, Comparator, Alloc, Balancing>::Range(const K& low, const K& high) const {
+  auto first = iterator(LowerBoundNode(low));
+
+  if (!Compare(low, high)) {
+    return { first, first }; // empty or inverted bounds
+  }
+
+  return { first, iterator(LowerBoundNode(high)) };
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K>
+Set<Key, Comparator, Alloc, Balancing>::size_type Set<Key, Comparator, Alloc, Balancing>::EraseKey(const K& key) {
+  auto* node = FindNode(key);
+  if (node == root_) return 0; // key was not found
+  erase(iterator(node));
+
+  return 1; 
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Set<Key, Comparator, Alloc, Balancing>::const_iterator Set<Key, Comparator, Alloc, Balancing>::find(const Key& key) const {
+  return iterator(FindNode(key));
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K> requires TransparentComparator<Comparator>
+Set<Key, Comparator, Alloc, Balancing>::const_iterator Set<Key, Comparator, Alloc, Balancing>::find(const K& key) const {
+  return iterator(FindNode(key));
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] bool Set<Key, Comparator, Alloc, Balancing>::contains(const Key& key) const {
+  return FindNode(key) != root_;
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename Visit>
+void Set<Key, Comparator, Alloc, Balancing>::FindMany(std::span<const Key> keys, Visit visit) const {
+  // a tree this small stays in cache, there are no misses to overlap and the lockstep only costs
+  if (size_ * sizeof(stored_node) <= kCacheResidentBytes) {
+    for (size_type i = 0; i < keys.size(); ++i) {
+      visit(i, FindNode(keys[i]));
+    }
+
+    return;
   }
 
+  for (size_type first = 0; first < keys.size(); first += kBatchWidth) {
+    auto count = std::min(kBatchWidth, keys.size() - first);
+    const Key* batch = keys.data() + first;
+    stats_.OnSearch(count);
+
+    // lower bound descents, a single comparison per level, equality is checked once at the bottom
+    Node<Key>* current[kBatchWidth];
+    Node<Key>* lower[kBatchWidth];
+    for (size_type i = 0; i < count; ++i) {
+      current[i] = root_->left;
+      lower[i] = root_;
+    }
+
+    // one level of every descent per round, finished ones park at nullptr
+    for (bool active = true; active;) {
+      active = false;
+
+      for (size_type i = 0; i < count; ++i) {
+        auto* node = current[i];
+        if (node == nullptr) {
+          continue;
+        }
+
+        if (Compare(node->key, batch[i])) {
+          node = node->right;
+        } else {
+          lower[i] = node;
+          node = node->left;
+        }
+
+        current[i] = node;
+        if (node != nullptr) {
+          // by the time this descent comes around again the node is on its way into the cache
+          __builtin_prefetch(node);
+          active = true;
+        }
+      }
+    }
+
+    for (size_type i = 0; i < count; ++i) {
+      auto* node = lower[i];
+      visit(first + i, node != root_ && !Compare(batch[i], node->key) ? node : root_);
+    }
+  }
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::find_many(std::span<const Key> keys, std::span<const_iterator> results) const {
+  assert(results.size() >= keys.size());
+  FindMany(keys, [&](size_type i, Node<Key>* node) { results[i] = iterator(node); });
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::contains_many(std::span<const Key> keys, std::span<bool> results) const {
+  assert(results.size() >= keys.size());
+  FindMany(keys, [&](size_type i, Node<Key>* node) { results[i] = node != root_; });
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K> requires TransparentComparator<Comparator>
+[[nodiscard]] bool Set<Key, Comparator, Alloc, Balancing>::contains(const K& key) const {
+  return FindNode(key) != root_;
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Set<Key, Comparator, Alloc, Balancing>::size_type Set<Key, Comparator, Alloc, Balancing>::erase(const Key& key) {
+  return EraseKey(key);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K> requires TransparentComparator<Comparator> && (!std::is_convertible_v<K, typename Set<Key, Comparator, Alloc, Balancing>::iterator>)
+Set<Key, Comparator, Alloc, Balancing>::size_type Set<Key, Comparator, Alloc, Balancing>::erase(K&& key) {
+  return EraseKey(key);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Set<Key, Comparator, Alloc, Balancing>::const_iterator Set<Key, Comparator, Alloc, Balancing>::lower_bound(const Key& key) const {
+  return iterator(LowerBoundNode(key));
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K> requires TransparentComparator<Comparator>
+Set<Key, Comparator, Alloc, Balancing>::const_iterator Set<Key, Comparator, Alloc, Balancing>::lower_bound(const K& key) const {
+  return iterator(LowerBoundNode(key));
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Set<Key, Comparator, Alloc, Balancing>::const_iterator Set<Key, Comparator, Alloc, Balancing>::upper_bound(const Key& key) const {
+  return iterator(UpperBoundNode(key));
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K> requires TransparentComparator<Comparator>
+Set<Key, Comparator, Alloc, Balancing>::const_iterator Set<Key, Comparator, Alloc, Balancing>::upper_bound(const K& key) const {
+  return iterator(UpperBoundNode(key));
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+std::pair<typename Set<Key, Comparator, Alloc, Balancing>::const_iterator, typename Set<Key, Comparator, Alloc, Balancing>::const_iterator>
+Set<Key, Comparator, Alloc, Balancing>::equal_range(const Key& key) const {
+  return EqualRange(key);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K> requires TransparentComparator<Comparator>
+std::pair<typename Set<Key, Comparator, Alloc, Balancing>::const_iterator, typename Set<Key, Comparator, Alloc, Balancing>::const_iterator>
+Set<Key, Comparator, Alloc, Balancing>::equal_range(const K& key) const {
+  return EqualRange(key);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+std::ranges::subrange<typename Set<Key, Comparator, Alloc, Balancing>::const_iterator>
+Set<Key, Comparator, Alloc, Balancing>::range(const Key& low, const Key& high) const {
+  return Range(low, high);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K> requires TransparentComparator<Comparator>
+std::ranges::subrange<typename Set<Key, Comparator, Alloc, Balancing>::const_iterator>
+Set<Key, Comparator, Alloc, Balancing>::range(const K& low, const K& high) const {
+  return Range(low, high);
+};
 
-  new_node->parent = parent;
-  auto* raw_ptr_ = new_node.release();
-  if (is_last_move_left) {
-    parent->left = raw_ptr_;
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+typename Set<Key, Comparator, Alloc, Balancing>::iterator Set<Key, Comparator, Alloc, Balancing>::LinkNode(Node<Key>* node, const InsertPosition& position) {
+  node->parent = position.parent;
+  if (position.is_left) {
+    position.parent->left = node;
   } else {
-    parent->right = raw_ptr_; 
+    position.parent->right = node;
+  }
+
+  if (position.parent == leftmost_ && position.is_left) {
+    leftmost_ = node;
+  }
+
+  if (position.parent == rightmost_ && (!position.is_left || position.parent == root_)) {
+    rightmost_ = node;
   }
 
+  stats_.BeforeRebalance();
+  Balancing::OnInsert(node, root_); // rotations don't move nodes, so node stays valid
+  stats_.AfterRebalance();
   ++size_;
-  return { true, Iterator<Key>{raw_ptr_}}; 
+  return iterator{node};
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Node<Key>* Set<Key, Comparator, Alloc, Balancing>::FindRightmost() const {
+  auto* it = root_;
+  if (it->left == nullptr) {
+    return it;
+  }
+
+  for (it = it->left; it->right != nullptr; it = it->right) {}
+  return it;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename... Args>
+std::pair<bool, typename Set<Key, Comparator, Alloc, Balancing>::iterator> Set<Key, Comparator, Alloc, Balancing>::emplace(Args&&... args) {
+  auto find_position = [this](const Key& key) { return FindInsertPosition(key); };
+  return EmplaceWith(find_position, std::forward<Args>(args)...);
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename... Args>
+typename Set<Key, Comparator, Alloc, Balancing>::iterator Set<Key, Comparator, Alloc, Balancing>::emplace_hint(const_iterator hint, Args&&... args) {
+  auto find_position = [this, hint](const Key& key) mutable { return FindHintPosition(hint.node_ptr(), key); };
+  return EmplaceWith(find_position, std::forward<Args>(args)...).second;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename FindPosition, typename... Args>
+std::pair<bool, typename Set<Key, Comparator, Alloc, Balancing>::iterator> Set<Key, Comparator, Alloc, Balancing>::EmplaceWith(FindPosition find_position, Args&&... args) {
+  if constexpr (sizeof...(Args) == 1 && (std::is_same_v<std::remove_cvref_t<Args>, Key> && ...)) {
+    // args already is a key, no need to construct anything before the search
+    return EmplaceAt(find_position(args...), args..., std::forward<Args>(args)...);
+  } else if constexpr (std::is_nothrow_move_constructible_v<Key>) {
+    // build the key on the stack, so duplicates never reach the allocator
+    Key key{std::forward<Args>(args)...}; // same initialization as in Node
+    return EmplaceAt(find_position(key), key, std::move(key));
+  } else {
+    using namespace std::placeholders;
+    auto deleter = std::bind(&Set::DropNode, this, _1);
+    auto new_node = std::unique_ptr<Node<Key>, decltype(deleter)>(ConstructNodeWithKey(std::forward<Args>(args)...), deleter);
+
+    auto position = find_position(new_node->key);
+    if (position.existing != nullptr) {
+      return { false, iterator(position.existing) };
+    }
+
+    return { true, LinkNode(new_node.release(), position) };
+  }
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename... Args>
+std::pair<bool, typename Set<Key, Comparator, Alloc, Balancing>::iterator> Set<Key, Comparator, Alloc, Balancing>::try_emplace(const Key& key, Args&&... args) {
+  return EmplaceAt(FindInsertPosition(key), key, std::forward<Args>(args)...);
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K, typename... Args> requires TransparentComparator<Comparator>
+std::pair<bool, typename Set<Key, Comparator, Alloc, Balancing>::iterator> Set<Key, Comparator, Alloc, Balancing>::try_emplace(const K& key, Args&&... args) {
+  return EmplaceAt(FindInsertPosition(key), key, std::forward<Args>(args)...);
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K, typename... Args>
+std::pair<bool, typename Set<Key, Comparator, Alloc, Balancing>::iterator> Set<Key, Comparator, Alloc, Balancing>::EmplaceAt(const InsertPosition& position, const K& key, Args&&... args) {
+  if (position.existing != nullptr) {
+    return { false, iterator(position.existing) };
+  }
+
+  // position stays valid, constructing a node doesn't touch the tree
+  Node<Key>* new_node;
+  if constexpr (sizeof...(Args) == 0) {
+    new_node = ConstructNodeWithKey(key);
+  } else {
+    new_node = ConstructNodeWithKey(std::forward<Args>(args)...);
+  }
+
+  return { true, LinkNode(new_node, position) };
 }
 
-template<typename Key, typename Comparator, typename Alloc>
-std::pair<bool, typename Set<Key, Comparator, Alloc>::iterator> Set<Key, Comparator, Alloc>::insert(Key key) {
-  return emplace(std::forward<Key>(key));
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<std::input_iterator It>
+Set<Key, Comparator, Alloc, Balancing>::Set(It first, It last)
+  : Set() {
+  insert(first, last);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Set<Key, Comparator, Alloc, Balancing>::Set(std::initializer_list<Key> keys)
+  : Set(keys.begin(), keys.end()) {
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<std::input_iterator It>
+void Set<Key, Comparator, Alloc, Balancing>::insert(It first, It last) {
+  // below that per key insertion is cheaper than relinking the whole tree
+  auto is_small_batch = [this](size_type count) { return count < size_ / 8; };
+
+  if constexpr (std::forward_iterator<It>) {
+    if (is_small_batch(static_cast<size_type>(std::distance(first, last)))) {
+      for (; first != last; ++first) {
+        emplace(*first);
+      }
+
+      return;
+    }
+
+    auto is_ascending = [this](const Key& lhs, const Key& rhs) { return Compare(lhs, rhs); };
+    if (std::adjacent_find(first, last, std::not_fn(is_ascending)) == last) {
+      BulkInsert(first, last, static_cast<size_type>(std::distance(first, last)));
+      return;
+    }
+  }
+
+  std::vector<Key> keys(first, last);
+  if (is_small_batch(keys.size())) {
+    for (auto& key : keys) {
+      emplace(std::move(key));
+    }
+
+    return;
+  }
+
+  // stable, so the first of equivalent keys wins, like with one by one insertion
+  std::stable_sort(keys.begin(), keys.end(), comparator_);
+  auto is_equivalent = [this](const Key& lhs, const Key& rhs) { return !Compare(lhs, rhs); };
+  keys.erase(std::unique(keys.begin(), keys.end(), is_equivalent), keys.end());
+
+  BulkInsert(std::make_move_iterator(keys.begin()), std::make_move_iterator(keys.end()), keys.size());
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::insert(std::initializer_list<Key> keys) {
+  insert(keys.begin(), keys.end());
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename It>
+std::vector<Node<Key>*> Set<Key, Comparator, Alloc, Balancing>::ConstructNodes(It first, It last) {
+  std::vector<Node<Key>*> nodes;
+  if constexpr (std::forward_iterator<It>) {
+    nodes.reserve(static_cast<size_type>(std::distance(first, last)));
+  }
+
+  try {
+    for (; first != last; ++first) {
+      auto* node = ConstructNodeWithKey(*first);
+
+      try {
+        nodes.push_back(node);
+      } catch (...) {
+        DropNode(node);
+        throw;
+      }
+    }
+  } catch (...) {
+    for (auto* node : nodes) {
+      DropNode(node);
+    }
+
+    throw;
+  }
+
+  return nodes;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename It>
+void Set<Key, Comparator, Alloc, Balancing>::BulkInsert(It first, It last, size_type count) {
+  if (root_->left == nullptr) {
+    Rebuild(ConstructNodes(first, last));
+    return;
+  }
+
+  // keys are zipped with the tree, duplicates are skipped before anything is allocated.
+  // Nothing is linked until every node exists, so a throw leaves the tree as it was
+  std::vector<Node<Key>*> merged;
+  merged.reserve(size_ + count);
+
+  auto* existing = leftmost_;
+  try {
+    for (; first != last; ++first) {
+      while (existing != root_ && Compare(existing->key, *first)) {
+        merged.push_back(existing);
+        existing = inorder::Successor(existing);
+      }
+
+      if (existing != root_ && !Compare(*first, existing->key)) {
+        continue; // already present
+      }
+
+      merged.push_back(ConstructNodeWithKey(*first));
+    }
+  } catch (...) {
+    // the nodes of the tree show up in merged in order, everything in between is new
+    existing = leftmost_;
+    for (auto* node : merged) {
+      if (node == existing) {
+        existing = inorder::Successor(existing);
+      } else {
+        DropNode(node);
+      }
+    }
+
+    throw;
+  }
+
+  for (; existing != root_; existing = inorder::Successor(existing)) {
+    merged.push_back(existing);
+  }
+
+  Rebuild(merged);
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename OnDuplicate>
+void Set<Key, Comparator, Alloc, Balancing>::ZipNodes(const std::vector<Node<Key>*>& incoming, std::vector<Node<Key>*>& merged, OnDuplicate on_duplicate) const {
+  // every key gets compared at most once
+  auto* existing = leftmost_;
+  auto it = incoming.begin();
+
+  while (existing != root_ && it != incoming.end()) {
+    if (Compare((*it)->key, existing->key)) {
+      merged.push_back(*it++);
+    } else {
+      if (!Compare(existing->key, (*it)->key)) {
+        on_duplicate(*it++); // already present
+      }
+
+      merged.push_back(existing);
+      existing = inorder::Successor(existing);
+    }
+  }
+
+  for (; existing != root_; existing = inorder::Successor(existing)) {
+    merged.push_back(existing);
+  }
+  merged.insert(merged.end(), it, incoming.end());
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::Rebuild(const std::vector<Node<Key>*>& nodes) {
+  size_ = nodes.size();
+  leftmost_ = nodes.empty() ? root_ : nodes.front();
+  rightmost_ = nodes.empty() ? root_ : nodes.back();
+  root_->left = BuildBalanced(nodes.data(), size_, 0, static_cast<int>(std::bit_width(size_)) - 1);
+  if (root_->left != nullptr) {
+    root_->left->parent = root_;
+  }
+
+  RelinkAugment();
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::RelinkAugment() {
+  if constexpr (requires { augment::Relink(root_); }) {
+    augment::Relink(root_);
+  }
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Node<Key>* Set<Key, Comparator, Alloc, Balancing>::BuildBalanced(Node<Key>* const* first, size_type count, int depth, int max_depth) {
+  // middle node becomes the root, so sizes of sibling subtrees differ by at most one
+  // and recursion depth is logarithmic
+  if (count == 0) {
+    return nullptr;
+  }
+
+  size_type left_size = (count - 1) / 2;
+  size_type right_size = count - 1 - left_size;
+  auto* node = first[left_size];
+
+  node->left = BuildBalanced(first, left_size, depth + 1, max_depth);
+  node->right = BuildBalanced(first + left_size + 1, right_size, depth + 1, max_depth);
+
+  if (node->left != nullptr) {
+    node->left->parent = node;
+  }
+  if (node->right != nullptr) {
+    node->right->parent = node;
+  }
+
+  Balancing::OnBuild(node, left_size, right_size, depth, max_depth);
+  return node;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+std::pair<bool, typename Set<Key, Comparator, Alloc, Balancing>::iterator> Set<Key, Comparator, Alloc, Balancing>::insert(const Key& key) {
+  return try_emplace(key);
+}; 
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+std::pair<bool, typename Set<Key, Comparator, Alloc, Balancing>::iterator> Set<Key, Comparator, Alloc, Balancing>::insert(Key&& key) {
+  return try_emplace(key, std::move(key));
 }; 
 
-template<typename Key, typename Comparator, typename Alloc>
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+typename Set<Key, Comparator, Alloc, Balancing>::iterator Set<Key, Comparator, Alloc, Balancing>::insert(const_iterator hint, const Key& key) {
+  return emplace_hint(hint, key);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+typename Set<Key, Comparator, Alloc, Balancing>::iterator Set<Key, Comparator, Alloc, Balancing>::insert(const_iterator hint, Key&& key) {
+  return emplace_hint(hint, std::move(key));
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
 template <typename Traversal>
-[[nodiscard]] Iterator<Key, Traversal> Set<Key, Comparator, Alloc>::
+[[nodiscard]] Iterator<Key, Traversal> Set<Key, Comparator, Alloc, Balancing>::
 begin() const {
+  if constexpr (std::is_same_v<Traversal, inorder>) {
+    return Iterator<Key, Traversal>(leftmost_);
+  } else {
     return Iterator<Key, Traversal>::GetBegin(root_);
+  }
 };
 
-template<typename Key, typename Comparator, typename Alloc>
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
 template <typename Traversal>
-[[nodiscard]] Iterator<Key, Traversal> Set<Key, Comparator, Alloc>::
+[[nodiscard]] Iterator<Key, Traversal> Set<Key, Comparator, Alloc, Balancing>::
 end() const {
     return Iterator<Key, Traversal>::GetEnd(root_);
 };
 
-template<typename Key, typename Comparator, typename Alloc>
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
 template <typename Traversal>
-[[nodiscard]] ReverseIterator<Key, Traversal> Set<Key, Comparator, Alloc>::
+[[nodiscard]] ReverseIterator<Key, Traversal> Set<Key, Comparator, Alloc, Balancing>::
 rend() {
     return ReverseIterator(Iterator<Key, Traversal>(root_));
 };
 
-template<typename Key, typename Comparator, typename Alloc>
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
 template <typename Traversal>
-[[nodiscard]] ReverseIterator<Key, Traversal> Set<Key, Comparator, Alloc>::
+[[nodiscard]] ReverseIterator<Key, Traversal> Set<Key, Comparator, Alloc, Balancing>::
 rbegin() {
+  if constexpr (std::is_same_v<Traversal, inorder>) {
+    return ReverseIterator(Iterator<Key, Traversal>(rightmost_));
+  } else {
     return ReverseIterator(--Iterator<Key, Traversal>::GetEnd(root_));
+  }
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-Set<Key, Comparator, Alloc>::Set(const Set<Key, Comparator, Alloc>& other) {
-  // TODO: probably get rid of recursion here (pohuy)
-  allocator_ = std::allocator_traits<allocator_type>::select_on_container_copy_construction(other.allocator_);
-  
-  auto preorder_copy = [this](Node<Key>* node, auto& this_closure) -> void {
-    if (node == nullptr) return;
-    insert(node->key);
-    this_closure(node->left, this_closure);
-    this_closure(node->right, this_closure);
-  };
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Set<Key, Comparator, Alloc, Balancing>::Set(const Set<Key, Comparator, Alloc, Balancing>& other)
+  : comparator_{other.comparator_},
+    allocator_{std::allocator_traits<allocator_type>::select_on_container_copy_construction(other.allocator_)} {
+  Node<Key>* reusable = nullptr;
+  root_->left = CloneTree(other.root_->left, reusable); // partial copies clean up after themselves
+
+  if (root_->left != nullptr) {
+    root_->left->parent = root_;
+  }
 
-  preorder_copy(other.root_, preorder_copy);
+  RelinkAugment();
+  leftmost_ = InOrder<Key>::GetInitial(root_);
+  rightmost_ = FindRightmost();
+  size_ = other.size_;
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-Set<Key, Comparator, Alloc>& Set<Key, Comparator, Alloc>::operator=(const Set<Key, Comparator, Alloc>& other) {
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Set<Key, Comparator, Alloc, Balancing>& Set<Key, Comparator, Alloc, Balancing>::operator=(const Set<Key, Comparator, Alloc, Balancing>& other) {
   if (this == &other) {
     return *this;
   }
 
-  DropTree();
+  if constexpr (std::allocator_traits<allocator_type>::propagate_on_container_copy_assignment::value) {
+    if (allocator_ != other.allocator_) {
+      // nodes can't be reused, they have to go back to the allocator they came from
+      clear();
+      allocator_ = other.allocator_;
+    } else {
+      allocator_ = other.allocator_;
+    }
+  }
 
-  for (auto i : other) {
-    insert(i);
+  comparator_ = other.comparator_;
+
+  // keys of already allocated nodes get overwritten instead of allocating new ones
+  auto* reusable = FlattenTree();
+
+  try {
+    root_->left = CloneTree(other.root_->left, reusable);
+  } catch (...) {
+    DropList(reusable);
+    throw;
   }
 
+  DropList(reusable);
+
+  if (root_->left != nullptr) {
+    root_->left->parent = root_;
+  }
+
+  RelinkAugment();
+  leftmost_ = InOrder<Key>::GetInitial(root_);
+  rightmost_ = FindRightmost();
+  size_ = other.size_;
   return *this;
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-Set<Key, Comparator, Alloc>::Set(Set<Key, Comparator, Alloc>&& other) noexcept {
-  root_ = std::exchange(other.root_, ConstructEmptyNode());
-  size_ = std::exchange(other.size_, 0);
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Set<Key, Comparator, Alloc, Balancing>::Set(Set<Key, Comparator, Alloc, Balancing>&& other) noexcept
+  : comparator_{other.comparator_},
+    allocator_{std::exchange(other.allocator_, allocator_type())},
+    leftmost_{root_},
+    rightmost_{root_} {
+  // nodes stay with the allocator they came from, other is left with the empty tree.
+  // The comparator is copied, so other keeps ordering by it
+  SwapTrees(other);
 };
 
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::SwapTrees(Set<Key, Comparator, Alloc, Balancing>& other) noexcept {
+  std::swap(root_->left, other.root_->left);
+  if (root_->left != nullptr) {
+    root_->left->parent = root_;
+  }
+  if (other.root_->left != nullptr) {
+    other.root_->left->parent = other.root_;
+  }
 
-template<typename Key, typename Comparator, typename Alloc>
-Set<Key, Comparator, Alloc>::size_type Set<Key, Comparator, Alloc>::erase(const Key& key) {
-  auto it = find(key);
-  if (it == end()) return 0; // key was not found
-  erase(it);
+  // cached ends of an empty tree are its own "end" node
+  std::swap(leftmost_, other.leftmost_);
+  std::swap(rightmost_, other.rightmost_);
+  for (auto* set : {this, &other}) {
+    auto* foreign_end = set == this ? other.root_ : root_;
+    if (set->leftmost_ == foreign_end) {
+      set->leftmost_ = set->root_;
+      set->rightmost_ = set->root_;
+    }
+  }
 
-  return 1; 
+  std::swap(size_, other.size_);
+
+  if constexpr (requires { augment::SwapHeaders(root_, other.root_); }) {
+    augment::SwapHeaders(root_, other.root_);
+  }
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-Set<Key, Comparator, Alloc>::const_iterator Set<Key, Comparator, Alloc>::find(const Key& key) {
-  auto* it = root_->left;
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::swap(Set<Key, Comparator, Alloc, Balancing>& other) noexcept {
+  if (this == &other) {
+    return;
+  }
 
-  while (it != nullptr) {
-    if (std::equal_to<Key>{}(key, it->key)) {
-      return Iterator<Key>(it);
+  using std::swap;
+  swap(comparator_, other.comparator_);
+  if constexpr (std::allocator_traits<allocator_type>::propagate_on_container_swap::value) {
+    swap(allocator_, other.allocator_);
+  }
+
+  SwapTrees(other);
+};
+
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::EraseNodeByPointer(Node<Key>* node) {
+  // no key is copied, nodes other than the erased one stay where they were
+  UnlinkNode(node);
+  DropNode(node);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Set<Key, Comparator, Alloc, Balancing>::const_iterator Set<Key, Comparator, Alloc, Balancing>::erase(iterator it) {
+  --size_; // erasure should occure anyway
+  auto successor = ++Iterator(it); // stays valid, only the erased node is unlinked
+  EraseNodeByPointer(it.node_ptr());
+  return successor;
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::UnlinkNode(Node<Key>* node) {
+  if (node == leftmost_) {
+    leftmost_ = inorder::Successor(node);
+  }
+
+  if (node == rightmost_) {
+    rightmost_ = inorder::Predecessor(node);
+  }
+
+  // the slot that actually disappears from the tree: its parent, side and the child taking it
+  Node<Key>* child;
+  Node<Key>* parent;
+  bool was_left;
+
+  if (node->left != nullptr && node->right != nullptr) {
+    // successor has no left child, it takes node's place and its own slot disappears instead
+    auto* successor = node->right;
+    while (successor->left != nullptr) {
+      successor = successor->left;
     }
 
-    if (comparator_(it->key, key)) {
-      it = it->right;
+    child = successor->right;
+
+    if (successor == node->right) {
+      parent = successor;
+      was_left = false;
     } else {
-      it = it->left;
-    } 
+      parent = successor->parent;
+      was_left = true;
+
+      parent->left = child;
+      if (child != nullptr) {
+        child->parent = parent;
+      }
+
+      successor->right = node->right;
+      node->right->parent = successor;
+    }
+
+    successor->left = node->left;
+    node->left->parent = successor;
+
+    if (node->parent->left == node) {
+      node->parent->left = successor;
+    } else {
+      node->parent->right = successor;
+    }
+    successor->parent = node->parent;
+
+    // successor inherits node's bookkeeping, node describes the removed slot from now on
+    std::swap(successor->balance, node->balance);
+  } else {
+    child = node->left != nullptr ? node->left : node->right;
+    parent = node->parent;
+    was_left = parent->left == node;
+
+    if (was_left) {
+      parent->left = child;
+    } else {
+      parent->right = child;
+    }
+
+    if (child != nullptr) {
+      child->parent = parent;
+    }
+  }
+
+  stats_.BeforeRebalance();
+  Balancing::OnErase(node, child, parent, was_left, root_);
+  stats_.AfterRebalance();
+
+  // looks like a freshly constructed node again
+  node->left = nullptr;
+  node->right = nullptr;
+  node->parent = nullptr;
+  node->balance = 0;
+  augment::Update(node);
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+typename Set<Key, Comparator, Alloc, Balancing>::node_type Set<Key, Comparator, Alloc, Balancing>::extract(const_iterator position) {
+  auto* node = position.node_ptr();
+  UnlinkNode(node);
+  --size_;
+
+  return node_type(node, allocator_);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+typename Set<Key, Comparator, Alloc, Balancing>::node_type Set<Key, Comparator, Alloc, Balancing>::extract(const Key& key) {
+  return ExtractKey(key);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K> requires TransparentComparator<Comparator> && (!std::is_convertible_v<K, typename Set<Key, Comparator, Alloc, Balancing>::iterator>)
+typename Set<Key, Comparator, Alloc, Balancing>::node_type Set<Key, Comparator, Alloc, Balancing>::extract(K&& key) {
+  return ExtractKey(key);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K>
+typename Set<Key, Comparator, Alloc, Balancing>::node_type Set<Key, Comparator, Alloc, Balancing>::ExtractKey(const K& key) {
+  auto* node = FindNode(key);
+  if (node == root_) return {}; // key was not found
+
+  return extract(iterator(node));
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+typename Set<Key, Comparator, Alloc, Balancing>::insert_return_type Set<Key, Comparator, Alloc, Balancing>::insert(node_type&& node) {
+  if (node.empty()) {
+    return { end(), false, {} };
+  }
+
+  auto position = FindInsertPosition(node.value());
+  if (position.existing != nullptr) {
+    return { iterator(position.existing), false, std::move(node) };
+  }
+
+  if (node.get_allocator() != allocator_) {
+    // node can't outlive the allocator it came from, so only the key moves over
+    // and the husk is freed by the handle
+    auto it = EmplaceAt(position, node.value(), std::move(node.value())).second;
+    node.reset();
+    return { it, true, {} };
   }
 
-  return end(); 
+  return { LinkNode(node.release(), position), true, {} };
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-void Set<Key, Comparator, Alloc>::EraseNodeByPointer(Node<Key>* node) {
-  auto get_parents_pointer = [](Node<Key>* ptr) -> Node<Key>*& {
-    return ptr->parent->right == ptr ? ptr->parent->right : ptr->parent->left;
-  };
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+typename Set<Key, Comparator, Alloc, Balancing>::iterator Set<Key, Comparator, Alloc, Balancing>::insert(const_iterator hint, node_type&& node) {
+  if (node.empty()) {
+    return end();
+  }
 
-  if (node->left == nullptr && node->right == nullptr) {
-    get_parents_pointer(node) = nullptr;
-    DropNode(node);
-    return;
+  auto position = FindHintPosition(hint.node_ptr(), node.value());
+  if (position.existing != nullptr) {
+    return iterator(position.existing);
   }
 
-  if (node->left != nullptr && node->right != nullptr) {
-    auto* successor = InOrder<Key>::Successor(node);
-    node->key = successor->key;
+  if (node.get_allocator() != allocator_) {
+    auto it = EmplaceAt(position, node.value(), std::move(node.value())).second;
+    node.reset();
+    return it;
+  }
+
+  return LinkNode(node.release(), position);
+};
 
-    EraseNodeByPointer(successor);
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename C2, typename B2>
+void Set<Key, Comparator, Alloc, Balancing>::merge(Set<Key, C2, Alloc, B2>& source) {
+  if (static_cast<void*>(&source) == static_cast<void*>(this)) {
     return;
   }
 
-  if (node->left != nullptr) { // only single left child
-    get_parents_pointer(node) = node->left;
-    node->left->parent = node->parent;
-    DropNode(node);
-  } else { // only single right child
-    get_parents_pointer(node) = node->right;
-    node->right->parent = node->parent;
-    DropNode(node);
+  // nodes of a set with another augmentation have another layout
+  bool can_relink = false;
+  if constexpr (std::is_same_v<allocator_type, typename Set<Key, C2, Alloc, B2>::allocator_type>) {
+    can_relink = allocator_ == source.allocator_;
+  }
+
+  // zip only works if both sets are ordered the same way,
+  // for a small source per node insertion is cheaper than relinking the whole tree
+  if constexpr (std::is_same_v<C2, Comparator>) {
+    if (can_relink && source.size_ >= size_ / 8) {
+      std::vector<Node<Key>*> incoming;
+      incoming.reserve(source.size_);
+      for (auto* node = InOrder<Key>::GetInitial(source.root_); node != source.root_; node = InOrder<Key>::Successor(node)) {
+        incoming.push_back(node);
+      }
+
+      // both trees stay intact until nothing can throw anymore
+      std::vector<Node<Key>*> merged;
+      std::vector<Node<Key>*> duplicates;
+      merged.reserve(size_ + incoming.size());
+      duplicates.reserve(std::min(size_, incoming.size()));
+
+      ZipNodes(incoming, merged, [&duplicates](Node<Key>* node) { duplicates.push_back(node); });
+      Rebuild(merged);
+      source.Rebuild(duplicates);
+      return;
+    }
+  }
+
+  auto* node = InOrder<Key>::GetInitial(source.root_);
+  while (node != source.root_) {
+    auto* next = InOrder<Key>::Successor(node); // unlinking keeps other nodes in place
+    auto position = FindInsertPosition(node->key);
+
+    if (position.existing == nullptr) {
+      if (can_relink) {
+        source.UnlinkNode(node);
+        --source.size_;
+        LinkNode(node, position);
+      } else {
+        // nodes have to stay with their allocator, the key moves alone.
+        // If that throws, the key is still in source (it's copied unless its move can't throw)
+        EmplaceAt(position, node->key, std::move_if_noexcept(node->key));
+        source.UnlinkNode(node);
+        --source.size_;
+        source.DropNode(node);
+      }
+    }
+
+    node = next;
   }
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-Set<Key, Comparator, Alloc>::const_iterator Set<Key, Comparator, Alloc>::erase(iterator it) {
-  --size_; // erasure should occure anyway
-  auto successor = ++Iterator(it);
-  EraseNodeByPointer(it.node_ptr());
-  return successor;
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename C2, typename B2>
+void Set<Key, Comparator, Alloc, Balancing>::merge(Set<Key, C2, Alloc, B2>&& source) {
+  merge(source);
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-Set<Key, Comparator, Alloc>& Set<Key, Comparator, Alloc>::operator=(Set<Key, Comparator, Alloc>&& other) noexcept {
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+Set<Key, Comparator, Alloc, Balancing>& Set<Key, Comparator, Alloc, Balancing>::operator=(Set<Key, Comparator, Alloc, Balancing>&& other)
+  noexcept(kNothrowMoveAssign) {
   if (this == &other) {
     return *this;
   }
-  
-  DropTree(); // this drops everything including "endian" root node
-  root_ = std::exchange(other.root_, ConstructEmptyNode());
-  size_ = std::exchange(other.size_, 0);
 
-  if constexpr (std::allocator_traits<allocator_type>::propagate_on_container_move_assignment::value) {
-    allocator_ =  std::exchange(other.allocator_, allocator_type());
+  using traits = std::allocator_traits<allocator_type>;
+  if constexpr (!traits::propagate_on_container_move_assignment::value && !traits::is_always_equal::value) {
+    if (allocator_ != other.allocator_) {
+      // nodes have to stay with the allocator they came from, the keys move alone
+      clear();
+      comparator_ = other.comparator_;
+      for (auto* node = other.leftmost_; node != other.root_; node = InOrder<Key>::Successor(node)) {
+        emplace_hint(end(), std::move(node->key));
+      }
+
+      other.clear();
+      return *this;
+    }
+  }
+
+  // the old tree goes to other and is freed with it, nothing is freed here
+  using std::swap;
+  swap(comparator_, other.comparator_);
+  if constexpr (traits::propagate_on_container_move_assignment::value) {
+    swap(allocator_, other.allocator_);
   }
 
+  SwapTrees(other);
   return *this;
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-[[nodiscard]] Set<Key, Comparator, Alloc>::const_iterator Set<Key, Comparator, Alloc>::cbegin() const {
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] Set<Key, Comparator, Alloc, Balancing>::const_iterator Set<Key, Comparator, Alloc, Balancing>::cbegin() const {
   return begin();
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-[[nodiscard]] Set<Key, Comparator, Alloc>::const_iterator Set<Key, Comparator, Alloc>::cend() const {
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] Set<Key, Comparator, Alloc, Balancing>::const_iterator Set<Key, Comparator, Alloc, Balancing>::cend() const {
   return end();
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-[[nodiscard]] Set<Key, Comparator, Alloc>::const_iterator Set<Key, Comparator, Alloc>::crbegin() const {
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] Set<Key, Comparator, Alloc, Balancing>::const_iterator Set<Key, Comparator, Alloc, Balancing>::crbegin() const {
   return rbegin();
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-[[nodiscard]] Set<Key, Comparator, Alloc>::const_iterator Set<Key, Comparator, Alloc>::crend() const {
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] Set<Key, Comparator, Alloc, Balancing>::const_iterator Set<Key, Comparator, Alloc, Balancing>::crend() const {
   return rend();
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-[[nodiscard]] Set<Key, Comparator, Alloc>::size_type Set<Key, Comparator, Alloc>::size() const {
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] Set<Key, Comparator, Alloc, Balancing>::const_iterator Set<Key, Comparator, Alloc, Balancing>::nth(size_type k) const requires RankedTraversal<inorder, Key> {
+  return iterator(inorder::Select(root_, k));
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] Set<Key, Comparator, Alloc, Balancing>::size_type Set<Key, Comparator, Alloc, Balancing>::rank(const Key& key) const requires RankedTraversal<inorder, Key> {
+  return Rank(key);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K> requires TransparentComparator<Comparator> && RankedTraversal<typename Set<Key, Comparator, Alloc, Balancing>::inorder, Key>
+[[nodiscard]] Set<Key, Comparator, Alloc, Balancing>::size_type Set<Key, Comparator, Alloc, Balancing>::rank(const K& key) const {
+  return Rank(key);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] Set<Key, Comparator, Alloc, Balancing>::difference_type Set<Key, Comparator, Alloc, Balancing>::distance(const_iterator first, const_iterator last) const requires RankedTraversal<inorder, Key> {
+  return last - first;
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template<typename K>
+Set<Key, Comparator, Alloc, Balancing>::size_type Set<Key, Comparator, Alloc, Balancing>::Rank(const K& key) const {
+  // same descent as in LowerBoundNode, counting everything left behind
+  stats_.OnSearch();
+  size_type rank = 0;
+  auto* it = root_->left;
+
+  while (it != nullptr) {
+    if (Compare(it->key, key)) {
+      rank += inorder::Size(it->left) + 1;
+      it = it->right;
+    } else {
+      it = it->left;
+    }
+  }
+
+  return rank;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] FrozenSet<Key, Comparator, Alloc> Set<Key, Comparator, Alloc, Balancing>::freeze() const {
+  // keys are already sorted and unique, so they are laid out without a single comparison
+  // besides the sortedness check
+  return FrozenSet<Key, Comparator, Alloc>(begin(), end(), comparator_);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::save(const std::string& path) const requires std::is_trivially_copyable_v<Key> {
+  WriteSetImage(path, freeze());
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+MappedSet<Key, Comparator> Set<Key, Comparator, Alloc, Balancing>::open_mapped(const std::string& path, bool verify_checksum) requires std::is_trivially_copyable_v<Key> {
+  return MappedSet<Key, Comparator>(path, verify_checksum);
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+template <typename A, typename B>
+bool Set<Key, Comparator, Alloc, Balancing>::Compare(const A& lhs, const B& rhs) const {
+  stats_.OnCompare();
+  return comparator_(lhs, rhs);
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+typename Set<Key, Comparator, Alloc, Balancing>::size_type Set<Key, Comparator, Alloc, Balancing>::height() const {
+  return depth_histogram().size();
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+std::vector<typename Set<Key, Comparator, Alloc, Balancing>::size_type> Set<Key, Comparator, Alloc, Balancing>::depth_histogram() const {
+  // preorder through the parent pointers, the depth goes up and down with every step
+  std::vector<size_type> histogram;
+  auto* node = root_->left;
+  size_type depth = 0;
+
+  while (node != nullptr) {
+    if (histogram.size() <= depth) {
+      histogram.push_back(0);
+    }
+    ++histogram[depth];
+
+    if (node->left != nullptr) {
+      node = node->left;
+      ++depth;
+    } else if (node->right != nullptr) {
+      node = node->right;
+      ++depth;
+    } else {
+      // climb until a right sibling is still to be visited
+      while (node != root_->left && (node->parent->right == node || node->parent->right == nullptr)) {
+        node = node->parent;
+        --depth;
+      }
+
+      node = node == root_->left ? nullptr : node->parent->right;
+    }
+  }
+
+  return histogram;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+SetStats Set<Key, Comparator, Alloc, Balancing>::stats() const requires (!std::is_same_v<stats_type, NoStats>) {
+  SetStats result;
+  result.size = size_;
+  result.searches = stats_.searches;
+  result.comparisons = stats_.comparisons;
+  result.allocations = stats_.allocations;
+  result.frees = stats_.frees;
+  result.rotations = stats_.rotations;
+  result.rebalances = stats_.rebalances;
+
+  auto histogram = depth_histogram();
+  result.height = histogram.size();
+  for (size_type depth = 0; depth < histogram.size(); ++depth) {
+    result.average_depth += static_cast<double>(depth * histogram[depth]);
+  }
+  if (size_ != 0) {
+    result.average_depth /= static_cast<double>(size_);
+  }
+
+  return result;
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::reset_stats() requires (!std::is_same_v<stats_type, NoStats>) {
+  stats_ = stats_type();
+}
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] const Key& Set<Key, Comparator, Alloc, Balancing>::min() const {
+  assert(size_ != 0);
+  return leftmost_->key;
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] const Key& Set<Key, Comparator, Alloc, Balancing>::max() const {
+  assert(size_ != 0);
+  return rightmost_->key;
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::pop_front() {
+  // in a balanced tree the successor of the leftmost node is at most a step away,
+  // and so is the rebalancing in amortized terms
+  assert(size_ != 0);
+  --size_;
+  EraseNodeByPointer(leftmost_);
+};
+
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] Set<Key, Comparator, Alloc, Balancing>::size_type Set<Key, Comparator, Alloc, Balancing>::size() const {
   return size_;
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-[[nodiscard]] bool Set<Key, Comparator, Alloc>::empty() const {
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+[[nodiscard]] bool Set<Key, Comparator, Alloc, Balancing>::empty() const {
   return size_ == 0;
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-[[nodiscard]] bool Set<Key, Comparator, Alloc>::contains(const Key& key) const {
-  return find(key) == cend();
+template<typename Key, typename Comparator, typename Alloc, typename Balancing>
+void Set<Key, Comparator, Alloc, Balancing>::clear() {
+  DropTree();
+  leftmost_ = root_;
+  rightmost_ = root_;
+  size_ = 0;
+  RelinkAugment();
 };
 
-template<typename Key, typename Comparator, typename Alloc>
-void Set<Key, Comparator, Alloc>::clear() {
-  DropTree();
-  root_ = ConstructEmptyNode();
+// B+-tree engine behind the same name, see BTreeSet for what differs from the binary trees
+template<typename Key, typename Comparator, typename Alloc, std::size_t NodeBytes>
+class Set<Key, Comparator, Alloc, BTree<NodeBytes>> : public BTreeSet<Key, Comparator, Alloc, NodeBytes> {
+public:
+  using balancing = BTree<NodeBytes>;
+
+  using BTreeSet<Key, Comparator, Alloc, NodeBytes>::BTreeSet;
 };
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/* Search kernels for sorted blocks of arithmetic keys. Instead of a binary search
+ * every key of the block is compared with the probe, a vector of keys at a time,
+ * and the keys ordered before the probe are counted: for a sorted block that count
+ * is the lower bound. Kernels are picked at compile time: AVX2 covers 32 and 64-bit
+ * integers, floats and doubles, SSE2 all but 64-bit integers which need SSE4.2,
+ * anything else gets no kernel and stays with the comparator */
+
+namespace simd_detail {
+
+// vector operations on keys of one type, unsupported types have no kWidth
+template <typename Key>
+struct Lanes {};
+
+#if defined(__AVX2__)
+
+template <typename Key> requires (std::is_integral_v<Key> && sizeof(Key) == 4)
+struct Lanes<Key> {
+  using Vector = __m256i;
+  static constexpr std::uint32_t kWidth = 8;
+
+  // unsigned keys are shifted by 2^31, so the signed compare orders them right
+  static Vector Bias(Vector v) {
+    if constexpr (std::is_unsigned_v<Key>) {
+      return _mm256_xor_si256(v, _mm256_set1_epi32(INT32_MIN));
+    }
+
+    return v;
+  }
+
+  static Vector Load(const Key* keys) {
+    return Bias(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys)));
+  }
+
+  static Vector Broadcast(Key key) {
+    return Bias(_mm256_set1_epi32(static_cast<std::int32_t>(key)));
+  }
+
+  // bit i is set if a[i] < b[i]
+  static unsigned Less(Vector a, Vector b) {
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(b, a)));
+  }
+};
+
+template <typename Key> requires (std::is_integral_v<Key> && sizeof(Key) == 8)
+struct Lanes<Key> {
+  using Vector = __m256i;
+  static constexpr std::uint32_t kWidth = 4;
+
+  static Vector Bias(Vector v) {
+    if constexpr (std::is_unsigned_v<Key>) {
+      return _mm256_xor_si256(v, _mm256_set1_epi64x(INT64_MIN));
+    }
+
+    return v;
+  }
+
+  static Vector Load(const Key* keys) {
+    return Bias(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys)));
+  }
+
+  static Vector Broadcast(Key key) {
+    return Bias(_mm256_set1_epi64x(static_cast<std::int64_t>(key)));
+  }
+
+  static unsigned Less(Vector a, Vector b) {
+    return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(b, a)));
+  }
+};
+
+template <>
+struct Lanes<float> {
+  using Vector = __m256;
+  static constexpr std::uint32_t kWidth = 8;
+
+  static Vector Load(const float* keys) {
+    return _mm256_loadu_ps(keys);
+  }
+
+  static Vector Broadcast(float key) {
+    return _mm256_set1_ps(key);
+  }
+
+  static unsigned Less(Vector a, Vector b) {
+    return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ));
+  }
+};
+
+template <>
+struct Lanes<double> {
+  using Vector = __m256d;
+  static constexpr std::uint32_t kWidth = 4;
+
+  static Vector Load(const double* keys) {
+    return _mm256_loadu_pd(keys);
+  }
+
+  static Vector Broadcast(double key) {
+    return _mm256_set1_pd(key);
+  }
+
+  static unsigned Less(Vector a, Vector b) {
+    return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LT_OQ));
+  }
+};
+
+#elif defined(__SSE2__)
+
+template <typename Key> requires (std::is_integral_v<Key> && sizeof(Key) == 4)
+struct Lanes<Key> {
+  using Vector = __m128i;
+  static constexpr std::uint32_t kWidth = 4;
+
+  static Vector Bias(Vector v) {
+    if constexpr (std::is_unsigned_v<Key>) {
+      return _mm_xor_si128(v, _mm_set1_epi32(INT32_MIN));
+    }
+
+    return v;
+  }
+
+  static Vector Load(const Key* keys) {
+    return Bias(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys)));
+  }
+
+  static Vector Broadcast(Key key) {
+    return Bias(_mm_set1_epi32(static_cast<std::int32_t>(key)));
+  }
+
+  static unsigned Less(Vector a, Vector b) {
+    return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(b, a)));
+  }
+};
+
+#if defined(__SSE4_2__)
+
+template <typename Key> requires (std::is_integral_v<Key> && sizeof(Key) == 8)
+struct Lanes<Key> {
+  using Vector = __m128i;
+  static constexpr std::uint32_t kWidth = 2;
+
+  static Vector Bias(Vector v) {
+    if constexpr (std::is_unsigned_v<Key>) {
+      return _mm_xor_si128(v, _mm_set1_epi64x(INT64_MIN));
+    }
+
+    return v;
+  }
+
+  static Vector Load(const Key* keys) {
+    return Bias(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys)));
+  }
+
+  static Vector Broadcast(Key key) {
+    return Bias(_mm_set1_epi64x(static_cast<std::int64_t>(key)));
+  }
+
+  static unsigned Less(Vector a, Vector b) {
+    return _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(b, a)));
+  }
+};
+
+#endif
+
+template <>
+struct Lanes<float> {
+  using Vector = __m128;
+  static constexpr std::uint32_t kWidth = 4;
+
+  static Vector Load(const float* keys) {
+    return _mm_loadu_ps(keys);
+  }
+
+  static Vector Broadcast(float key) {
+    return _mm_set1_ps(key);
+  }
+
+  static unsigned Less(Vector a, Vector b) {
+    return _mm_movemask_ps(_mm_cmplt_ps(a, b));
+  }
+};
+
+template <>
+struct Lanes<double> {
+  using Vector = __m128d;
+  static constexpr std::uint32_t kWidth = 2;
+
+  static Vector Load(const double* keys) {
+    return _mm_loadu_pd(keys);
+  }
+
+  static Vector Broadcast(double key) {
+    return _mm_set1_pd(key);
+  }
+
+  static unsigned Less(Vector a, Vector b) {
+    return _mm_movemask_pd(_mm_cmplt_pd(a, b));
+  }
+};
+
+#endif
+
+template <typename Comparator, typename Key>
+inline constexpr bool kAscending = std::same_as<Comparator, std::less<Key>> || std::same_as<Comparator, std::less<>>;
+
+template <typename Comparator, typename Key>
+inline constexpr bool kDescending = std::same_as<Comparator, std::greater<Key>> || std::same_as<Comparator, std::greater<>>;
+
+} // namespace simd_detail
+
+// comparator is known to be a plain < or > on keys the target has vector compares for
+template <typename Key, typename Comparator>
+concept SimdSearchable = requires { simd_detail::Lanes<Key>::kWidth; } &&
+  (simd_detail::kAscending<Comparator, Key> || simd_detail::kDescending<Comparator, Key>);
+
+// number of keys ordered before probe, the lower bound of probe in a sorted block
+template <typename Comparator, typename Key> requires SimdSearchable<Key, Comparator>
+std::uint32_t SimdLowerBound(const Key* keys, std::uint32_t count, Key probe) {
+  using Lanes = simd_detail::Lanes<Key>;
+  auto broadcast = Lanes::Broadcast(probe);
+
+  // no early exit, a full count costs less than a mispredicted branch on blocks this small
+  std::uint32_t result = 0;
+  std::uint32_t i = 0;
+  for (; i + Lanes::kWidth <= count; i += Lanes::kWidth) {
+    auto block = Lanes::Load(keys + i);
+    if constexpr (simd_detail::kAscending<Comparator, Key>) {
+      result += std::popcount(Lanes::Less(block, broadcast));
+    } else {
+      result += std::popcount(Lanes::Less(broadcast, block));
+    }
+  }
+
+  for (; i < count; ++i) {
+    result += Comparator{}(keys[i], probe) ? 1 : 0;
+  }
+
+  return result;
+}
+
+// number of keys not ordered after probe, the upper bound of probe in a sorted block
+template <typename Comparator, typename Key> requires SimdSearchable<Key, Comparator>
+std::uint32_t SimdUpperBound(const Key* keys, std::uint32_t count, Key probe) {
+  using Lanes = simd_detail::Lanes<Key>;
+  auto broadcast = Lanes::Broadcast(probe);
+
+  std::uint32_t after = 0;
+  std::uint32_t i = 0;
+  for (; i + Lanes::kWidth <= count; i += Lanes::kWidth) {
+    auto block = Lanes::Load(keys + i);
+    if constexpr (simd_detail::kAscending<Comparator, Key>) {
+      after += std::popcount(Lanes::Less(broadcast, block));
+    } else {
+      after += std::popcount(Lanes::Less(block, broadcast));
+    }
+  }
+
+  for (; i < count; ++i) {
+    after += Comparator{}(probe, keys[i]) ? 1 : 0;
+  }
+
+  return count - after;
+}
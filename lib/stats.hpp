@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include <lib/balancing.hpp>
+#include <lib/node.hpp>
+#include <lib/traversals.hpp>
+
+/* Instrumented mode: the set counts its comparisons, descents, node allocations and
+ * frees and the rotations of its balancing hooks, and Successor counts the links it walks. Enabled by wrapping a balancing
+ * policy in Instrumented, other sets keep an empty NoStats whose hooks compile to nothing.
+ * Iterators don't know their set, so the Successor counts are kept per thread instead,
+ * in SuccessorCounters, and aren't part of the stats of any one set */
+
+// snapshot returned by Set::stats, plain data for a metrics pipeline
+struct SetStats {
+  std::uint64_t size = 0;
+  std::uint64_t searches = 0; // descents from the root or from a hint
+  std::uint64_t comparisons = 0;
+  std::uint64_t allocations = 0;
+  std::uint64_t frees = 0;
+  std::uint64_t rotations = 0;
+  std::uint64_t rebalances = 0; // inserts and erases which rotated at least once
+
+  // shape of the tree when the snapshot was taken, the root is at depth 0
+  std::uint64_t height = 0; // levels, the deepest node is at height - 1
+  double average_depth = 0;
+};
+
+// node updates made by rotations of instrumented sets on the calling thread,
+// a set takes the difference around its balancing hook
+struct RotationUpdates {
+  static std::uint64_t& ThisThread() {
+    thread_local std::uint64_t updates = 0;
+    return updates;
+  }
+};
+
+struct NoStats {
+  void OnSearch(std::size_t = 1) {}
+  void OnCompare() {}
+  void OnAllocate() {}
+  void OnFree(std::size_t = 1) {}
+  void BeforeRebalance() {}
+  void AfterRebalance() {}
+};
+
+struct CountingStats {
+  void OnSearch(std::size_t count = 1) {
+    searches += count;
+  }
+
+  void OnCompare() {
+    ++comparisons;
+  }
+
+  void OnAllocate() {
+    ++allocations;
+  }
+
+  void OnFree(std::size_t count = 1) {
+    frees += count;
+  }
+
+  // the balancing hook runs in between on this thread, every rotation updates two nodes
+  void BeforeRebalance() {
+    updates_before_ = RotationUpdates::ThisThread();
+  }
+
+  void AfterRebalance() {
+    auto made = (RotationUpdates::ThisThread() - updates_before_) / 2;
+    rotations += made;
+    rebalances += made != 0;
+  }
+
+  std::uint64_t searches = 0;
+  std::uint64_t comparisons = 0;
+  std::uint64_t allocations = 0;
+  std::uint64_t frees = 0;
+  std::uint64_t rotations = 0;
+  std::uint64_t rebalances = 0;
+
+private:
+  std::uint64_t updates_before_ = 0;
+};
+
+// Successor walks over every instrumented set stepped on the calling thread,
+// Set::reset_stats leaves them alone
+struct SuccessorCounters {
+  static SuccessorCounters& ThisThread() {
+    thread_local SuccessorCounters counters;
+    return counters;
+  }
+
+  static void ResetThisThread() {
+    ThisThread() = SuccessorCounters();
+  }
+
+  std::uint64_t calls = 0;
+  std::uint64_t links = 0;
+  std::uint64_t max_links = 0;
+};
+
+// counters are declared by the policy, plain policies have none
+template <typename Balancing>
+struct StatsOf {
+  using type = NoStats;
+};
+
+template <typename Balancing> requires requires { typename Balancing::stats; }
+struct StatsOf<Balancing> {
+  using type = typename Balancing::stats;
+};
+
+// inorder traversal Base whose Successor counts the links it follows
+template <typename T, typename Base>
+struct CountingInOrder : Base {
+  static Node<T>* Successor(Node<T>* node) {
+    auto* next = Base::Successor(node);
+
+    // threaded traversals take a single link, the others descend into the right subtree
+    // or climb out of the left one, both are measured along the parents
+    std::uint64_t links = 1;
+    if constexpr (!requires { Base::Threads(node); }) {
+      auto* from = node->right != nullptr ? next : node;
+      auto* to = node->right != nullptr ? node : next;
+      for (links = 0; from != to && from != nullptr; from = from->parent) {
+        ++links;
+      }
+    }
+
+    auto& counters = SuccessorCounters::ThisThread();
+    ++counters.calls;
+    counters.links += links;
+    counters.max_links = std::max(counters.max_links, links);
+    return next;
+  }
+};
+
+// augmentation Base with the counting inorder traversal, everything else is kept
+template <typename Base>
+struct CountingAugment : Base {
+  template <typename T>
+  using inorder = CountingInOrder<T, typename Base::template inorder<T>>;
+};
+
+// augmentation Base handed to the rotations of an instrumented set, counts their updates
+template <typename Base>
+struct CountingRotations : Base {
+  template <typename T>
+  static void Update(Node<T>* node) {
+    ++RotationUpdates::ThisThread();
+    Base::Update(node);
+  }
+};
+
+// balancing policy Base whose sets keep CountingStats, must be the outermost wrapper
+template <typename Base = RedBlack>
+struct Instrumented : Base {
+  using augment = CountingAugment<typename AugmentOf<Base>::type>;
+  using stats = CountingStats;
+
+  template <typename Augment = typename AugmentOf<Base>::type, typename T>
+  static void OnInsert(Node<T>* node, Node<T>* header) {
+    Base::template OnInsert<CountingRotations<Augment>>(node, header);
+  }
+
+  template <typename Augment = typename AugmentOf<Base>::type, typename T>
+  static void OnErase(Node<T>* removed, Node<T>* child, Node<T>* parent, bool was_left, Node<T>* header) {
+    Base::template OnErase<CountingRotations<Augment>>(removed, child, parent, was_left, header);
+  }
+};
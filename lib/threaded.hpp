@@ -0,0 +1,130 @@
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include <lib/balancing.hpp>
+#include <lib/node.hpp>
+#include <lib/traversals.hpp>
+
+/* Threaded mode: every node links to its inorder neighbours, so stepping an iterator
+ * is a single load instead of a climb through the parents, and a scan reads every node once.
+ * The "end" node closes the list, its next is the smallest node and its prev the largest.
+ * Enabled by wrapping a balancing policy in Threaded, costs two pointers per node */
+
+template <typename Key>
+struct ThreadedNode : Node<Key> {
+  using Node<Key>::Node;
+
+  // a lone node is a list of itself, so is the "end" node of an empty tree
+  Node<Key>* next = this;
+  Node<Key>* prev = this;
+};
+
+template <typename T>
+struct ThreadedInOrder : InOrder<T> {
+  static ThreadedNode<T>* Threads(Node<T>* node) {
+    return static_cast<ThreadedNode<T>*>(node);
+  }
+
+  static Node<T>* Successor(Node<T>* node) {
+    return Threads(node)->next;
+  }
+
+  static Node<T>* Predecessor(Node<T>* node) {
+    return Threads(node)->prev;
+  }
+
+  // node goes between prev and next
+  static void Link(Node<T>* node, Node<T>* prev, Node<T>* next) {
+    Threads(node)->prev = prev;
+    Threads(node)->next = next;
+    Threads(prev)->next = node;
+    Threads(next)->prev = node;
+  }
+
+  static void Unlink(Node<T>* node) {
+    Threads(Threads(node)->prev)->next = Threads(node)->next;
+    Threads(Threads(node)->next)->prev = Threads(node)->prev;
+    Threads(node)->prev = node;
+    Threads(node)->next = node;
+  }
+};
+
+struct InOrderThreads {
+  template <typename T>
+  using node = ThreadedNode<T>;
+
+  template <typename T>
+  using inorder = ThreadedInOrder<T>;
+
+  // threads don't describe subtrees, rotations and copies leave nothing to update
+  template <typename T>
+  static void Update(Node<T>*) {}
+
+  template <typename T>
+  static void Copy(Node<T>*, const Node<T>*) {}
+
+  // the tree was built or copied as a whole, threads are laid along it from scratch
+  template <typename T>
+  static void Relink(Node<T>* header) {
+    auto* prev = header;
+    for (auto* node = InOrder<T>::GetInitial(header); node != header; node = InOrder<T>::Successor(node)) {
+      ThreadedInOrder<T>::Threads(prev)->next = node;
+      ThreadedInOrder<T>::Threads(node)->prev = prev;
+      prev = node;
+    }
+
+    ThreadedInOrder<T>::Threads(prev)->next = header;
+    ThreadedInOrder<T>::Threads(header)->prev = prev;
+  }
+
+  // two sets exchanged their trees, each "end" node takes over the list of the other one
+  template <typename T>
+  static void SwapHeaders(Node<T>* a, Node<T>* b) {
+    auto* first = ThreadedInOrder<T>::Threads(a);
+    auto* second = ThreadedInOrder<T>::Threads(b);
+    std::swap(first->next, second->next);
+    std::swap(first->prev, second->prev);
+
+    for (auto [header, other] : {std::pair{first, second}, std::pair{second, first}}) {
+      if (header->next == other) {
+        // the list was empty, it consisted of the other "end" node alone
+        header->next = header;
+        header->prev = header;
+      } else {
+        ThreadedInOrder<T>::Threads(header->next)->prev = header;
+        ThreadedInOrder<T>::Threads(header->prev)->next = header;
+      }
+    }
+  }
+};
+
+// balancing policy Base which additionally keeps the inorder threads up to date
+template <typename Base = RedBlack>
+struct Threaded : Base {
+  static_assert(std::is_same_v<typename AugmentOf<Base>::type, NoAugment>, "Threaded takes a plain balancing policy");
+
+  using augment = InOrderThreads;
+
+  // rotations leave the threads as they are, Augment is handed to Base
+  template <typename Augment = NoAugment, typename T>
+  static void OnInsert(Node<T>* node, Node<T>* header) {
+    // a new node sits right before its parent if it's the left child, right after it otherwise
+    auto* parent = node->parent;
+
+    if (parent->left == node) {
+      ThreadedInOrder<T>::Link(node, ThreadedInOrder<T>::Predecessor(parent), parent);
+    } else {
+      ThreadedInOrder<T>::Link(node, parent, ThreadedInOrder<T>::Successor(parent));
+    }
+
+    Base::template OnInsert<Augment>(node, header);
+  }
+
+  template <typename Augment = NoAugment, typename T>
+  static void OnErase(Node<T>* removed, Node<T>* child, Node<T>* parent, bool was_left, Node<T>* header) {
+    ThreadedInOrder<T>::Unlink(removed);
+    Base::template OnErase<Augment>(removed, child, parent, was_left, header);
+  }
+};
@@ -2,6 +2,8 @@
 
 #include <lib/node.hpp>
 #include <cassert>
+#include <concepts>
+#include <cstddef>
 
 template<typename T>
 struct PreOrder {
@@ -231,3 +233,10 @@ struct PostOrder {
   };
 };
 
+
+// traversals which know positions of nodes, so iterators can jump in O(height)
+template <typename Traversal, typename T>
+concept RankedTraversal = requires(Node<T>* node, std::ptrdiff_t n) {
+  { Traversal::Rank(node) } -> std::same_as<std::ptrdiff_t>;
+  { Traversal::Advance(node, n) } -> std::same_as<Node<T>*>;
+};
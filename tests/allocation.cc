@@ -0,0 +1,330 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <iterator>
+#include <lib/pool_allocator.hpp>
+#include <lib/set.hpp>
+#include <string>
+#include <tests/counting_allocator.hpp>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+static_assert(std::is_nothrow_move_constructible_v<Set<int>>);
+static_assert(std::is_nothrow_move_assignable_v<Set<int>>);
+static_assert(std::is_nothrow_swappable_v<Set<int>>);
+
+TEST(AllocationTest, DuplicateInsertionDoesNotAllocate) {
+  Set<int, std::less<int>, CountingAllocator<int>> set;
+
+  for (int i = 0; i < 100; ++i) {
+    set.insert(i);
+  }
+
+  AllocationCounter::Reset();
+  for (int i = 0; i < 100; ++i) {
+    int key = i;
+    auto [success, it] = set.insert(key);
+    ASSERT_FALSE(success);
+    ASSERT_EQ(*it, i);
+
+    ASSERT_FALSE(set.emplace(i).first);
+    ASSERT_FALSE(set.try_emplace(i).first);
+  }
+
+  ASSERT_EQ(AllocationCounter::allocations, 0u);
+  ASSERT_EQ(AllocationCounter::deallocations, 0u);
+}
+
+TEST(AllocationTest, EmplaceFromKeyArguments) {
+  Set<std::string, std::less<std::string>, CountingAllocator<std::string>> set;
+
+  set.emplace("aaaa", 3u);
+  AllocationCounter::Reset();
+
+  auto [success, it] = set.emplace("aaaa", 3u);
+  ASSERT_FALSE(success);
+  ASSERT_EQ(*it, "aaa");
+  ASSERT_EQ(AllocationCounter::allocations, 0u);
+
+  ASSERT_TRUE(set.emplace("bbb").first);
+  ASSERT_EQ(AllocationCounter::allocations, 1u);
+  ASSERT_EQ(set.size(), 2u);
+}
+
+TEST(AllocationTest, TryEmplaceConstructsOnlyOnSuccess) {
+  Set<std::string, std::less<std::string>, CountingAllocator<std::string>> set;
+  std::string key = "ccc";
+
+  AllocationCounter::Reset();
+  auto [success, it] = set.try_emplace(key, "cccc", 3u);
+  ASSERT_TRUE(success);
+  ASSERT_EQ(*it, key);
+  ASSERT_EQ(AllocationCounter::allocations, 1u);
+
+  ASSERT_FALSE(set.try_emplace(key, "cccc", 3u).first);
+  ASSERT_EQ(AllocationCounter::allocations, 1u);
+}
+
+TEST(PoolAllocatorTest, NodesComeFromContiguousChunk) {
+  Set<int, std::less<int>, PoolAllocator<int>> set;
+
+  for (int i = 0; i < 10; ++i) {
+    set.insert(i);
+  }
+
+  // the "end" node lives in the set itself, so the first key takes the first slot
+  // and ascending keys fill the chunk in order
+  auto it = set.begin();
+  auto* first = it.node_ptr();
+  for (int i = 0; i < 10; ++i, ++it) {
+    ASSERT_EQ(it.node_ptr(), first + i);
+  }
+}
+
+TEST(PoolAllocatorTest, ErasedNodesAreReused) {
+  Set<int, std::less<int>, PoolAllocator<int>> set;
+
+  for (int i = 0; i < 10; ++i) {
+    set.insert(i);
+  }
+
+  auto* erased = set.find(9).node_ptr();
+  set.erase(9);
+
+  auto [success, it] = set.insert(100);
+  ASSERT_TRUE(success);
+  ASSERT_EQ(it.node_ptr(), erased);
+}
+
+TEST(PoolAllocatorTest, ClearAndReuse) {
+  Set<int, std::less<int>, PoolAllocator<int, 16>> set;
+
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 100; ++i) {
+      set.insert(i * round);
+    }
+
+    set.clear();
+    ASSERT_TRUE(set.empty());
+    ASSERT_EQ(set.begin(), set.end());
+  }
+
+  set.insert(1);
+  ASSERT_EQ(*set.begin(), 1);
+}
+
+TEST(PoolAllocatorTest, NonTrivialKeys) {
+  Set<std::string, std::less<std::string>, PoolAllocator<std::string, 4>> set;
+
+  for (int i = 0; i < 100; ++i) {
+    set.insert(std::string(32, static_cast<char>('a' + i % 26)) + std::to_string(i));
+  }
+
+  for (int i = 0; i < 100; i += 2) {
+    set.erase(std::string(32, static_cast<char>('a' + i % 26)) + std::to_string(i));
+  }
+
+  ASSERT_EQ(set.size(), 50u);
+  set.clear();
+  ASSERT_TRUE(set.empty());
+}
+
+TEST(PoolAllocatorTest, MoveKeepsNodesAlive) {
+  Set<int, std::less<int>, PoolAllocator<int>> set;
+  for (int i = 0; i < 100; ++i) {
+    set.insert(i);
+  }
+
+  auto moved = std::move(set);
+  Set<int, std::less<int>, PoolAllocator<int>> assigned;
+  assigned.insert(-1);
+  assigned = std::move(moved);
+
+  int expected = 0;
+  for (int i : assigned) {
+    ASSERT_EQ(i, expected++);
+  }
+  ASSERT_EQ(expected, 100);
+
+  // moved got the old nodes of assigned, they're freed with it
+  set.insert(5);
+  moved.insert(6);
+  ASSERT_EQ(*set.begin(), 5);
+  ASSERT_TRUE(std::ranges::equal(moved, std::vector<int>{-1, 6}));
+}
+
+TEST(AllocationTest, CopyAssignmentReusesNodes) {
+  using CountingSet = Set<std::string, std::less<std::string>, CountingAllocator<std::string>>;
+  CountingSet source;
+  CountingSet destination;
+
+  for (int i = 0; i < 100; ++i) {
+    source.insert(std::to_string(i));
+    destination.insert(std::to_string(-i));
+  }
+
+  AllocationCounter::Reset();
+  destination = source;
+  ASSERT_EQ(AllocationCounter::allocations, 0u);
+  ASSERT_EQ(AllocationCounter::deallocations, 0u);
+
+  source.insert("extra");
+  AllocationCounter::Reset();
+  destination = source;
+  ASSERT_EQ(AllocationCounter::allocations, 1u);
+  ASSERT_EQ(destination.size(), 101u);
+}
+
+TEST(AllocationTest, EmptySetDoesNotAllocate) {
+  AllocationCounter::Reset();
+  {
+    Set<std::string, std::less<std::string>, CountingAllocator<std::string>> set;
+    ASSERT_TRUE(set.empty());
+    ASSERT_EQ(set.begin(), set.end());
+    set.clear();
+  }
+
+  ASSERT_EQ(AllocationCounter::allocations, 0u);
+  ASSERT_EQ(AllocationCounter::deallocations, 0u);
+}
+
+TEST(AllocationTest, MovesAndSwapsDoNotAllocate) {
+  using CountingSet = Set<std::string, std::less<std::string>, CountingAllocator<std::string>>;
+  CountingSet first = {"a", "b", "c"};
+  CountingSet second = {"x"};
+
+  AllocationCounter::Reset();
+
+  CountingSet moved = std::move(first);
+  first.swap(moved);
+  std::swap(first, second);
+  moved = std::move(second);
+
+  ASSERT_EQ(AllocationCounter::allocations, 0u);
+  ASSERT_EQ(AllocationCounter::deallocations, 0u);
+  ASSERT_TRUE(std::ranges::equal(first, std::vector<std::string>{"x"}));
+  ASSERT_TRUE(std::ranges::equal(moved, std::vector<std::string>{"a", "b", "c"}));
+  ASSERT_TRUE(second.empty());
+
+  // moved-from sets are empty and usable
+  second.insert("y");
+  ASSERT_EQ(*second.begin(), "y");
+  ASSERT_EQ(*std::prev(moved.end()), "c");
+}
+
+namespace {
+
+// every default constructed allocator is a separate arena, nodes can't move between them
+template <typename T>
+struct ArenaAllocator : std::allocator<T> {
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::false_type;
+  using is_always_equal = std::false_type;
+
+  template <typename U>
+  struct rebind {
+    using other = ArenaAllocator<U>;
+  };
+
+  static inline int next_arena = 0;
+
+  ArenaAllocator() : arena{next_arena++} {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena{other.arena} {}
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena == other.arena;
+  }
+
+  int arena;
+};
+
+// order is picked when the comparator is constructed
+struct FlippableLess {
+  static inline bool next_descending = false;
+
+  bool operator()(int lhs, int rhs) const {
+    return descending ? rhs < lhs : lhs < rhs;
+  }
+
+  bool descending = next_descending;
+};
+
+} // namespace
+
+static_assert(!std::is_nothrow_move_assignable_v<Set<int, std::less<int>, ArenaAllocator<int>>>);
+
+TEST(AllocationTest, MoveAssignmentHandsOldNodesOver) {
+  using CountingSet = Set<std::string, std::less<std::string>, CountingAllocator<std::string>>;
+  CountingSet destination = {"p", "q"};
+  CountingSet source = {"a"};
+
+  AllocationCounter::Reset();
+  destination = std::move(source);
+
+  // nothing is freed eagerly, the old keys leave with source
+  ASSERT_EQ(AllocationCounter::allocations, 0u);
+  ASSERT_EQ(AllocationCounter::deallocations, 0u);
+  ASSERT_TRUE(std::ranges::equal(destination, std::vector<std::string>{"a"}));
+
+  source.clear();
+  ASSERT_EQ(AllocationCounter::deallocations, 2u);
+}
+
+TEST(AllocationTest, MoveAssignmentBetweenArenas) {
+  using ArenaSet = Set<std::string, std::less<std::string>, ArenaAllocator<std::string>>;
+  ArenaSet destination = {"p", "q"};
+  ArenaSet source = {"a", "b", "c"};
+
+  // nodes can't change arenas, the keys are moved into new ones
+  destination = std::move(source);
+  ASSERT_TRUE(std::ranges::equal(destination, std::vector<std::string>{"a", "b", "c"}));
+  ASSERT_TRUE(source.empty());
+
+  source.insert("d");
+  destination = std::move(source);
+  ASSERT_TRUE(std::ranges::equal(destination, std::vector<std::string>{"d"}));
+}
+
+TEST(AllocationTest, MovesKeepTheComparator) {
+  using FlippableSet = Set<int, FlippableLess>;
+  FlippableLess::next_descending = true;
+  FlippableSet descending = {1, 2, 3};
+  FlippableLess::next_descending = false;
+
+  FlippableSet moved = std::move(descending);
+  moved.insert(4);
+  ASSERT_TRUE(std::ranges::equal(moved, std::vector<int>{4, 3, 2, 1}));
+
+  FlippableSet assigned = {7, 8};
+  assigned = std::move(moved);
+  assigned.insert(0);
+  ASSERT_TRUE(std::ranges::equal(assigned, std::vector<int>{4, 3, 2, 1, 0}));
+
+  // the old comparator went to moved with the old keys
+  moved.insert(9);
+  ASSERT_TRUE(std::ranges::equal(moved, std::vector<int>{7, 8, 9}));
+}
+
+TEST(AllocationTest, VectorOfSetsRelocatesWithoutAllocating) {
+  using CountingSet = Set<int, std::less<int>, CountingAllocator<int>>;
+  std::vector<CountingSet> sets;
+  sets.reserve(1);
+
+  AllocationCounter::Reset();
+  for (int i = 0; i < 100; ++i) {
+    sets.emplace_back();
+    sets.back().insert(i);
+  }
+
+  // one node per set, everything else is the vector reallocating
+  ASSERT_EQ(AllocationCounter::allocations, 100u);
+
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(sets[i].size(), 1u);
+    ASSERT_EQ(*sets[i].begin(), i);
+    ASSERT_EQ(std::next(sets[i].begin()), sets[i].end());
+  }
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <experimental/random>
+#include <iterator>
+#include <lib/set.hpp>
+#include <tests/tree_invariants.hpp>
+#include <vector>
+
+TEST(RedBlackTest, SortedInsertion) {
+  BalancedSet<RedBlack> set;
+
+  constexpr int nodes_count = 1 << 16;
+  for (int i = 0; i < nodes_count; ++i) {
+    set.insert(i);
+  }
+
+  // black height of a red-black tree is at least half of its height
+  int black_height = CheckRedBlack(GetRoot(set));
+  ASSERT_LE(black_height, 17);
+  ASSERT_EQ(set.size(), static_cast<size_t>(nodes_count));
+
+  int expected = 0;
+  for (int i : set) {
+    ASSERT_EQ(i, expected++);
+  }
+}
+
+template <typename Policy, typename Checker>
+void RandomInsertionAndDeletion(Checker check) {
+  BalancedSet<Policy> set;
+  std::vector<int> input_data;
+
+  constexpr int nodes_count = 2000;
+  for (int i = 0; i < nodes_count; ++i) {
+    int num = std::experimental::randint(-1000, 1000);
+    input_data.push_back(num);
+    set.emplace(num);
+  }
+  check(GetRoot(set));
+
+  std::vector<int> erased;
+  for (int i = 0; i < nodes_count; i += 2) {
+    set.erase(input_data[i]);
+    erased.push_back(input_data[i]);
+    check(GetRoot(set));
+  }
+
+  std::ranges::sort(input_data);
+  std::ranges::sort(erased);
+  input_data.erase(std::unique(input_data.begin(), input_data.end()), input_data.end());
+  erased.erase(std::unique(erased.begin(), erased.end()), erased.end());
+
+  std::vector<int> expected;
+  std::ranges::set_difference(input_data, erased, std::back_inserter(expected));
+
+  std::vector<int> result;
+  for (int i : set) {
+    result.push_back(i);
+  }
+
+  ASSERT_EQ(result, expected);
+  ASSERT_EQ(set.size(), expected.size());
+}
+
+TEST(RedBlackTest, RandomInsertionAndDeletion) {
+  RandomInsertionAndDeletion<RedBlack>(CheckRedBlack<int>);
+}
+
+TEST(AvlTest, SortedInsertion) {
+  BalancedSet<Avl> set;
+
+  constexpr int nodes_count = 1 << 16;
+  for (int i = nodes_count; i > 0; --i) {
+    set.insert(i);
+  }
+
+  // perfectly balanced avl tree over 2^16 keys has height of 17, worst case is ~1.44 * log2(n)
+  ASSERT_LE(CheckAvl(GetRoot(set)), 23);
+  ASSERT_EQ(set.size(), static_cast<size_t>(nodes_count));
+}
+
+TEST(AvlTest, RandomInsertionAndDeletion) {
+  RandomInsertionAndDeletion<Avl>(CheckAvl<int>);
+}
+
+TEST(RedBlackTest, TraversalsVisitEveryNode) {
+  BalancedSet<RedBlack> set;
+  using preorder = BalancedSet<RedBlack>::preorder;
+  using postorder = BalancedSet<RedBlack>::postorder;
+
+  constexpr int nodes_count = 100;
+  for (int i = 0; i < nodes_count; ++i) {
+    set.insert(i);
+  }
+
+  std::vector<int> forward;
+  for (auto it = set.begin<preorder>(); it != set.end<preorder>(); ++it) {
+    forward.push_back(*it);
+  }
+
+  std::vector<int> backward;
+  for (auto it = set.rbegin<preorder>(); it != set.rend<preorder>(); ++it) {
+    backward.push_back(*it);
+  }
+  std::ranges::reverse(backward);
+  ASSERT_EQ(forward, backward);
+  ASSERT_EQ(forward.size(), static_cast<size_t>(nodes_count));
+  ASSERT_EQ(forward.front(), GetRoot(set)->key);
+
+  int count = 0;
+  for (auto it = set.begin<postorder>(); it != set.end<postorder>(); ++it) {
+    ++count;
+  }
+  ASSERT_EQ(count, nodes_count);
+}
@@ -1,7 +1,9 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <experimental/random>
 #include <lib/set.hpp>
 #include <ranges>
+#include <vector>
 
 TEST(InsertionTest, BasicProcedures) {
   Set<int> tree;
@@ -68,3 +70,159 @@ TEST(KeyDeletionTest, BasicProcedures) {
     }
   }
 }
+
+TEST(CopyTest, BasicProcedures) {
+  Set<int> set;
+  for (int i = 0; i < 500; ++i) {
+    set.emplace(std::experimental::randint(-1000, 1000));
+  }
+
+  Set<int> copy = set;
+  Set<int> assigned;
+  assigned.insert(5000);
+  assigned = set;
+
+  using preorder = Set<int>::preorder;
+  for (auto* other : {&copy, &assigned}) {
+    ASSERT_EQ(other->size(), set.size());
+
+    // same shape, not only the same keys
+    auto it = other->begin<preorder>();
+    for (auto expected = set.begin<preorder>(); expected != set.end<preorder>(); ++expected, ++it) {
+      ASSERT_EQ(*it, *expected);
+    }
+    ASSERT_EQ(it, other->end<preorder>());
+  }
+
+  copy.erase(*set.begin());
+  ASSERT_EQ(copy.size() + 1, set.size());
+  ASSERT_EQ(assigned.size(), set.size());
+}
+
+namespace {
+
+// key that can't be assigned, so erasure can't copy keys around
+struct FixedKey {
+  static inline int copies = 0;
+
+  FixedKey(int v = 0) : value{v} {}
+  FixedKey(const FixedKey& other) : value{other.value} { ++copies; }
+  FixedKey& operator=(const FixedKey&) = delete;
+
+  bool operator<(const FixedKey& other) const { return value < other.value; }
+
+  int value;
+};
+
+} // namespace
+
+TEST(EraseStabilityTest, BasicProcedures) {
+  Set<FixedKey> set;
+  for (int i = 0; i < 1000; ++i) {
+    set.emplace(std::experimental::randint(0, 500));
+  }
+
+  FixedKey::copies = 0;
+  while (!set.empty()) {
+    // keys with two children included, iterators to the remaining keys must survive
+    auto victim = set.find(FixedKey{std::experimental::randint(0, 500)});
+    if (victim == set.end()) continue;
+
+    auto next = std::next(victim);
+    const FixedKey* next_address = next == set.end() ? nullptr : &*next;
+
+    auto after = set.erase(victim);
+    ASSERT_EQ(after, next);
+    if (next_address != nullptr) {
+      ASSERT_EQ(&*after, next_address);
+    }
+  }
+
+  ASSERT_EQ(FixedKey::copies, 0);
+}
+
+namespace {
+
+// cached ends must match the ones found by walking down the tree
+template <typename SetType>
+void ExpectCachedEnds(SetType& set) {
+  auto* end = set.end().node_ptr();
+  ASSERT_EQ(set.begin(), typename SetType::iterator(InOrder<int>::GetInitial(end)));
+
+  if (set.empty()) {
+    ASSERT_EQ(set.begin(), set.end());
+    ASSERT_TRUE(set.rbegin() == set.rend());
+    return;
+  }
+
+  auto* rightmost = InOrder<int>::Predecessor(end);
+  ASSERT_EQ(&*set.rbegin(), &rightmost->key);
+  ASSERT_EQ(set.min(), *set.begin());
+  ASSERT_EQ(set.max(), rightmost->key);
+}
+
+} // namespace
+
+TEST(CachedEndsTest, BasicProcedures) {
+  Set<int> set;
+  ExpectCachedEnds(set);
+
+  for (int i = 0; i < 3000; ++i) {
+    auto key = std::experimental::randint(0, 500);
+
+    switch (std::experimental::randint(0, 5)) {
+      case 0:
+        set.erase(key);
+        break;
+      case 1:
+        if (!set.empty()) {
+          set.pop_front();
+        }
+        break;
+      case 2:
+        set.insert(set.begin(), key);
+        break;
+      case 3: {
+        auto node = set.extract(key);
+        if (!node.empty()) {
+          set.insert(std::move(node));
+        }
+        break;
+      }
+      case 4:
+        set.insert({key, key + 1, key - 1, key + 2, key - 2});
+        break;
+      default:
+        set.emplace(key);
+    }
+
+    ExpectCachedEnds(set);
+  }
+
+  Set<int> copy = set;
+  ExpectCachedEnds(copy);
+
+  Set<int> moved = std::move(copy);
+  ExpectCachedEnds(moved);
+  ExpectCachedEnds(copy);
+
+  set.clear();
+  ExpectCachedEnds(set);
+}
+
+TEST(PopFrontTest, BasicProcedures) {
+  Set<int> set;
+  for (int i = 0; i < 1000; ++i) {
+    set.emplace(std::experimental::randint(-1000, 1000));
+  }
+
+  // priority queue pattern, the smallest key is taken every time
+  std::vector<int> popped;
+  while (!set.empty()) {
+    popped.push_back(set.min());
+    set.pop_front();
+    ASSERT_TRUE(set.empty() || set.min() > popped.back());
+  }
+
+  ASSERT_TRUE(std::ranges::is_sorted(popped));
+}
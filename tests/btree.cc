@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdint>
+#include <experimental/random>
+#include <iterator>
+#include <lib/set.hpp>
+#include <ranges>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tests/counting_allocator.hpp>
+#include <vector>
+
+// the smallest nodes give deep trees, so every split, borrow and merge runs often
+using NarrowSet = Set<int64_t, std::less<int64_t>, std::allocator<int64_t>, BTree<64>>;
+using WideSet = Set<int64_t, std::less<int64_t>, std::allocator<int64_t>, BTree<>>;
+
+static_assert(std::bidirectional_iterator<WideSet::iterator>);
+static_assert(std::ranges::bidirectional_range<WideSet>);
+
+// nodes are as wide as promised
+static_assert(sizeof(WideSet::leaf_type) == 256);
+static_assert(sizeof(WideSet::inner_type) <= 256);
+
+template <typename Set>
+class BTreeTest : public testing::Test {};
+
+using BTreeTypes = testing::Types<NarrowSet, WideSet>;
+TYPED_TEST_SUITE(BTreeTest, BTreeTypes);
+
+namespace {
+
+template <typename Set>
+std::vector<int64_t> Keys(const Set& set) {
+  return std::vector<int64_t>(set.begin(), set.end());
+}
+
+// copies throw while armed, moves never do
+struct FragileKey {
+  static inline bool armed = false;
+
+  FragileKey(int value) : value{value} {}
+  FragileKey(FragileKey&&) noexcept = default;
+  FragileKey& operator=(FragileKey&&) noexcept = default;
+
+  FragileKey(const FragileKey& other) : value{other.value} {
+    if (armed) {
+      throw std::runtime_error("copy of a fragile key");
+    }
+  }
+
+  FragileKey& operator=(const FragileKey& other) {
+    if (armed) {
+      throw std::runtime_error("copy of a fragile key");
+    }
+
+    value = other.value;
+    return *this;
+  }
+
+  bool operator<(const FragileKey& other) const {
+    return value < other.value;
+  }
+
+  int value;
+};
+
+} // namespace
+
+TYPED_TEST(BTreeTest, RandomOperations) {
+  TypeParam set;
+  std::set<int64_t> expected;
+
+  for (int i = 0; i < 50000; ++i) {
+    int64_t key = std::experimental::randint(0, 3000);
+
+    if (std::experimental::randint(0, 2) == 0) {
+      ASSERT_EQ(set.erase(key), expected.erase(key));
+    } else {
+      auto [inserted, it] = set.insert(key);
+      ASSERT_EQ(inserted, expected.insert(key).second);
+      ASSERT_EQ(*it, key);
+    }
+
+    ASSERT_EQ(set.size(), expected.size());
+    if (i % 2500 == 0) {
+      ASSERT_EQ(Keys(set), std::vector<int64_t>(expected.begin(), expected.end()));
+    }
+  }
+
+  ASSERT_EQ(Keys(set), std::vector<int64_t>(expected.begin(), expected.end()));
+  ASSERT_EQ(std::vector<int64_t>(set.rbegin(), set.rend()), std::vector<int64_t>(expected.rbegin(), expected.rend()));
+
+  for (int64_t key = -1; key <= 3001; ++key) {
+    ASSERT_EQ(set.contains(key), expected.contains(key));
+
+    auto lower = set.lower_bound(key);
+    auto upper = set.upper_bound(key);
+    ASSERT_EQ(lower == set.end() ? -1 : *lower, expected.lower_bound(key) == expected.end() ? -1 : *expected.lower_bound(key));
+    ASSERT_EQ(upper == set.end() ? -1 : *upper, expected.upper_bound(key) == expected.end() ? -1 : *expected.upper_bound(key));
+  }
+}
+
+TYPED_TEST(BTreeTest, EraseReturnsNext) {
+  TypeParam set;
+  for (int64_t i = 0; i < 2000; ++i) {
+    set.insert(i);
+  }
+
+  // every other key, the returned iterator has to survive borrowing and merging
+  for (auto it = set.begin(); it != set.end();) {
+    auto key = *it;
+    it = set.erase(it);
+    ASSERT_TRUE(it == set.end() || *it == key + 1);
+
+    if (it != set.end()) {
+      ++it;
+    }
+  }
+
+  ASSERT_EQ(set.size(), 1000u);
+  ASSERT_EQ(*set.begin(), 1);
+
+  // and the rest from the back
+  while (!set.empty()) {
+    ASSERT_EQ(set.erase(std::prev(set.end())), set.end());
+  }
+
+  ASSERT_EQ(set.height(), 0u);
+  ASSERT_EQ(set.begin(), set.end());
+}
+
+TYPED_TEST(BTreeTest, StaysShallow) {
+  TypeParam set;
+  for (int64_t i = 0; i < 100000; ++i) {
+    set.insert(i % 2 == 0 ? i : -i);
+  }
+
+  // every node but the root is at least half full
+  auto fanout = TypeParam::inner_type::kMinCount + 1;
+  auto limit = 2 + static_cast<std::size_t>(std::log(100000.0 / TypeParam::leaf_type::kMinCount) / std::log(fanout));
+  ASSERT_LE(set.height(), limit);
+
+  for (int64_t i = 0; i < 100000; i += 3) {
+    set.erase(i % 2 == 0 ? i : -i);
+  }
+
+  ASSERT_LE(set.height(), limit);
+  ASSERT_TRUE(std::ranges::is_sorted(set));
+}
+
+TEST(BTreeTest, StringsCopyAndMove) {
+  Set<std::string, std::less<>, std::allocator<std::string>, BTree<128>> set;
+  for (int i = 0; i < 1000; ++i) {
+    set.insert("key-" + std::to_string(i));
+  }
+
+  auto copy = set;
+  for (int i = 0; i < 1000; i += 2) {
+    copy.erase("key-" + std::to_string(i));
+  }
+
+  ASSERT_EQ(set.size(), 1000u);
+  ASSERT_EQ(copy.size(), 500u);
+  ASSERT_TRUE(copy.contains(std::string_view("key-1")));
+  ASSERT_FALSE(copy.contains("key-0"));
+  ASSERT_EQ(*set.lower_bound(std::string_view("key-99")), "key-99");
+
+  auto moved = std::move(copy);
+  ASSERT_EQ(moved.size(), 500u);
+  ASSERT_EQ(copy.begin(), copy.end());
+
+  set.swap(moved);
+  ASSERT_EQ(set.size(), 500u);
+  ASSERT_EQ(std::ranges::distance(moved), 1000);
+  ASSERT_EQ(std::ranges::distance(set), 500);
+
+  copy = moved;
+  ASSERT_EQ(*std::prev(copy.end()), "key-999");
+}
+
+TEST(BTreeTest, AllocationsBalance) {
+  AllocationCounter::Reset();
+
+  {
+    Set<int, std::less<int>, CountingAllocator<int>, BTree<64>> set;
+    for (int i = 0; i < 10000; ++i) {
+      set.insert(std::experimental::randint(0, 5000));
+    }
+    for (int i = 0; i < 10000; ++i) {
+      set.erase(std::experimental::randint(0, 5000));
+    }
+  }
+
+  ASSERT_GT(AllocationCounter::allocations, 0u);
+  ASSERT_EQ(AllocationCounter::allocations, AllocationCounter::deallocations);
+}
+
+TEST(BTreeTest, ThrowingSplitKeepsNothing) {
+  AllocationCounter::Reset();
+
+  {
+    Set<FragileKey, std::less<FragileKey>, CountingAllocator<FragileKey>, BTree<64>> set;
+    for (int i = 0; i < 1000; ++i) {
+      set.insert(FragileKey(i));
+    }
+
+    // splits copy a separator up, that's the step which throws here
+    FragileKey::armed = true;
+    std::size_t failures = 0;
+    for (int i = 1000; i < 2000; ++i) {
+      try {
+        set.insert(FragileKey(i));
+      } catch (const std::runtime_error&) {
+        ++failures;
+      }
+    }
+    FragileKey::armed = false;
+
+    ASSERT_GT(failures, 0u);
+    ASSERT_EQ(set.size(), 2000u - failures);
+    ASSERT_TRUE(std::ranges::is_sorted(set, std::less<FragileKey>()));
+  }
+
+  ASSERT_EQ(AllocationCounter::allocations, AllocationCounter::deallocations);
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <experimental/random>
+#include <iterator>
+#include <lib/set.hpp>
+#include <list>
+#include <numeric>
+#include <sstream>
+#include <tests/counting_allocator.hpp>
+#include <tests/tree_invariants.hpp>
+#include <vector>
+
+namespace {
+
+struct CountingLess {
+  static inline size_t comparisons = 0;
+
+  bool operator()(int lhs, int rhs) const {
+    ++comparisons;
+    return lhs < rhs;
+  }
+};
+
+template <typename SetType>
+std::vector<int> Collect(const SetType& set) {
+  return std::vector<int>(set.begin(), set.end());
+}
+
+} // namespace
+
+TEST(BulkTest, SortedRangeBuildsBalancedTree) {
+  for (int count : {0, 1, 2, 3, 7, 8, 100, 1000, 1023, 1024}) {
+    std::vector<int> keys(count);
+    std::iota(keys.begin(), keys.end(), 0);
+
+    BalancedSet<RedBlack> red_black(keys.begin(), keys.end());
+    BalancedSet<Avl> avl(keys.begin(), keys.end());
+
+    ASSERT_EQ(Collect(red_black), keys);
+    ASSERT_EQ(Collect(avl), keys);
+    ASSERT_EQ(red_black.size(), keys.size());
+    CheckRedBlack(GetRoot(red_black));
+
+    // perfectly balanced, so height is the minimal possible one
+    ASSERT_EQ(CheckAvl(GetRoot(avl)), static_cast<int>(std::bit_width(keys.size())));
+  }
+}
+
+TEST(BulkTest, SortedRangeComparesOnlyNeighbours) {
+  std::vector<int> keys(1 << 12);
+  std::iota(keys.begin(), keys.end(), 0);
+
+  CountingLess::comparisons = 0;
+  Set<int, CountingLess> set(keys.begin(), keys.end());
+
+  // one comparison per adjacent pair to make sure the input is sorted, none while building
+  ASSERT_EQ(CountingLess::comparisons, keys.size() - 1);
+  ASSERT_EQ(set.size(), keys.size());
+}
+
+TEST(BulkTest, UnsortedInputWithDuplicates) {
+  std::vector<int> keys;
+  for (int i = 0; i < 5000; ++i) {
+    keys.push_back(std::experimental::randint(-1000, 1000));
+  }
+
+  Set<int> set(keys.begin(), keys.end());
+  CheckRedBlack(GetRoot(set));
+
+  std::ranges::sort(keys);
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  ASSERT_EQ(Collect(set), keys);
+  ASSERT_EQ(set.size(), keys.size());
+}
+
+TEST(BulkTest, InputIterators) {
+  std::istringstream stream("5 3 9 1 3 7");
+  Set<int> set{std::istream_iterator<int>(stream), std::istream_iterator<int>()};
+
+  ASSERT_EQ(Collect(set), (std::vector<int>{1, 3, 5, 7, 9}));
+}
+
+TEST(BulkTest, MergeIntoExistingTree) {
+  BalancedSet<Avl> set{1, 3, 5, 7, 9};
+  std::list<int> more{0, 1, 2, 3, 4, 10, 11, 12, 13, 14, 15};
+
+  set.insert(more.begin(), more.end());
+  CheckAvl(GetRoot(set));
+  ASSERT_EQ(Collect(set), (std::vector<int>{0, 1, 2, 3, 4, 5, 7, 9, 10, 11, 12, 13, 14, 15}));
+  ASSERT_EQ(set.size(), 14u);
+
+  // small batch goes key by key
+  set.insert({6, 8});
+  CheckAvl(GetRoot(set));
+  ASSERT_EQ(set.size(), 16u);
+}
+
+TEST(BulkTest, MergeAllocatesOnlyMissingKeys) {
+  using CountingSet = Set<int, std::less<int>, CountingAllocator<int>>;
+  std::vector<int> keys(1000);
+  std::iota(keys.begin(), keys.end(), 0);
+
+  CountingSet set(keys.begin(), keys.end());
+
+  std::vector<int> overlapping(1000);
+  std::iota(overlapping.begin(), overlapping.end(), 500);
+
+  AllocationCounter::Reset();
+  set.insert(overlapping.begin(), overlapping.end());
+  CheckRedBlack(GetRoot(set));
+  ASSERT_EQ(set.size(), 1500u);
+
+  // duplicates are found before anything is allocated
+  ASSERT_EQ(AllocationCounter::allocations, 500u);
+  ASSERT_EQ(AllocationCounter::deallocations, 0u);
+
+  // same for keys which have to be sorted first
+  std::vector<int> shuffled(overlapping.rbegin(), overlapping.rend());
+  shuffled.push_back(-1);
+  AllocationCounter::Reset();
+  set.insert(shuffled.begin(), shuffled.end());
+  ASSERT_EQ(set.size(), 1501u);
+  ASSERT_EQ(AllocationCounter::allocations, 1u);
+}
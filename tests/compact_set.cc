@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <experimental/random>
+#include <iterator>
+#include <lib/compact_set.hpp>
+#include <lib/node.hpp>
+#include <ranges>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tests/counting_allocator.hpp>
+#include <type_traits>
+#include <vector>
+
+static_assert(std::bidirectional_iterator<CompactSet<int>::iterator>);
+static_assert(std::ranges::bidirectional_range<CompactSet<int>>);
+static_assert(std::is_nothrow_default_constructible_v<CompactSet<int>>);
+
+// the point of it all: three links and the color in 12 bytes, half of a pointer node before malloc overhead
+static_assert(sizeof(CompactNode<int>) == 16);
+static_assert(sizeof(CompactNode<int>) * 2 <= sizeof(Node<int>));
+
+namespace {
+
+// red-black trees are never more than twice as high as the perfectly balanced ones
+template <typename Set>
+void ExpectBalanced(const Set& set) {
+  auto limit = 2 * std::log2(static_cast<double>(set.size()) + 1);
+  ASSERT_LE(static_cast<double>(set.height()), limit) << "size " << set.size();
+}
+
+template <typename Set>
+std::vector<int> Keys(const Set& set) {
+  return std::vector<int>(set.begin(), set.end());
+}
+
+} // namespace
+
+TEST(CompactSetTest, RandomOperations) {
+  CompactSet<int> set;
+  std::set<int> expected;
+
+  for (int i = 0; i < 20000; ++i) {
+    auto key = std::experimental::randint(0, 2000);
+
+    if (std::experimental::randint(0, 2) == 0) {
+      ASSERT_EQ(set.erase(key), expected.erase(key));
+    } else {
+      auto [inserted, it] = set.insert(key);
+      ASSERT_EQ(inserted, expected.insert(key).second);
+      ASSERT_EQ(*it, key);
+    }
+
+    ASSERT_EQ(set.size(), expected.size());
+    if (i % 1000 == 0) {
+      ExpectBalanced(set);
+      ASSERT_EQ(Keys(set), std::vector<int>(expected.begin(), expected.end()));
+    }
+  }
+
+  ExpectBalanced(set);
+  ASSERT_EQ(Keys(set), std::vector<int>(expected.begin(), expected.end()));
+  ASSERT_EQ(std::vector<int>(set.rbegin(), set.rend()), std::vector<int>(expected.rbegin(), expected.rend()));
+
+  for (int key = -1; key <= 2001; ++key) {
+    ASSERT_EQ(set.contains(key), expected.contains(key));
+
+    auto lower = set.lower_bound(key);
+    auto upper = set.upper_bound(key);
+    ASSERT_EQ(lower == set.end() ? -1 : *lower, expected.lower_bound(key) == expected.end() ? -1 : *expected.lower_bound(key));
+    ASSERT_EQ(upper == set.end() ? -1 : *upper, expected.upper_bound(key) == expected.end() ? -1 : *expected.upper_bound(key));
+  }
+}
+
+TEST(CompactSetTest, SortedInsertionStaysBalanced) {
+  CompactSet<int> ascending;
+  CompactSet<int> descending;
+
+  for (int i = 0; i < 100000; ++i) {
+    ascending.insert(i);
+    descending.insert(-i);
+  }
+
+  ExpectBalanced(ascending);
+  ExpectBalanced(descending);
+
+  // erasing every other key leaves all the shapes erase has to fix
+  for (int i = 0; i < 100000; i += 2) {
+    ascending.erase(i);
+  }
+
+  ExpectBalanced(ascending);
+  ASSERT_EQ(ascending.size(), 50000u);
+  ASSERT_EQ(*ascending.begin(), 1);
+}
+
+TEST(CompactSetTest, EraseByIterator) {
+  CompactSet<int> set{5, 1, 4, 2, 3};
+
+  auto it = set.erase(set.find(3));
+  ASSERT_EQ(*it, 4);
+
+  it = set.erase(std::prev(set.end()));
+  ASSERT_EQ(it, set.end());
+
+  ASSERT_EQ(Keys(set), (std::vector<int>{1, 2, 4}));
+}
+
+TEST(CompactSetTest, ReferencesSurviveGrowth) {
+  CompactSet<int> set;
+  const int* first = &*set.insert(42).second;
+
+  // many chunks later the key is still where it was
+  for (int i = 0; i < 10000; ++i) {
+    set.insert(i + 100);
+  }
+
+  ASSERT_EQ(first, &*set.find(42));
+}
+
+TEST(CompactSetTest, ErasedSlotsAreReused) {
+  AllocationCounter::Reset();
+
+  {
+    CompactSet<int, std::less<int>, CountingAllocator<int>> set;
+    for (int i = 0; i < 1000; ++i) {
+      set.insert(i);
+    }
+
+    auto chunks = AllocationCounter::allocations;
+
+    for (int round = 0; round < 10; ++round) {
+      for (int i = 0; i < 1000; ++i) {
+        set.erase(i);
+      }
+      for (int i = 0; i < 1000; ++i) {
+        set.insert(i + round);
+      }
+    }
+
+    set.clear();
+    for (int i = 0; i < 1000; ++i) {
+      set.insert(-i);
+    }
+
+    ASSERT_EQ(AllocationCounter::allocations, chunks);
+  }
+
+  ASSERT_EQ(AllocationCounter::allocations, AllocationCounter::deallocations);
+}
+
+TEST(CompactSetTest, CopyAndMove) {
+  CompactSet<std::string> set{"delta", "alpha", "charlie", "bravo"};
+
+  CompactSet<std::string> copy(set);
+  copy.erase("alpha");
+  ASSERT_EQ(set.size(), 4u);
+  ASSERT_EQ(copy.size(), 3u);
+
+  CompactSet<std::string> moved(std::move(copy));
+  ASSERT_EQ(*moved.begin(), "bravo");
+
+  copy = set;
+  ASSERT_EQ(std::vector<std::string>(copy.begin(), copy.end()), (std::vector<std::string>{"alpha", "bravo", "charlie", "delta"}));
+
+  set = std::move(moved);
+  ASSERT_EQ(set.size(), 3u);
+  ASSERT_FALSE(set.contains("alpha"));
+}
+
+TEST(CompactSetTest, MovedFromIsUsable) {
+  CompactSet<int> set = {1, 2, 3};
+  CompactSet<int> moved(std::move(set));
+
+  // moved-from sets are empty and usable
+  ASSERT_TRUE(set.empty());
+  ASSERT_EQ(set.begin(), set.end());
+  ASSERT_FALSE(set.contains(1));
+  ASSERT_EQ(set.find(2), set.end());
+
+  set.insert(5);
+  set.insert(4);
+  ASSERT_EQ(std::vector<int>(set.begin(), set.end()), (std::vector<int>{4, 5}));
+
+  CompactSet<int> source = {7};
+  CompactSet<int> other(std::move(source));
+  CompactSet<int> copy(source);
+  ASSERT_TRUE(copy.empty());
+
+  source = moved;
+  ASSERT_EQ(source.size(), 3u);
+  other = std::move(moved);
+  moved = set;
+  ASSERT_EQ(std::vector<int>(moved.begin(), moved.end()), (std::vector<int>{4, 5}));
+  ASSERT_EQ(std::vector<int>(other.begin(), other.end()), (std::vector<int>{1, 2, 3}));
+}
+
+TEST(CompactSetTest, MovesAndSwapsKeepIterators) {
+  using CountingSet = CompactSet<int, std::less<int>, CountingAllocator<int>>;
+  CountingSet set = {1, 2, 3};
+  auto two = set.find(2);
+
+  // iterators refer to the chunk table, which travels with the tree
+  AllocationCounter::Reset();
+  CountingSet moved(std::move(set));
+  ASSERT_EQ(*two, 2);
+  ASSERT_EQ(*std::next(two), 3);
+  ASSERT_EQ(std::next(two, 2), moved.end());
+
+  CountingSet other = {7, 8};
+  auto eight = other.find(8);
+  AllocationCounter::Reset();
+  moved.swap(other);
+  ASSERT_EQ(*eight, 8);
+  ASSERT_EQ(std::prev(eight), moved.begin());
+  ASSERT_EQ(*std::prev(two), 1);
+  ASSERT_EQ(AllocationCounter::allocations, 0u);
+
+  std::vector<CountingSet> sets;
+  sets.push_back(std::move(other));
+  sets.emplace_back();
+  sets.resize(100);
+  ASSERT_EQ(*two, 2);
+  ASSERT_EQ(sets.front().find(2), two);
+}
+
+TEST(CompactSetTest, HeterogeneousLookup) {
+  CompactSet<std::string, std::less<>> set{"delta", "alpha", "charlie", "bravo"};
+
+  ASSERT_TRUE(set.contains(std::string_view("charlie")));
+  ASSERT_FALSE(set.contains("echo"));
+  ASSERT_EQ(*set.lower_bound("b"), "bravo");
+  ASSERT_EQ(*set.upper_bound(std::string_view("charlie")), "delta");
+  ASSERT_EQ(set.find("delta")->size(), 5u);
+}
+
+TEST(CompactSetTest, Empty) {
+  CompactSet<int> set;
+
+  ASSERT_TRUE(set.empty());
+  ASSERT_EQ(set.height(), 0u);
+  ASSERT_EQ(set.begin(), set.end());
+  ASSERT_EQ(set.lower_bound(1), set.end());
+  ASSERT_EQ(set.erase(1), 0u);
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <experimental/random>
+#include <iterator>
+#include <lib/concurrent_set.hpp>
+#include <set>
+#include <string>
+#include <thread>
+#include <tests/counting_allocator.hpp>
+#include <vector>
+
+static_assert(std::forward_iterator<ConcurrentSet<int>::const_iterator>);
+
+TEST(ConcurrentSetTest, SingleThreadedMatchesStdSet) {
+  ConcurrentSet<int> set;
+  std::set<int> expected;
+
+  for (int i = 0; i < 20000; ++i) {
+    auto key = std::experimental::randint(0, 2000);
+
+    if (std::experimental::randint(0, 2) == 0) {
+      ASSERT_EQ(set.erase(key), expected.erase(key));
+    } else {
+      ASSERT_EQ(set.insert(key), expected.insert(key).second);
+    }
+
+    ASSERT_EQ(set.size(), expected.size());
+  }
+
+  auto snapshot = set.snapshot();
+  ASSERT_TRUE(std::ranges::equal(snapshot.begin(), snapshot.end(), expected.begin(), expected.end()));
+
+  for (int key = -1; key <= 2001; ++key) {
+    ASSERT_EQ(set.contains(key), expected.contains(key));
+    ASSERT_EQ(snapshot.contains(key), expected.contains(key));
+
+    auto lower = snapshot.lower_bound(key);
+    auto expected_lower = expected.lower_bound(key);
+    ASSERT_EQ(lower == snapshot.end(), expected_lower == expected.end());
+    if (lower != snapshot.end()) {
+      ASSERT_EQ(*lower, *expected_lower);
+    }
+  }
+}
+
+TEST(ConcurrentSetTest, SnapshotIgnoresLaterWrites) {
+  ConcurrentSet<std::string> set = {"a", "b", "c"};
+
+  auto snapshot = set.snapshot();
+  set.erase("b");
+  set.insert("d");
+  set.clear();
+
+  ASSERT_TRUE(set.empty());
+  ASSERT_FALSE(set.contains("a"));
+  std::vector<std::string> expected = {"a", "b", "c"};
+  ASSERT_TRUE(std::ranges::equal(snapshot.begin(), snapshot.end(), expected.begin(), expected.end()));
+  ASSERT_EQ(*snapshot.find("b"), "b");
+  ASSERT_EQ(snapshot.find("d"), snapshot.end());
+}
+
+TEST(ConcurrentSetTest, ReplacedNodesAreFreed) {
+  AllocationCounter::Reset();
+
+  {
+    ConcurrentSet<int, std::less<int>, CountingAllocator<int>> set;
+    for (int i = 0; i < 5000; ++i) {
+      set.insert(i);
+      if (i % 3 == 0) {
+        set.erase(i / 2);
+      }
+    }
+
+    // nobody reads, so retired nodes don't pile up beyond a batch
+    ASSERT_LE(AllocationCounter::allocations - AllocationCounter::deallocations, set.size() + 512);
+  }
+
+  ASSERT_EQ(AllocationCounter::allocations, AllocationCounter::deallocations);
+}
+
+// one writer slides a window of keys while readers check that every view they get is one
+// the writer published: consecutive keys, since each write is a single publication. A node
+// freed while a reader still sees it is a use after free
+TEST(ConcurrentSetTest, ReadersRaceWithWriter) {
+  constexpr int kWindow = 500;
+  constexpr int kWrites = 20000;
+  constexpr int kReaders = 4;
+
+  ConcurrentSet<int> set;
+  std::atomic<bool> done{false};
+  std::atomic<long> checks{0};
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < kReaders; ++r) {
+    readers.emplace_back([&] {
+      while (!done.load()) {
+        auto snapshot = set.snapshot();
+        std::vector<int> keys(snapshot.begin(), snapshot.end());
+
+        ASSERT_LE(keys.size(), static_cast<std::size_t>(kWindow) + 1);
+        if (!keys.empty()) {
+          ASSERT_EQ(keys.back() - keys.front() + 1, static_cast<int>(keys.size()));
+          ASSERT_TRUE(std::ranges::is_sorted(keys));
+          ASSERT_TRUE(snapshot.contains(keys[keys.size() / 2]));
+        }
+
+        // erased keys never come back
+        auto probe = std::experimental::randint(0, kWrites);
+        if (!keys.empty() && probe < keys.front()) {
+          ASSERT_FALSE(set.contains(probe));
+        }
+
+        checks.fetch_add(1);
+      }
+    });
+  }
+
+  for (int i = 0; i < kWrites; ++i) {
+    set.insert(i);
+    if (i >= kWindow) {
+      EXPECT_EQ(set.erase(i - kWindow), 1u); // readers must be joined
+    }
+  }
+
+  done.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  ASSERT_GT(checks.load(), 0);
+  ASSERT_EQ(set.size(), static_cast<std::size_t>(kWindow));
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+// std::allocator which counts calls shared by all of its rebinds
+struct AllocationCounter {
+  static inline std::size_t allocations = 0;
+  static inline std::size_t deallocations = 0;
+
+  static void Reset() {
+    allocations = 0;
+    deallocations = 0;
+  }
+};
+
+template <typename T>
+struct CountingAllocator : std::allocator<T> {
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = CountingAllocator<U>;
+  };
+
+  CountingAllocator() = default;
+
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    ++AllocationCounter::allocations;
+    return std::allocator<T>::allocate(n);
+  }
+
+  void deallocate(T* ptr, std::size_t n) {
+    ++AllocationCounter::deallocations;
+    std::allocator<T>::deallocate(ptr, n);
+  }
+};
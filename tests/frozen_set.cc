@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <experimental/random>
+#include <lib/frozen_set.hpp>
+#include <lib/set.hpp>
+#include <numeric>
+#include <ranges>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static_assert(std::bidirectional_iterator<FrozenSet<int>::iterator>);
+static_assert(std::ranges::bidirectional_range<FrozenSet<int>>);
+
+TEST(FrozenSetTest, EveryShape) {
+  // every size up to a few full levels, odd keys only so even ones are missing
+  for (int count = 0; count < 70; ++count) {
+    std::vector<int> keys(count);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::ranges::transform(keys, keys.begin(), [](int key) { return key * 2 + 1; });
+
+    FrozenSet<int> frozen(keys.begin(), keys.end());
+    std::set<int> expected(keys.begin(), keys.end());
+
+    ASSERT_EQ(frozen.size(), keys.size());
+    ASSERT_EQ(std::vector<int>(frozen.begin(), frozen.end()), keys);
+    ASSERT_EQ(std::vector<int>(frozen.rbegin(), frozen.rend()), std::vector<int>(keys.rbegin(), keys.rend()));
+
+    for (int key = -1; key <= count * 2 + 1; ++key) {
+      auto lower = expected.lower_bound(key);
+      auto upper = expected.upper_bound(key);
+
+      auto frozen_lower = frozen.lower_bound(key);
+      auto frozen_upper = frozen.upper_bound(key);
+
+      ASSERT_EQ(lower == expected.end(), frozen_lower == frozen.end());
+      ASSERT_EQ(upper == expected.end(), frozen_upper == frozen.end());
+      if (lower != expected.end()) {
+        ASSERT_EQ(*lower, *frozen_lower);
+      }
+      if (upper != expected.end()) {
+        ASSERT_EQ(*upper, *frozen_upper);
+      }
+
+      ASSERT_EQ(frozen.contains(key), expected.contains(key));
+      ASSERT_EQ(frozen.find(key) != frozen.end(), expected.contains(key));
+    }
+  }
+}
+
+TEST(FrozenSetTest, UnsortedInputAndFreeze) {
+  std::vector<int> keys;
+  for (int i = 0; i < 5000; ++i) {
+    keys.push_back(std::experimental::randint(-1000, 1000));
+  }
+
+  Set<int> set(keys.begin(), keys.end());
+  FrozenSet<int> frozen(keys.begin(), keys.end());
+  auto snapshot = set.freeze();
+
+  std::set<int> expected(keys.begin(), keys.end());
+  ASSERT_EQ(std::vector<int>(frozen.begin(), frozen.end()), std::vector<int>(expected.begin(), expected.end()));
+  ASSERT_EQ(std::vector<int>(snapshot.begin(), snapshot.end()), std::vector<int>(expected.begin(), expected.end()));
+
+  // snapshot doesn't see later changes
+  set.insert(5000);
+  ASSERT_FALSE(snapshot.contains(5000));
+}
+
+TEST(FrozenSetTest, HeterogeneousLookup) {
+  FrozenSet<std::string, std::less<>> frozen{"delta", "alpha", "charlie", "bravo", "alpha"};
+
+  ASSERT_EQ(frozen.size(), 4u);
+  ASSERT_TRUE(frozen.contains(std::string_view("charlie")));
+  ASSERT_FALSE(frozen.contains("echo"));
+  ASSERT_EQ(*frozen.lower_bound("b"), "bravo");
+  ASSERT_EQ(*frozen.upper_bound(std::string_view("charlie")), "delta");
+  ASSERT_EQ(frozen.find("delta")->size(), 5u);
+}
+
+TEST(FrozenSetTest, Empty) {
+  FrozenSet<int> frozen;
+
+  ASSERT_TRUE(frozen.empty());
+  ASSERT_EQ(frozen.begin(), frozen.end());
+  ASSERT_EQ(frozen.lower_bound(1), frozen.end());
+  ASSERT_FALSE(frozen.contains(1));
+}
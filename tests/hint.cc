@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <experimental/random>
+#include <lib/set.hpp>
+#include <numeric>
+#include <set>
+#include <tests/tree_invariants.hpp>
+#include <vector>
+
+namespace {
+
+struct CountingLess {
+  static inline size_t comparisons = 0;
+
+  bool operator()(int lhs, int rhs) const {
+    ++comparisons;
+    return lhs < rhs;
+  }
+};
+
+template <typename SetType>
+std::vector<int> Collect(const SetType& set) {
+  return std::vector<int>(set.begin(), set.end());
+}
+
+} // namespace
+
+TEST(HintTest, AppendAtEnd) {
+  static constexpr int kCount = 1 << 12;
+  Set<int, CountingLess> set;
+
+  CountingLess::comparisons = 0;
+  for (int i = 0; i < kCount; ++i) {
+    auto it = set.insert(set.end(), i);
+    ASSERT_EQ(*it, i);
+  }
+
+  // only the current maximum is compared with, no descent from the root
+  ASSERT_EQ(CountingLess::comparisons, static_cast<size_t>(kCount - 1));
+  ASSERT_EQ(set.size(), static_cast<size_t>(kCount));
+  CheckRedBlack(GetRoot(set));
+}
+
+TEST(HintTest, HintNextToKey) {
+  BalancedSet<Avl> set;
+  auto hint = set.end();
+
+  // every key goes right before the previous one
+  for (int i = 1000; i > 0; --i) {
+    hint = set.emplace_hint(hint, i);
+    ASSERT_EQ(*hint, i);
+  }
+
+  // and right after the hint
+  for (int i = 1000; i > 0; --i) {
+    set.insert(set.find(i), i + 1000);
+  }
+
+  std::vector<int> expected(2000);
+  std::iota(expected.begin(), expected.end(), 1);
+  ASSERT_EQ(Collect(set), expected);
+  CheckAvl(GetRoot(set));
+}
+
+TEST(HintTest, WrongHint) {
+  std::vector<int> keys;
+  for (int i = 0; i < 5000; ++i) {
+    keys.push_back(std::experimental::randint(-1000, 1000));
+  }
+
+  BalancedSet<RedBlack> set;
+  std::set<int> expected;
+
+  for (int key : keys) {
+    // random hint, usually far away from the key
+    auto hint = set.lower_bound(std::experimental::randint(-1000, 1000));
+    auto it = set.emplace_hint(hint, key);
+
+    ASSERT_EQ(*it, key);
+    expected.insert(key);
+  }
+
+  ASSERT_EQ(Collect(set), std::vector<int>(expected.begin(), expected.end()));
+  ASSERT_EQ(set.size(), expected.size());
+  CheckRedBlack(GetRoot(set));
+}
+
+TEST(HintTest, ExistingKey) {
+  Set<int> set{1, 2, 3};
+
+  auto it = set.insert(set.find(2), 2);
+  ASSERT_EQ(it, set.find(2));
+
+  it = set.insert(set.end(), 1);
+  ASSERT_EQ(it, set.find(1));
+  ASSERT_EQ(set.size(), 3u);
+}
+
+TEST(HintTest, AppendAfterErase) {
+  Set<int> set;
+  std::set<int> expected;
+
+  // largest key keeps changing, appends with a stale maximum would break the order
+  for (int i = 0; i < 5000; ++i) {
+    int key = std::experimental::randint(0, 300);
+    if (std::experimental::randint(0, 2) == 0) {
+      set.erase(key);
+      expected.erase(key);
+    } else {
+      set.insert(set.end(), key);
+      expected.insert(key);
+    }
+
+    ASSERT_EQ(Collect(set), std::vector<int>(expected.begin(), expected.end()));
+  }
+
+  Set<int> copy = set;
+  copy.insert(copy.end(), 1000);
+  set.clear();
+  set.insert(set.end(), 1);
+
+  ASSERT_EQ(*--copy.end(), 1000);
+  ASSERT_EQ(Collect(set), std::vector<int>{1});
+}
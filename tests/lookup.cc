@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <experimental/random>
+#include <iterator>
+#include <lib/set.hpp>
+#include <ranges>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static_assert(std::bidirectional_iterator<Set<int>::iterator>);
+static_assert(std::ranges::borrowed_range<decltype(std::declval<Set<int>&>().range(0, 1))>);
+
+TEST(LookupTest, BoundsMatchStdSet) {
+  Set<int> set;
+  std::set<int> expected;
+
+  for (int i = 0; i < 500; ++i) {
+    int num = std::experimental::randint(-1000, 1000) * 2; // leave gaps between keys
+    set.insert(num);
+    expected.insert(num);
+  }
+
+  for (int key = -2010; key <= 2010; ++key) {
+    auto lower = set.lower_bound(key);
+    auto expected_lower = expected.lower_bound(key);
+    if (expected_lower == expected.end()) {
+      ASSERT_EQ(lower, set.end());
+    } else {
+      ASSERT_EQ(*lower, *expected_lower);
+    }
+
+    auto upper = set.upper_bound(key);
+    auto expected_upper = expected.upper_bound(key);
+    if (expected_upper == expected.end()) {
+      ASSERT_EQ(upper, set.end());
+    } else {
+      ASSERT_EQ(*upper, *expected_upper);
+    }
+
+    auto [first, last] = set.equal_range(key);
+    ASSERT_EQ(first, lower);
+    ASSERT_EQ(last, upper);
+    ASSERT_EQ(std::distance(first, last), static_cast<std::ptrdiff_t>(expected.count(key)));
+  }
+}
+
+TEST(LookupTest, RangeScan) {
+  Set<int> set;
+  for (int i = 0; i < 100; ++i) {
+    set.insert(i * 10);
+  }
+
+  std::vector<int> result;
+  std::ranges::copy(set.range(95, 140), std::back_inserter(result));
+  ASSERT_EQ(result, (std::vector<int>{100, 110, 120, 130}));
+
+  auto evens = set.range(0, 50) | std::views::filter([](int i) { return i % 20 == 0; });
+  ASSERT_EQ(std::ranges::distance(evens), 3);
+
+  ASSERT_TRUE(set.range(50, 50).empty());
+  ASSERT_TRUE(set.range(60, 50).empty());
+  ASSERT_EQ(std::ranges::distance(set.range(-100, 10000)), 100);
+
+  // borrowed range, the iterator outlives the subrange object
+  auto it = std::ranges::find(set.range(200, 300), 250);
+  ASSERT_EQ(*it, 250);
+}
+
+namespace {
+
+// key which counts its constructions, comparable with plain ints
+struct CountedKey {
+  static inline int constructions = 0;
+
+  CountedKey(int v = 0) : value{v} { ++constructions; }
+  CountedKey(const CountedKey& other) : value{other.value} { ++constructions; }
+
+  int value;
+};
+
+struct CountedKeyLess {
+  using is_transparent = void;
+
+  bool operator()(const CountedKey& lhs, const CountedKey& rhs) const { return lhs.value < rhs.value; }
+  bool operator()(const CountedKey& lhs, int rhs) const { return lhs.value < rhs; }
+  bool operator()(int lhs, const CountedKey& rhs) const { return lhs < rhs.value; }
+  bool operator()(int lhs, int rhs) const { return lhs < rhs; }
+};
+
+} // namespace
+
+TEST(LookupTest, TransparentLookupDoesNotConstructKeys) {
+  Set<CountedKey, CountedKeyLess> set;
+  for (int i = 0; i < 100; ++i) {
+    set.insert(CountedKey{i * 2});
+  }
+
+  CountedKey::constructions = 0;
+
+  ASSERT_EQ(set.find(42)->value, 42);
+  ASSERT_EQ(set.find(43), set.end());
+  ASSERT_TRUE(set.contains(10));
+  ASSERT_FALSE(set.contains(11));
+  ASSERT_EQ(set.lower_bound(11)->value, 12);
+  ASSERT_EQ(set.upper_bound(12)->value, 14);
+  ASSERT_EQ(std::ranges::distance(set.range(10, 20)), 5);
+  ASSERT_EQ(set.equal_range(7).first, set.equal_range(7).second);
+  ASSERT_FALSE(set.try_emplace(42).first);
+  ASSERT_EQ(set.erase(42), 1u);
+  ASSERT_EQ(set.erase(42), 0u);
+
+  ASSERT_EQ(CountedKey::constructions, 0);
+
+  ASSERT_TRUE(set.try_emplace(43, 43).first);
+  ASSERT_EQ(CountedKey::constructions, 1);
+  ASSERT_EQ(set.size(), 100u);
+}
+
+TEST(LookupTest, StringViewLookup) {
+  Set<std::string, std::less<>> set;
+  set.insert("first key which doesn't fit into small string buffer");
+  set.insert("second key which doesn't fit into small string buffer");
+
+  std::string_view view = "first key which doesn't fit into small string buffer";
+  ASSERT_TRUE(set.contains(view));
+  ASSERT_EQ(*set.find(view), view);
+  ASSERT_TRUE(set.contains("second key which doesn't fit into small string buffer"));
+  ASSERT_FALSE(set.contains(view.substr(1)));
+
+  ASSERT_EQ(set.erase(view), 1u);
+  ASSERT_EQ(set.size(), 1u);
+}
+
+TEST(LookupTest, BatchedLookupMatchesSingle) {
+  // too large to count as cache resident, so the lockstep descents run
+  Set<int, std::less<int>, std::allocator<int>, Avl> set;
+  for (int i = 0; i < 30000; ++i) {
+    set.insert(std::experimental::randint(-50000, 50000));
+  }
+
+  // batches of every length around kBatchWidth, a ragged last one included
+  for (std::size_t count : {std::size_t{0}, std::size_t{1}, Set<int>::kBatchWidth - 1, Set<int>::kBatchWidth, std::size_t{100}}) {
+    std::vector<int> keys;
+    for (std::size_t i = 0; i < count; ++i) {
+      keys.push_back(std::experimental::randint(-60000, 60000));
+    }
+
+    std::vector<decltype(set)::const_iterator> found(count);
+    bool flags[100];
+
+    set.find_many(keys, found);
+    set.contains_many(keys, std::span<bool>(flags, count));
+
+    for (std::size_t i = 0; i < count; ++i) {
+      ASSERT_EQ(found[i], set.find(keys[i]));
+      ASSERT_EQ(flags[i], set.contains(keys[i]));
+    }
+  }
+
+  // small sets take the plain finds
+  Set<int> small{1, 3};
+  bool flags[3];
+  small.contains_many(std::vector<int>{1, 2, 3}, flags);
+  ASSERT_TRUE(flags[0]);
+  ASSERT_FALSE(flags[1]);
+  ASSERT_TRUE(flags[2]);
+}
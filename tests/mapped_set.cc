@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdio>
+#include <experimental/random>
+#include <filesystem>
+#include <fstream>
+#include <lib/mapped_set.hpp>
+#include <lib/set.hpp>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+static_assert(std::bidirectional_iterator<MappedSet<int>::iterator>);
+static_assert(std::ranges::bidirectional_range<MappedSet<int>>);
+
+namespace {
+
+std::string ImagePath(const std::string& name) {
+  return testing::TempDir() + "/" + name + ".set";
+}
+
+struct Point {
+  int32_t x;
+  int32_t y;
+};
+
+struct ByY {
+  bool operator()(const Point& lhs, const Point& rhs) const {
+    return lhs.y < rhs.y;
+  }
+};
+
+} // namespace
+
+TEST(MappedSetTest, RoundTrip) {
+  auto path = ImagePath("round_trip");
+  Set<int64_t> set;
+  std::set<int64_t> expected;
+  for (int i = 0; i < 10000; ++i) {
+    auto key = static_cast<int64_t>(std::experimental::randint(-100000, 100000));
+    set.insert(key);
+    expected.insert(key);
+  }
+
+  set.save(path);
+  auto mapped = Set<int64_t>::open_mapped(path);
+
+  ASSERT_EQ(mapped.size(), expected.size());
+  ASSERT_TRUE(std::ranges::equal(mapped, expected));
+  ASSERT_TRUE(std::equal(mapped.rbegin(), mapped.rend(), expected.rbegin(), expected.rend()));
+
+  for (int i = 0; i < 10000; ++i) {
+    auto key = static_cast<int64_t>(std::experimental::randint(-100001, 100001));
+    ASSERT_EQ(mapped.contains(key), expected.contains(key));
+
+    auto lower = mapped.lower_bound(key);
+    auto expected_lower = expected.lower_bound(key);
+    ASSERT_EQ(lower == mapped.end(), expected_lower == expected.end());
+    if (lower != mapped.end()) {
+      ASSERT_EQ(*lower, *expected_lower);
+    }
+  }
+
+  // saving again replaces the file, the old mapping stays as it was
+  set.insert(1'000'000);
+  set.save(path);
+  auto updated = Set<int64_t>::open_mapped(path);
+  ASSERT_TRUE(updated.contains(1'000'000));
+  ASSERT_FALSE(mapped.contains(1'000'000));
+  ASSERT_TRUE(std::ranges::equal(mapped, expected));
+
+  auto moved = std::move(mapped);
+  ASSERT_TRUE(mapped.empty());
+  ASSERT_EQ(moved.size(), expected.size());
+
+  std::remove(path.c_str());
+}
+
+TEST(MappedSetTest, ConcurrentSavesDontMix) {
+  auto path = ImagePath("concurrent");
+  Set<int> evens;
+  Set<int> odds;
+  for (int i = 0; i < 10000; i += 2) {
+    evens.insert(i);
+    odds.insert(i + 1);
+  }
+
+  // every save writes its own temporary file, so the image is always one of them in full
+  std::thread writer([&] {
+    for (int i = 0; i < 20; ++i) {
+      odds.save(path);
+    }
+  });
+  for (int i = 0; i < 20; ++i) {
+    evens.save(path);
+  }
+  writer.join();
+
+  auto mapped = MappedSet<int>(path);
+  ASSERT_TRUE(std::ranges::equal(mapped, evens) || std::ranges::equal(mapped, odds));
+
+  // nothing but the image is left behind
+  auto name = std::filesystem::path(path).filename().string();
+  for (const auto& entry : std::filesystem::directory_iterator(testing::TempDir())) {
+    auto other = entry.path().filename().string();
+    ASSERT_FALSE(other != name && other.starts_with(name)) << other;
+  }
+
+  std::remove(path.c_str());
+}
+
+TEST(MappedSetTest, EmptyAndCustomComparator) {
+  auto path = ImagePath("empty");
+  Set<int> empty;
+  empty.save(path);
+
+  auto mapped = Set<int>::open_mapped(path);
+  ASSERT_TRUE(mapped.empty());
+  ASSERT_EQ(mapped.begin(), mapped.end());
+  ASSERT_FALSE(mapped.contains(0));
+
+  Set<Point, ByY> points = {{1, 3}, {2, 1}, {3, 2}};
+  points.save(path);
+  auto mapped_points = MappedSet<Point, ByY>(path);
+
+  std::vector<int> xs;
+  for (const auto& point : mapped_points) {
+    xs.push_back(point.x);
+  }
+  ASSERT_EQ(xs, (std::vector<int>{2, 3, 1}));
+  ASSERT_EQ(mapped_points.find({0, 3})->x, 1);
+  ASSERT_EQ(mapped_points.find({0, 4}), mapped_points.end());
+
+  std::remove(path.c_str());
+}
+
+TEST(MappedSetTest, RejectsBadImages) {
+  auto path = ImagePath("bad");
+  ASSERT_THROW(MappedSet<int>(ImagePath("missing")), std::system_error);
+
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "not an image of a set, just some text which is long enough for a header";
+  }
+  ASSERT_THROW(MappedSet<int>{path}, std::runtime_error);
+
+  Set<int> set = {1, 2, 3, 4, 5};
+  set.save(path);
+  ASSERT_THROW(MappedSet<int64_t>{path}, std::runtime_error);
+  ASSERT_EQ(MappedSet<int>(path).size(), 5u);
+
+  // one flipped key byte, caught by the checksum only
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(SetImageHeader::kKeysOffset + 1);
+    file.put('\x7f');
+  }
+  ASSERT_THROW(MappedSet<int>{path}, std::runtime_error);
+  ASSERT_EQ(MappedSet<int>(path, false).size(), 5u);
+
+  // cut off in the middle of the keys
+  std::filesystem::resize_file(path, SetImageHeader::kKeysOffset + 2 * sizeof(int));
+  ASSERT_THROW(MappedSet<int>(path, false), std::runtime_error);
+
+  std::remove(path.c_str());
+}
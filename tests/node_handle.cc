@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <experimental/random>
+#include <lib/pool_allocator.hpp>
+#include <lib/set.hpp>
+#include <set>
+#include <string>
+#include <tests/counting_allocator.hpp>
+#include <tests/tree_invariants.hpp>
+#include <vector>
+
+namespace {
+
+template <typename SetType>
+std::vector<int> Collect(const SetType& set) {
+  return std::vector<int>(set.begin(), set.end());
+}
+
+using CountingSet = Set<int, std::less<int>, CountingAllocator<int>>;
+
+} // namespace
+
+TEST(NodeHandleTest, ExtractKeepsTreeValid) {
+  BalancedSet<RedBlack> red_black;
+  BalancedSet<Avl> avl;
+  std::set<int> expected;
+
+  for (int i = 0; i < 2000; ++i) {
+    int key = std::experimental::randint(0, 1000);
+    red_black.insert(key);
+    avl.insert(key);
+    expected.insert(key);
+  }
+
+  for (int i = 0; i < 1000; ++i) {
+    int key = std::experimental::randint(0, 1000);
+    const int* address = red_black.contains(key) ? &*red_black.find(key) : nullptr;
+
+    auto node = red_black.extract(key);
+    ASSERT_EQ(avl.extract(key).empty(), node.empty());
+    ASSERT_EQ(expected.erase(key) == 0, node.empty());
+
+    if (!node.empty()) {
+      // the key is handed out in the allocation it had in the tree
+      ASSERT_EQ(&node.value(), address);
+    }
+
+    CheckRedBlack(GetRoot(red_black));
+    CheckAvl(GetRoot(avl));
+  }
+
+  ASSERT_EQ(Collect(red_black), std::vector<int>(expected.begin(), expected.end()));
+  ASSERT_EQ(Collect(avl), std::vector<int>(expected.begin(), expected.end()));
+  ASSERT_EQ(red_black.size(), expected.size());
+}
+
+TEST(NodeHandleTest, ExtractKeepsOtherIteratorsValid) {
+  Set<int> set{5, 3, 8, 1, 4, 7, 9, 6};
+  auto six = set.find(6); // successor of the extracted key
+
+  auto node = set.extract(set.find(5));
+  ASSERT_EQ(node.value(), 5);
+  ASSERT_EQ(*six, 6);
+  ASSERT_EQ(*--six, 4);
+  ASSERT_EQ(Collect(set), (std::vector<int>{1, 3, 4, 6, 7, 8, 9}));
+}
+
+TEST(NodeHandleTest, MoveBetweenSetsWithoutAllocation) {
+  CountingSet from{1, 2, 3};
+  CountingSet to{3, 4};
+  AllocationCounter::Reset();
+
+  auto node = from.extract(2);
+  node.value() = 5;
+
+  auto [position, inserted, rest] = to.insert(std::move(node));
+  ASSERT_TRUE(inserted);
+  ASSERT_EQ(*position, 5);
+  ASSERT_TRUE(rest.empty());
+
+  auto duplicate = to.insert(from.extract(3));
+  ASSERT_FALSE(duplicate.inserted);
+  ASSERT_EQ(duplicate.position, to.find(3));
+  ASSERT_EQ(duplicate.node.value(), 3); // given back
+
+  ASSERT_EQ(AllocationCounter::allocations, 0u);
+  ASSERT_EQ(AllocationCounter::deallocations, 0u);
+
+  duplicate.node = {}; // handle owns the node until it's dropped
+  ASSERT_EQ(AllocationCounter::deallocations, 1u);
+
+  ASSERT_EQ(Collect(from), std::vector<int>{1});
+  ASSERT_EQ(Collect(to), (std::vector<int>{3, 4, 5}));
+  ASSERT_TRUE(from.extract(42).empty());
+}
+
+TEST(NodeHandleTest, InsertWithHint) {
+  Set<int> from{1, 2, 3};
+  Set<int> to;
+
+  for (int key : {1, 2, 3}) {
+    auto it = to.insert(to.end(), from.extract(key));
+    ASSERT_EQ(*it, key);
+  }
+
+  ASSERT_TRUE(from.empty());
+  ASSERT_EQ(Collect(to), (std::vector<int>{1, 2, 3}));
+}
+
+TEST(NodeHandleTest, DifferentAllocatorsMoveKeys) {
+  Set<std::string, std::less<std::string>, PoolAllocator<std::string>> from{"a", "b"};
+  Set<std::string, std::less<std::string>, PoolAllocator<std::string>> to;
+
+  auto handle = from.extract("a");
+  auto [position, inserted, rest] = to.insert(std::move(handle));
+  ASSERT_TRUE(inserted);
+  ASSERT_EQ(*position, "a");
+  ASSERT_TRUE(handle.empty()); // the old node was freed, not left behind with a moved-from key
+  ASSERT_TRUE(rest.empty());
+
+  handle = from.extract("b");
+  ASSERT_EQ(*to.insert(to.end(), std::move(handle)), "b");
+  ASSERT_TRUE(handle.empty());
+
+  from.clear(); // pools are separate, so nothing in to may come from the one of from
+  ASSERT_EQ(std::vector<std::string>(to.begin(), to.end()), (std::vector<std::string>{"a", "b"}));
+}
+
+TEST(MergeTest, LargeSetsAreZipped) {
+  std::set<int> left;
+  std::set<int> right;
+  CountingSet red_black;
+  Set<int, std::less<int>, CountingAllocator<int>, Avl> avl;
+
+  for (int i = 0; i < 3000; ++i) {
+    int key = std::experimental::randint(0, 5000);
+    left.insert(key);
+    red_black.insert(key);
+  }
+  for (int i = 0; i < 3000; ++i) {
+    int key = std::experimental::randint(0, 5000);
+    right.insert(key);
+    avl.insert(key);
+  }
+
+  std::vector<const int*> addresses;
+  for (const auto& key : avl) {
+    addresses.push_back(&key);
+  }
+
+  AllocationCounter::Reset();
+  red_black.merge(avl);
+
+  ASSERT_EQ(AllocationCounter::allocations, 0u);
+  ASSERT_EQ(AllocationCounter::deallocations, 0u);
+
+  std::vector<int> duplicates;
+  std::ranges::set_intersection(left, right, std::back_inserter(duplicates));
+  left.merge(right);
+
+  ASSERT_EQ(Collect(red_black), std::vector<int>(left.begin(), left.end()));
+  ASSERT_EQ(Collect(avl), duplicates);
+  ASSERT_EQ(red_black.size(), left.size());
+  ASSERT_EQ(avl.size(), duplicates.size());
+  CheckRedBlack(GetRoot(red_black));
+  CheckAvl(GetRoot(avl));
+
+  // every key moved along with its node
+  for (const auto* address : addresses) {
+    ASSERT_TRUE(red_black.contains(*address) || avl.contains(*address));
+    ASSERT_TRUE(&*red_black.find(*address) == address || &*avl.find(*address) == address);
+  }
+}
+
+TEST(MergeTest, SmallSourceIsInsertedPerNode) {
+  Set<int> set;
+  for (int i = 0; i < 1000; ++i) {
+    set.insert(i * 2);
+  }
+
+  Set<int> source{1, 2, 3, 2001};
+  set.merge(source);
+
+  ASSERT_EQ(Collect(source), std::vector<int>{2});
+  ASSERT_EQ(set.size(), 1003u);
+  ASSERT_EQ(*--set.end(), 2001);
+  ASSERT_TRUE(set.contains(1) && set.contains(3));
+  CheckRedBlack(GetRoot(set));
+}
+
+TEST(MergeTest, DifferentComparatorsAndAllocators) {
+  Set<int, std::greater<int>> descending{5, 4, 3};
+  Set<int> ascending{1, 3};
+
+  ascending.merge(descending);
+  ASSERT_EQ(Collect(ascending), (std::vector<int>{1, 3, 4, 5}));
+  ASSERT_EQ(Collect(descending), std::vector<int>{3});
+
+  Set<std::string, std::less<std::string>, PoolAllocator<std::string>> from{"a", "b", "c"};
+  Set<std::string, std::less<std::string>, PoolAllocator<std::string>> to{"b"};
+
+  to.merge(std::move(from));
+  from.clear();
+
+  ASSERT_EQ(std::vector<std::string>(to.begin(), to.end()), (std::vector<std::string>{"a", "b", "c"}));
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <experimental/random>
+#include <iterator>
+#include <lib/set.hpp>
+#include <numeric>
+#include <set>
+#include <tests/tree_invariants.hpp>
+#include <vector>
+
+namespace {
+
+template <typename Base>
+using RankedSet = Set<int, std::less<int>, std::allocator<int>, OrderStatistic<Base>>;
+
+// both trees have to be consistent with the sorted keys
+template <typename SetType>
+void CheckPositions(const SetType& set, const std::set<int>& expected) {
+  CheckSizes(GetRoot(set));
+  ASSERT_EQ(set.size(), expected.size());
+
+  size_t k = 0;
+  for (int key : expected) {
+    ASSERT_EQ(*set.nth(k), key);
+    ASSERT_EQ(set.rank(key), k);
+    ASSERT_EQ(set.rank(key + 1), k + 1); // keys are spaced apart, key + 1 is missing
+    ++k;
+  }
+
+  ASSERT_EQ(set.nth(k), set.end());
+}
+
+} // namespace
+
+// plain sets don't carry the subtree sizes around
+static_assert(std::is_same_v<Set<int>::allocator_type::value_type, Node<int>>);
+static_assert(!std::random_access_iterator<Set<int>::iterator>);
+
+// jumps cost O(height), so algorithms mustn't take them for random access
+static_assert(std::bidirectional_iterator<RankedSet<RedBlack>::iterator>);
+static_assert(!std::random_access_iterator<RankedSet<RedBlack>::iterator>);
+
+template <typename Base>
+class OrderStatisticTest : public testing::Test {};
+
+using Policies = testing::Types<Unbalanced, RedBlack, Avl>;
+TYPED_TEST_SUITE(OrderStatisticTest, Policies);
+
+TYPED_TEST(OrderStatisticTest, RandomInsertErase) {
+  RankedSet<TypeParam> set;
+  std::set<int> expected;
+
+  for (int i = 0; i < 3000; ++i) {
+    int key = std::experimental::randint(0, 1000) * 2;
+
+    if (std::experimental::randint(0, 2) == 0) {
+      set.erase(key);
+      expected.erase(key);
+    } else {
+      set.insert(key);
+      expected.insert(key);
+    }
+
+    if (i % 100 == 0) {
+      CheckPositions(set, expected);
+    }
+  }
+
+  CheckPositions(set, expected);
+}
+
+TYPED_TEST(OrderStatisticTest, BulkCopyAndNodeHandles) {
+  std::vector<int> keys(1000);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::ranges::transform(keys, keys.begin(), [](int key) { return key * 2; });
+
+  RankedSet<TypeParam> set(keys.begin(), keys.end());
+  std::set<int> expected(keys.begin(), keys.end());
+  CheckPositions(set, expected);
+
+  RankedSet<TypeParam> copy;
+  copy = set;
+  CheckPositions(copy, expected);
+
+  auto node = copy.extract(500);
+  copy.insert(copy.end(), std::move(node));
+  CheckPositions(copy, expected);
+
+  RankedSet<TypeParam> other{1, 3, 5};
+  set.merge(other);
+  expected.insert({1, 3, 5});
+  CheckSizes(GetRoot(set));
+  ASSERT_EQ(set.rank(6), 6u);
+}
+
+TEST(OrderStatisticTest, IteratorArithmetics) {
+  RankedSet<RedBlack> set;
+  for (int i = 0; i < 100; ++i) {
+    set.insert(i * 10);
+  }
+
+  auto begin = set.begin();
+  auto it = set.find(370);
+
+  ASSERT_EQ(set.distance(begin, it), 37);
+  ASSERT_EQ(set.distance(it, begin), -37);
+  ASSERT_EQ(std::distance(begin, it), 37);
+  ASSERT_EQ(std::ranges::distance(set), 100);
+  ASSERT_EQ(set.end() - it, 63);
+  ASSERT_EQ(it - 7, set.find(300));
+  ASSERT_EQ(begin[99], 990);
+  ASSERT_EQ(*(5 + begin), 50);
+  ASSERT_TRUE(begin < it && it < set.end());
+
+  std::advance(it, 62);
+  ASSERT_EQ(*it, 990);
+  std::advance(it, 1);
+  ASSERT_EQ(it, set.end());
+  std::advance(it, -100);
+  ASSERT_EQ(it, begin);
+
+  // percentile query
+  ASSERT_EQ(*set.nth(set.size() * 99 / 100), 990);
+  ASSERT_EQ(*std::ranges::lower_bound(set, 555), 560);
+}
@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <experimental/random>
+#include <iterator>
+#include <lib/persistent_set.hpp>
+#include <set>
+#include <string>
+#include <thread>
+#include <tests/counting_allocator.hpp>
+#include <utility>
+#include <vector>
+
+static_assert(std::forward_iterator<PersistentSet<int>::const_iterator>);
+static_assert(std::is_nothrow_move_constructible_v<PersistentSet<int>>);
+static_assert(std::is_nothrow_move_assignable_v<PersistentSet<int>>);
+
+TEST(PersistentSetTest, SnapshotsKeepTheirContents) {
+  PersistentSet<int> set;
+  std::set<int> expected;
+  std::vector<std::pair<PersistentSet<int>, std::set<int>>> snapshots;
+
+  for (int i = 0; i < 20000; ++i) {
+    auto key = std::experimental::randint(0, 2000);
+
+    if (std::experimental::randint(0, 2) == 0) {
+      ASSERT_EQ(set.erase(key), expected.erase(key));
+    } else {
+      ASSERT_EQ(set.insert(key), expected.insert(key).second);
+    }
+
+    ASSERT_EQ(set.size(), expected.size());
+    if (i % 1000 == 0) {
+      snapshots.emplace_back(set.snapshot(), expected);
+    }
+  }
+
+  ASSERT_TRUE(std::ranges::equal(set, expected));
+  for (int key = -1; key <= 2001; ++key) {
+    ASSERT_EQ(set.contains(key), expected.contains(key));
+
+    auto lower = set.lower_bound(key);
+    auto expected_lower = expected.lower_bound(key);
+    ASSERT_EQ(lower == set.end(), expected_lower == expected.end());
+    if (lower != set.end()) {
+      ASSERT_EQ(*lower, *expected_lower);
+    }
+  }
+
+  for (const auto& [snapshot, keys] : snapshots) {
+    ASSERT_EQ(snapshot.size(), keys.size());
+    ASSERT_TRUE(std::ranges::equal(snapshot, keys));
+  }
+
+  // writes to a snapshot don't reach the set it was taken from
+  auto& [snapshot, keys] = snapshots.back();
+  snapshot.clear();
+  snapshot.insert(-5);
+  ASSERT_TRUE(std::ranges::equal(set, expected));
+  ASSERT_EQ(*snapshot.begin(), -5);
+}
+
+TEST(PersistentSetTest, CopiesAndMoves) {
+  PersistentSet<std::string> set = {"c", "a", "b", "a"};
+  std::vector<std::string> expected = {"a", "b", "c"};
+  ASSERT_TRUE(std::ranges::equal(set, expected));
+
+  PersistentSet<std::string> copy = set;
+  set.erase("b");
+  set.insert("d");
+  ASSERT_TRUE(std::ranges::equal(copy, expected));
+  ASSERT_EQ(*copy.find("b"), "b");
+  ASSERT_EQ(set.find("b"), set.end());
+
+  PersistentSet<std::string> moved = std::move(copy);
+  ASSERT_TRUE(copy.empty());
+  ASSERT_TRUE(std::ranges::equal(moved, expected));
+
+  copy = set;
+  moved = std::move(copy);
+  ASSERT_TRUE(std::ranges::equal(moved, set));
+
+  moved = moved;
+  ASSERT_TRUE(std::ranges::equal(moved, set));
+
+  moved.swap(copy);
+  ASSERT_TRUE(moved.empty());
+  ASSERT_TRUE(std::ranges::equal(copy, set));
+}
+
+namespace {
+
+// order is picked when the comparator is constructed
+struct FlippableLess {
+  bool operator()(int lhs, int rhs) const {
+    return descending ? rhs < lhs : lhs < rhs;
+  }
+
+  bool descending = false;
+};
+
+} // namespace
+
+TEST(PersistentSetTest, AssignmentsAndSwapsKeepTheComparator) {
+  using FlippableSet = PersistentSet<int, FlippableLess>;
+  FlippableSet descending({1, 2, 3}, FlippableLess{true});
+
+  FlippableSet copied;
+  copied = descending;
+  ASSERT_TRUE(copied.contains(1));
+  ASSERT_TRUE(copied.contains(3));
+  copied.insert(0);
+  ASSERT_TRUE(std::ranges::equal(copied, std::vector<int>{3, 2, 1, 0}));
+
+  FlippableSet moved;
+  moved = std::move(descending);
+  moved.insert(4);
+  ASSERT_TRUE(std::ranges::equal(moved, std::vector<int>{4, 3, 2, 1}));
+
+  FlippableSet swapped = {5, 6};
+  swapped.swap(moved);
+  swapped.insert(0);
+  moved.insert(7);
+  ASSERT_TRUE(std::ranges::equal(swapped, std::vector<int>{4, 3, 2, 1, 0}));
+  ASSERT_TRUE(std::ranges::equal(moved, std::vector<int>{5, 6, 7}));
+}
+
+// a write with a snapshot held copies its path and nothing else, and every node goes with
+// the last set that reaches it
+TEST(PersistentSetTest, WritesCopyOnlyTheirPath) {
+  using Counted = PersistentSet<int, std::less<int>, CountingAllocator<int>>;
+  constexpr int kSize = 1 << 14;
+  AllocationCounter::Reset();
+
+  {
+    std::vector<int> keys(kSize);
+    for (int i = 0; i < kSize; ++i) {
+      keys[i] = 2 * i;
+    }
+
+    Counted set(keys.begin(), keys.end());
+    ASSERT_EQ(AllocationCounter::allocations, static_cast<std::size_t>(kSize));
+
+    std::vector<Counted> snapshots;
+    for (int i = 0; i < 1000; ++i) {
+      snapshots.push_back(set.snapshot());
+
+      auto before = AllocationCounter::allocations;
+      if (i % 2 == 0) {
+        set.insert(std::experimental::randint(0, kSize) * 2 + 1);
+      } else {
+        set.erase(std::experimental::randint(0, kSize) * 2);
+      }
+
+      // an AVL tree of kSize keys is at most 1.44 log2(kSize) high, rotations add a node or two
+      ASSERT_LE(AllocationCounter::allocations - before, 25u);
+    }
+
+    ASSERT_EQ(AllocationCounter::deallocations, 0u);
+
+    // nodes replaced while snapshots were held become garbage with the snapshots
+    snapshots.clear();
+    ASSERT_LE(AllocationCounter::allocations - AllocationCounter::deallocations, set.size() + 0u);
+  }
+
+  ASSERT_EQ(AllocationCounter::allocations, AllocationCounter::deallocations);
+}
+
+// snapshots travel to other threads and are read and dropped there while the writer
+// goes on, so reference counts change from several threads at once
+TEST(PersistentSetTest, SnapshotsReadOnOtherThreads) {
+  constexpr int kWindow = 300;
+  constexpr int kWrites = 6000;
+  constexpr int kReaders = 4;
+
+  PersistentSet<int> set;
+  std::vector<std::thread> readers;
+
+  for (int i = 0; i < kWrites; ++i) {
+    set.insert(i);
+    if (i >= kWindow) {
+      set.erase(i - kWindow);
+    }
+
+    if (i % (kWrites / kReaders) == kWindow) {
+      readers.emplace_back([snapshot = set.snapshot(), i]() mutable {
+        for (int round = 0; round < 50; ++round) {
+          std::vector<int> keys(snapshot.begin(), snapshot.end());
+          ASSERT_EQ(keys.size(), static_cast<std::size_t>(kWindow));
+          ASSERT_EQ(keys.back(), i);
+          ASSERT_EQ(keys.back() - keys.front() + 1, static_cast<int>(keys.size()));
+
+          // a write of its own, invisible to the other copies
+          snapshot.erase(keys.front());
+          snapshot.insert(keys.front());
+        }
+      });
+    }
+  }
+
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  ASSERT_EQ(set.size(), static_cast<std::size_t>(kWindow));
+}
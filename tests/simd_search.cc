@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <experimental/random>
+#include <functional>
+#include <lib/set.hpp>
+#include <lib/simd_search.hpp>
+#include <limits>
+#include <random>
+#include <ranges>
+#include <set>
+#include <string>
+#include <vector>
+
+// kernels exist for plain < and > on arithmetic keys only
+static_assert(!SimdSearchable<std::string, std::less<std::string>>);
+static_assert(!SimdSearchable<int, std::function<bool(int, int)>>);
+#if defined(__SSE2__)
+static_assert(SimdSearchable<int, std::less<int>>);
+static_assert(SimdSearchable<double, std::greater<>>);
+#endif
+
+template <typename Key>
+class SimdSearchTest : public testing::Test {};
+
+using SimdSearchTypes = testing::Types<std::int32_t, std::uint32_t, std::int64_t, std::uint64_t, float, double>;
+TYPED_TEST_SUITE(SimdSearchTest, SimdSearchTypes);
+
+namespace {
+
+// the extremes are where a signed compare of unsigned keys goes wrong
+template <typename Key>
+std::vector<Key> Candidates() {
+  std::vector<Key> keys = {
+    std::numeric_limits<Key>::lowest(), std::numeric_limits<Key>::max(),
+    Key(0), Key(1), Key(2), Key(3), Key(100), Key(101),
+    static_cast<Key>(std::numeric_limits<Key>::max() / 2), static_cast<Key>(std::numeric_limits<Key>::max() / 2 + 1),
+  };
+
+  if constexpr (std::is_signed_v<Key>) {
+    keys.insert(keys.end(), {Key(-1), Key(-2), Key(-100)});
+  }
+
+  return keys;
+}
+
+template <typename Comparator, typename Key>
+void ExpectMatchesScalar(std::vector<Key> pool) {
+  Comparator comparator;
+
+  for (std::size_t count = 0; count <= pool.size(); ++count) {
+    std::vector<Key> block(pool.begin(), pool.begin() + count);
+    std::sort(block.begin(), block.end(), comparator);
+
+    for (auto probe : pool) {
+      auto lower = std::lower_bound(block.begin(), block.end(), probe, comparator) - block.begin();
+      auto upper = std::upper_bound(block.begin(), block.end(), probe, comparator) - block.begin();
+
+      if constexpr (SimdSearchable<Key, Comparator>) {
+        ASSERT_EQ(SimdLowerBound<Comparator>(block.data(), count, probe), lower) << count;
+        ASSERT_EQ(SimdUpperBound<Comparator>(block.data(), count, probe), upper) << count;
+      }
+    }
+  }
+}
+
+} // namespace
+
+TYPED_TEST(SimdSearchTest, MatchesScalarSearch) {
+  auto pool = Candidates<TypeParam>();
+  // random keys fill the blocks up to a few full vectors and an odd tail
+  while (pool.size() < 37) {
+    pool.push_back(static_cast<TypeParam>(std::experimental::randint(-1000, 1000)));
+  }
+
+  // duplicates are never in a set, so they aren't in a block either
+  std::sort(pool.begin(), pool.end());
+  pool.erase(std::unique(pool.begin(), pool.end()), pool.end());
+  std::shuffle(pool.begin(), pool.end(), std::mt19937{7});
+
+  ExpectMatchesScalar<std::less<TypeParam>>(pool);
+  ExpectMatchesScalar<std::less<>>(pool);
+  ExpectMatchesScalar<std::greater<TypeParam>>(pool);
+  ExpectMatchesScalar<std::greater<>>(pool);
+}
+
+TYPED_TEST(SimdSearchTest, BTreeFindAndEmplace) {
+  Set<TypeParam, std::greater<TypeParam>, std::allocator<TypeParam>, BTree<64>> set;
+  std::set<TypeParam, std::greater<TypeParam>> expected;
+
+  for (auto key : Candidates<TypeParam>()) {
+    ASSERT_EQ(set.emplace(key).first, expected.insert(key).second);
+  }
+
+  for (int i = 0; i < 3000; ++i) {
+    auto key = static_cast<TypeParam>(std::experimental::randint(0, 2000));
+    ASSERT_EQ(set.emplace(key).first, expected.insert(key).second);
+  }
+
+  ASSERT_TRUE(std::ranges::equal(set, expected));
+
+  for (auto key : Candidates<TypeParam>()) {
+    ASSERT_EQ(*set.find(key), key);
+    ASSERT_EQ(set.lower_bound(key), set.find(key));
+  }
+}
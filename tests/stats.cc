@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include <experimental/random>
+#include <lib/set.hpp>
+#include <numeric>
+#include <set>
+#include <vector>
+
+namespace {
+
+template <typename Base>
+using InstrumentedSet = Set<int, std::less<int>, std::allocator<int>, Instrumented<Base>>;
+
+} // namespace
+
+// disabled stats take no space
+static_assert(std::is_empty_v<NoStats>);
+static_assert(sizeof(Set<int>) + sizeof(CountingStats) == sizeof(InstrumentedSet<RedBlack>));
+static_assert(std::bidirectional_iterator<InstrumentedSet<Threaded<>>::iterator>);
+
+template <typename Base>
+class StatsTest : public testing::Test {};
+
+using Policies = testing::Types<Unbalanced, RedBlack, Avl, OrderStatistic<>, Threaded<>>;
+TYPED_TEST_SUITE(StatsTest, Policies);
+
+TYPED_TEST(StatsTest, CountsMatchOperations) {
+  InstrumentedSet<TypeParam> set;
+  std::set<int> expected;
+  std::uint64_t inserted = 0;
+  std::uint64_t erased = 0;
+
+  for (int i = 0; i < 3000; ++i) {
+    int key = std::experimental::randint(0, 1000);
+
+    if (std::experimental::randint(0, 2) == 0) {
+      erased += expected.erase(key);
+      set.erase(key);
+    } else {
+      inserted += expected.insert(key).second;
+      set.insert(key);
+    }
+  }
+
+  auto stats = set.stats();
+  ASSERT_EQ(stats.size, expected.size());
+  ASSERT_EQ(stats.allocations, inserted);
+  ASSERT_EQ(stats.frees, erased);
+  ASSERT_EQ(stats.searches, 3000u);
+  ASSERT_GE(stats.comparisons, stats.searches - 1); // the first insert compares nothing
+
+  // a descent compares at most twice per level
+  set.reset_stats();
+  for (int key = 0; key < 1000; ++key) {
+    ASSERT_EQ(set.contains(key), expected.contains(key));
+  }
+
+  stats = set.stats();
+  ASSERT_EQ(stats.searches, 1000u);
+  ASSERT_LE(stats.comparisons, 2 * stats.height * stats.searches);
+  ASSERT_EQ(stats.allocations, 0u);
+
+  set.clear();
+  ASSERT_EQ(set.stats().frees, expected.size());
+  ASSERT_EQ(set.stats().height, 0u);
+}
+
+TYPED_TEST(StatsTest, SuccessorLinks) {
+  InstrumentedSet<TypeParam> set;
+  InstrumentedSet<TypeParam> other = {1, 2, 3};
+  for (int i = 0; i < 1000; ++i) {
+    set.insert(std::experimental::randint(0, 5000));
+  }
+
+  SuccessorCounters::ResetThisThread();
+  std::size_t count = 0;
+  for (auto it = set.begin(); it != set.end(); ++it) {
+    ++count;
+  }
+
+  // a full scan crosses every edge twice, plus the climb to the "end" node
+  auto height = set.height();
+  auto counters = SuccessorCounters::ThisThread();
+  ASSERT_EQ(counters.calls, count);
+  ASSERT_GE(counters.links, count);
+  ASSERT_LE(counters.links, 2 * count + height);
+  ASSERT_LE(counters.max_links, height);
+
+  if constexpr (std::is_same_v<TypeParam, Threaded<>>) {
+    ASSERT_EQ(counters.links, count);
+  }
+
+  // the counters are shared by the sets of the thread, resetting one set keeps them
+  other.reset_stats();
+  for ([[maybe_unused]] int key : other) {
+  }
+  ASSERT_EQ(SuccessorCounters::ThisThread().calls, count + other.size());
+}
+
+TYPED_TEST(StatsTest, Rotations) {
+  InstrumentedSet<TypeParam> set = {0, 1};
+  bool balanced = !std::is_same_v<TypeParam, Unbalanced>;
+
+  // a third ascending key tips the chain over once
+  set.reset_stats();
+  set.insert(2);
+  ASSERT_EQ(set.stats().rotations, balanced ? 1u : 0u);
+  ASSERT_EQ(set.stats().rebalances, balanced ? 1u : 0u);
+
+  for (int i = 3; i < 1000; ++i) {
+    set.insert(i);
+  }
+  for (int i = 0; i < 1000; i += 2) {
+    set.erase(i);
+  }
+
+  // at most one rebalance per insert and erase
+  auto stats = set.stats();
+  ASSERT_LE(stats.rebalances, 997u + 500u);
+  ASSERT_GE(stats.rotations, stats.rebalances);
+  ASSERT_EQ(stats.rebalances == 0, !balanced);
+
+  // rotating sets keep their own counts
+  InstrumentedSet<TypeParam> other;
+  other.insert(0);
+  ASSERT_EQ(other.stats().rotations, 0u);
+  ASSERT_EQ(set.stats().rotations, stats.rotations);
+
+  set.reset_stats();
+  ASSERT_EQ(set.stats().rotations, 0u);
+  ASSERT_EQ(set.stats().rebalances, 0u);
+}
+
+TEST(StatsTest, HintedSearchCountsOnce) {
+  InstrumentedSet<RedBlack> set;
+  for (int i = 0; i < 100; i += 2) {
+    set.insert(i);
+  }
+
+  // the right hint, then one which falls back to the descent from the root
+  auto hint = set.find(52);
+  set.reset_stats();
+  set.insert(hint, 51);
+  ASSERT_EQ(set.stats().searches, 1u);
+  set.insert(set.begin(), 61);
+  ASSERT_EQ(set.stats().searches, 2u);
+}
+
+TEST(StatsTest, ShapeOfTheTree) {
+  Set<int, std::less<int>, std::allocator<int>, Unbalanced> list;
+  for (int i = 0; i < 100; ++i) {
+    list.insert(i);
+  }
+
+  // ascending keys make a chain without balancing
+  ASSERT_EQ(list.height(), 100u);
+  ASSERT_EQ(list.depth_histogram(), std::vector<std::size_t>(100, 1));
+
+  Set<int> balanced;
+  for (int i = 0; i < 1000; ++i) {
+    balanced.insert(std::experimental::randint(0, 5000));
+  }
+
+  auto histogram = balanced.depth_histogram();
+  ASSERT_EQ(std::accumulate(histogram.begin(), histogram.end(), std::size_t{0}), balanced.size());
+  ASSERT_EQ(histogram.front(), 1u);
+  ASSERT_LE(balanced.height(), 20u); // red-black trees are at most 2 log2(n + 1) high
+  for (std::size_t depth = 0; depth < histogram.size(); ++depth) {
+    ASSERT_LE(histogram[depth], std::size_t{1} << depth);
+  }
+
+  InstrumentedSet<RedBlack> instrumented(balanced.begin(), balanced.end());
+  auto stats = instrumented.stats();
+  ASSERT_EQ(stats.height, instrumented.height());
+  ASSERT_GT(stats.average_depth, 0);
+  ASSERT_LT(stats.average_depth, static_cast<double>(stats.height));
+  ASSERT_EQ(Set<int>().height(), 0u);
+}
+
+TEST(StatsTest, OrderStatisticStillRanks) {
+  InstrumentedSet<OrderStatistic<>> set = {5, 1, 4, 2, 3};
+
+  ASSERT_EQ(*set.nth(2), 3);
+  ASSERT_EQ(set.rank(4), 3u);
+  ASSERT_EQ(set.stats().allocations, 5u);
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <lib/set.hpp>
+#include <pthread.h>
+
+namespace {
+
+using UnbalancedSet = Set<int, std::less<int>, std::allocator<int>, Unbalanced>;
+
+// runs func on a thread with a tiny stack, so anything recursing over the tree depth crashes
+template <typename Func>
+void RunWithSmallStack(Func func) {
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+  pthread_attr_setstacksize(&attributes, 128 * 1024);
+
+  pthread_t thread;
+  auto trampoline = [](void* arg) -> void* {
+    (*static_cast<Func*>(arg))();
+    return nullptr;
+  };
+
+  ASSERT_EQ(pthread_create(&thread, &attributes, trampoline, &func), 0);
+  pthread_join(thread, nullptr);
+  pthread_attr_destroy(&attributes);
+}
+
+} // namespace
+
+TEST(StressTest, DegenerateTreeCopyAndDestruction) {
+  static constexpr int nodes_count = 10000;
+  UnbalancedSet set;
+
+  // sorted insertion into an unbalanced tree makes it a list, depth equals size
+  for (int i = 0; i < nodes_count; ++i) {
+    set.insert(i);
+  }
+
+  RunWithSmallStack([&set] {
+    UnbalancedSet copy = set;
+    UnbalancedSet assigned;
+    assigned = copy;
+
+    int expected = 0;
+    for (int i : assigned) {
+      EXPECT_EQ(i, expected++);
+    }
+    EXPECT_EQ(expected, nodes_count);
+
+    copy.clear();
+    EXPECT_TRUE(copy.empty());
+  });
+}
+
+TEST(StressTest, TenMillionKeys) {
+  static constexpr int nodes_count = 10'000'000;
+  Set<int> set;
+
+  for (int i = 0; i < nodes_count; ++i) {
+    set.insert(i);
+  }
+  ASSERT_EQ(set.size(), static_cast<size_t>(nodes_count));
+
+  RunWithSmallStack([&set] {
+    Set<int> copy = set;
+    EXPECT_EQ(copy.size(), set.size());
+    EXPECT_EQ(*copy.begin(), 0);
+    EXPECT_EQ(*copy.rbegin(), nodes_count - 1);
+  });
+}
@@ -7,11 +7,13 @@
 
 class TraversalsTest : public testing::Test {
 protected:
-  using preorder = Set<int>::preorder;
-  using postorder = Set<int>::postorder;
+  // expected traversals below depend on the tree shape, so it's pinned to insertion order
+  using UnbalancedSet = Set<int, std::less<int>, std::allocator<int>, Unbalanced>;
+  using preorder = UnbalancedSet::preorder;
+  using postorder = UnbalancedSet::postorder;
 
   const int nodes_count = 500;
-  Set<int> tree;
+  UnbalancedSet tree;
   std::vector<int> input_nodes{15, 10, 12, 11, 20};
   std::vector<int> preorder_expected{15, 10, 12, 11, 20};
   std::vector<int> postorder_expected{ 11, 12, 10, 20, 15 };
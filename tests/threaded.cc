@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <experimental/random>
+#include <iterator>
+#include <lib/set.hpp>
+#include <set>
+#include <tests/tree_invariants.hpp>
+#include <vector>
+
+namespace {
+
+template <typename Base>
+using ThreadedSet = Set<int, std::less<int>, std::allocator<int>, Threaded<Base>>;
+
+// threads must agree with the inorder walk through the parents, in both directions
+template <typename SetType>
+void CheckThreads(const SetType& set, const std::set<int>& expected) {
+  auto* header = set.end().node_ptr();
+  auto* node = header;
+  auto* walked = InOrder<int>::GetInitial(header);
+
+  for (int key : expected) {
+    auto* next = ThreadedInOrder<int>::Successor(node);
+    ASSERT_EQ(next, walked);
+    ASSERT_EQ(next->key, key);
+    ASSERT_EQ(ThreadedInOrder<int>::Predecessor(next), node);
+    node = next;
+    walked = InOrder<int>::Successor(walked);
+  }
+
+  ASSERT_EQ(walked, header);
+  ASSERT_EQ(ThreadedInOrder<int>::Successor(node), header);
+  ASSERT_EQ(ThreadedInOrder<int>::Predecessor(header), node);
+
+  ASSERT_TRUE(std::ranges::equal(set, expected));
+  ASSERT_TRUE(std::equal(expected.rbegin(), expected.rend(), std::make_reverse_iterator(set.end())));
+}
+
+} // namespace
+
+static_assert(std::is_same_v<ThreadedSet<RedBlack>::allocator_type::value_type, ThreadedNode<int>>);
+static_assert(std::bidirectional_iterator<ThreadedSet<RedBlack>::iterator>);
+
+template <typename Base>
+class ThreadedTest : public testing::Test {};
+
+using Policies = testing::Types<Unbalanced, RedBlack, Avl>;
+TYPED_TEST_SUITE(ThreadedTest, Policies);
+
+TYPED_TEST(ThreadedTest, RandomInsertErase) {
+  ThreadedSet<TypeParam> set;
+  std::set<int> expected;
+
+  for (int i = 0; i < 3000; ++i) {
+    int key = std::experimental::randint(0, 1000);
+
+    if (std::experimental::randint(0, 2) == 0) {
+      ASSERT_EQ(set.erase(key), expected.erase(key));
+    } else {
+      set.insert(key);
+      expected.insert(key);
+    }
+
+    if (i % 100 == 0) {
+      CheckThreads(set, expected);
+    }
+  }
+
+  CheckThreads(set, expected);
+
+  while (!set.empty()) {
+    expected.erase(set.min());
+    set.pop_front();
+  }
+  CheckThreads(set, expected);
+}
+
+TYPED_TEST(ThreadedTest, WholeTreeOperations) {
+  std::vector<int> keys;
+  for (int i = 0; i < 2000; ++i) {
+    keys.push_back(std::experimental::randint(0, 5000));
+  }
+  std::set<int> expected(keys.begin(), keys.end());
+
+  // bulk construction and copies lay the threads from scratch
+  ThreadedSet<TypeParam> set(keys.begin(), keys.end());
+  CheckThreads(set, expected);
+
+  ThreadedSet<TypeParam> copy = set;
+  CheckThreads(copy, expected);
+
+  ThreadedSet<TypeParam> assigned = {1, 2, 3};
+  assigned = set;
+  CheckThreads(assigned, expected);
+
+  // erase through iterators, each one steps by its threads
+  for (auto it = copy.begin(); it != copy.end();) {
+    it = *it % 3 == 0 ? copy.erase(it) : std::next(it);
+  }
+  std::erase_if(expected, [](int key) { return key % 3 == 0; });
+  CheckThreads(copy, expected);
+
+  // relinked nodes come with stale threads
+  ThreadedSet<TypeParam> other;
+  for (int i = 0; i < 300; ++i) {
+    other.insert(std::experimental::randint(0, 5000) * 3);
+  }
+  std::set<int> merged = expected;
+  merged.insert(other.begin(), other.end());
+
+  copy.merge(other);
+  CheckThreads(copy, merged);
+
+  auto node = copy.extract(*copy.begin());
+  merged.erase(node.value());
+  CheckThreads(copy, merged);
+
+  node.value() = -1;
+  copy.insert(std::move(node));
+  merged.insert(-1);
+  CheckThreads(copy, merged);
+
+  ThreadedSet<TypeParam> moved = std::move(copy);
+  CheckThreads(moved, merged);
+  CheckThreads(copy, {});
+
+  copy.insert(7);
+  CheckThreads(copy, {7});
+
+  // "end" nodes stay with their sets, each takes over the other's list
+  ThreadedSet<TypeParam> empty;
+  moved.swap(copy);
+  CheckThreads(moved, {7});
+  CheckThreads(copy, merged);
+  empty.swap(copy);
+  CheckThreads(empty, merged);
+  CheckThreads(copy, {});
+  std::swap(moved, empty);
+  CheckThreads(moved, merged);
+
+  moved.clear();
+  CheckThreads(moved, {});
+}
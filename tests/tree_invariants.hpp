@@ -0,0 +1,68 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <lib/set.hpp>
+
+template <typename Policy>
+using BalancedSet = Set<int, std::less<int>, std::allocator<int>, Policy>;
+
+// returns black height of the subtree, fails the test on any red-black violation
+template <typename T>
+int CheckRedBlack(Node<T>* node) {
+  if (node == nullptr) return 1;
+
+  if (RedBlack::IsRed(node)) {
+    EXPECT_FALSE(RedBlack::IsRed(node->left));
+    EXPECT_FALSE(RedBlack::IsRed(node->right));
+  }
+
+  if (node->left != nullptr) {
+    EXPECT_EQ(node->left->parent, node);
+  }
+  if (node->right != nullptr) {
+    EXPECT_EQ(node->right->parent, node);
+  }
+
+  int left = CheckRedBlack(node->left);
+  int right = CheckRedBlack(node->right);
+  EXPECT_EQ(left, right);
+
+  return left + (RedBlack::IsRed(node) ? 0 : 1);
+}
+
+// returns height of the subtree, fails the test on any avl violation
+template <typename T>
+int CheckAvl(Node<T>* node) {
+  if (node == nullptr) return 0;
+
+  if (node->left != nullptr) {
+    EXPECT_EQ(node->left->parent, node);
+  }
+  if (node->right != nullptr) {
+    EXPECT_EQ(node->right->parent, node);
+  }
+
+  int left = CheckAvl(node->left);
+  int right = CheckAvl(node->right);
+  EXPECT_EQ(node->balance, right - left);
+
+  return std::max(left, right) + 1;
+}
+
+// "end" node is the fake root, the real tree is its left subtree
+template <typename SetType>
+auto* GetRoot(const SetType& set) {
+  return set.end().node_ptr()->left;
+}
+
+// returns size of the subtree, fails the test if any node of an order statistic tree miscounts it
+template <typename T>
+std::size_t CheckSizes(Node<T>* node) {
+  if (node == nullptr) return 0;
+
+  auto size = CheckSizes(node->left) + CheckSizes(node->right) + 1;
+  EXPECT_EQ(static_cast<SizedNode<T>*>(node)->size, size);
+
+  return size;
+}